@@ -0,0 +1,1067 @@
+#include "game.h"
+#include "platform.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Headless microbenchmarks for the engine's hot paths. Each benchmark is
+// warmed up, then timed over a number of runs; the per-call median, p99
+// and minimum are printed as one JSON object per line on stdout so
+// results can be diffed between releases.
+
+#define BENCH_WARMUP_RUNS 3
+#define BENCH_DEFAULT_RUNS 51
+#define BENCH_SEED 12345u
+#define BENCH_SAVE_FRAMES 240
+#define BENCH_SAVE_INTERVAL 30
+#define BENCH_STREAM_SPEED 2000.0f
+#define BENCH_ROUNDTRIP_FRAMES 600
+#define BENCH_ANIMAL_LANES 4096
+#define BENCH_CODEC_WORLDS 4
+#define BENCH_PILE_WIDTH 120
+#define BENCH_PILE_HEIGHT 40
+#define BENCH_EDIT_CELLS 1000000
+#define BENCH_NET_PORT 37015
+#define BENCH_NET_TICKS 600
+#define BENCH_LATENCY_SETTLE_FRAMES 30
+#define BENCH_LATENCY_FRAMES 120
+#define BENCH_FLOW_EDITS 500
+
+typedef void (*BenchFunction)(void* context);
+
+typedef struct {
+    int runs;
+    const char* filter;
+} BenchOptions;
+
+// Saves and cached terrain go to fresh temporary directories, removed on
+// the way out
+static char benchSaveDirectory[512];
+static char benchTerrainDirectory[512];
+static World* benchWorld;
+static Animal baselineAnimals[MAX_ANIMALS];
+static unsigned int baselineRngState;
+
+static int CompareDoubles(const void* a, const void* b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+// Times 'body' called 'iterations' times per run. 'setup', if given, runs
+// untimed before every run.
+static void RunBenchmark(const BenchOptions* options, const char* name, BenchFunction setup,
+                         BenchFunction body, void* context, int iterations) {
+    if (options->filter != NULL && strstr(name, options->filter) == NULL) return;
+    
+    double* samples = (double*)malloc(sizeof(double) * options->runs);
+    
+    for (int run = 0; run < BENCH_WARMUP_RUNS + options->runs; run++) {
+        if (setup != NULL) setup(context);
+        
+        uint64_t start = PlatformGetTicks();
+        for (int i = 0; i < iterations; i++) {
+            body(context);
+        }
+        uint64_t elapsed = PlatformGetTicks() - start;
+        
+        if (run >= BENCH_WARMUP_RUNS) {
+            samples[run - BENCH_WARMUP_RUNS] = (double)elapsed / iterations;
+        }
+    }
+    
+    qsort(samples, options->runs, sizeof(double), CompareDoubles);
+    double mean = 0;
+    for (int i = 0; i < options->runs; i++) mean += samples[i];
+    mean /= options->runs;
+    int p99 = (options->runs * 99 + 99) / 100 - 1;
+    
+    printf("{\"name\":\"%s\",\"iterations\":%d,\"runs\":%d,\"median_ns\":%.1f,\"p99_ns\":%.1f,\"min_ns\":%.1f,\"mean_ns\":%.1f}\n",
+           name, iterations, options->runs, samples[options->runs / 2], samples[p99], samples[0], mean);
+    fflush(stdout);
+    free(samples);
+}
+
+static void BenchGenerateWorld(void* context) {
+    (void)context;
+    benchWorld->seed = BENCH_SEED;
+    GenerateWorld(benchWorld);
+}
+
+static void BenchGenerateWorldThreaded(void* context) {
+    benchWorld->seed = BENCH_SEED;
+    GenerateWorldThreaded(benchWorld, *(int*)context);
+}
+
+static void BenchLoadTerrainCache(void* context) {
+    (void)context;
+    benchWorld->seed = BENCH_SEED;
+    LoadTerrainCache(benchWorld);
+}
+
+typedef struct {
+    int points[1024][2];
+    int next;
+    int hits;
+} CollisionContext;
+
+static void BenchCheckCollision(void* context) {
+    CollisionContext* ctx = (CollisionContext*)context;
+    int* p = ctx->points[ctx->next++ & 1023];
+    ctx->hits += CheckCollision(benchWorld, p[0], p[1]);
+}
+
+static void BenchCheckAnimalCollision(void* context) {
+    CollisionContext* ctx = (CollisionContext*)context;
+    int* p = ctx->points[ctx->next++ & 1023];
+    ctx->hits += CheckAnimalCollision(benchWorld, p[0], p[1], 12, 12);
+}
+
+typedef struct {
+    int population;
+} AnimalContext;
+
+// Restores the first 'population' baseline animals, through the pool so
+// its free list stays consistent
+static void SetupAnimals(void* context) {
+    AnimalContext* ctx = (AnimalContext*)context;
+    for (int i = 0; i < MAX_ANIMALS; i++) {
+        if (benchWorld->animals[i].alive) DespawnAnimal(benchWorld, &benchWorld->animals[i]);
+    }
+    
+    for (int i = 0; i < MAX_ANIMALS && benchWorld->animalCount < ctx->population; i++) {
+        if (!baselineAnimals[i].alive) continue;
+        Animal* animal = (Animal*)PoolAlloc(&benchWorld->animalPool);
+        *animal = baselineAnimals[i];
+        benchWorld->animalCount++;
+    }
+    benchWorld->rngState = baselineRngState;
+}
+
+static void BenchUpdateAnimals(void* context) {
+    (void)context;
+    UpdateAnimals(benchWorld, 1.0f / 60.0f);
+}
+
+// A synthetic herd far larger than the world holds, so the integration
+// kernel's own cost shows instead of the per-animal AI around it
+static void SetupAnimalLanes(void* context) {
+    AnimalLanes* lanes = (AnimalLanes*)context;
+    unsigned int state = BENCH_SEED;
+    for (int i = 0; i < lanes->count; i++) {
+        state = state * 1664525u + 1013904223u;
+        lanes->x[i] = (float)(state % (WORLD_WIDTH * BLOCK_SIZE));
+        lanes->y[i] = (float)(state >> 16 & 1023);
+        lanes->velX[i] = (float)(state % 200) - 100.0f;
+        lanes->velY[i] = (float)(state >> 8 & 511) - 256.0f;
+        lanes->velXScale[i] = state & 1 ? 0.9f : 0.0f;
+        lanes->velXDrive[i] = state & 1 ? 0.0f : 60.0f;
+        lanes->velYScale[i] = state & 2 ? 0.8f : 1.0f;
+        lanes->gravity[i] = state & 4 ? 400.0f : 0.0f;
+    }
+}
+
+static void BenchIntegrateAnimalLanes(void* context) {
+    IntegrateAnimalLanes((AnimalLanes*)context, 1.0f / 60.0f);
+}
+
+static void SetupInventory(void* context) {
+    (void)context;
+    InitPlayer(&benchWorld->player);
+}
+
+static void BenchAddToInventory(void* context) {
+    (void)context;
+    // A mining burst: a handful of block types, as from digging down
+    static const BlockType mined[] = { BLOCK_DIRT, BLOCK_STONE, BLOCK_DIRT, BLOCK_COAL_ORE, BLOCK_STONE, BLOCK_IRON_ORE };
+    for (int i = 0; i < 64; i++) {
+        AddToInventory(&benchWorld->player, mined[i % 6], 1);
+    }
+}
+
+static void BenchCanCraftTool(void* context) {
+    int* craftable = (int*)context;
+    for (int tool = 1; tool < TOOL_COUNT; tool++) {
+        *craftable += CanCraftTool(&benchWorld->player, (ToolType)tool);
+    }
+}
+
+typedef struct {
+    short cursors[256][2];
+    int next;
+    int hits;
+} TargetingContext;
+
+// One frame's targeting for a cursor somewhere around the player, as the
+// game loop runs it
+static void BenchUpdateBlockTarget(void* context) {
+    TargetingContext* ctx = (TargetingContext*)context;
+    short* cursor = ctx->cursors[ctx->next++ & 255];
+    InputFrame* input = &benchWorld->input;
+    ApplyInputFrame(input, 0, cursor[0], cursor[1], 0, 1.0f / 60.0f);
+    UpdateBlockTarget(benchWorld, &benchWorld->player, input);
+    ctx->hits += benchWorld->player.target.hitSolid;
+}
+
+typedef struct {
+    int population;
+    int drawn;
+} ParticleContext;
+
+// Block-break bursts over a screen and a half around the player, with
+// their lives stretched so none die while timed
+static void SetupParticles(void* context) {
+    ParticleContext* ctx = (ParticleContext*)context;
+    ResetParticles(benchWorld);
+    benchWorld->camera = GetPlayerCamera(&benchWorld->player);
+    
+    unsigned int state = BENCH_SEED;
+    while (benchWorld->particles->count < ctx->population) {
+        state = state * 1664525u + 1013904223u;
+        float x = benchWorld->player.x + (float)(state % (SCREEN_WIDTH * 3 / 2)) - SCREEN_WIDTH * 3 / 4;
+        state = state * 1664525u + 1013904223u;
+        float y = benchWorld->player.y + (float)(state % SCREEN_HEIGHT) - SCREEN_HEIGHT / 2;
+        int count = ctx->population - benchWorld->particles->count;
+        EmitParticles(benchWorld, (ParticleKind)(state >> 30 & 1), x, y, count < 25 ? count : 25, BROWN);
+    }
+    for (int i = 0; i < benchWorld->particles->count; i++) {
+        benchWorld->particles->life[i] = 100.0f;
+    }
+}
+
+static void BenchUpdateParticles(void* context) {
+    (void)context;
+    UpdateParticles(benchWorld, 1.0f / 60.0f);
+}
+
+static void BenchBuildParticleDrawList(void* context) {
+    ParticleContext* ctx = (ParticleContext*)context;
+    static ParticleDrawItem items[PARTICLE_DRAW_BATCH];
+    
+    int next = 0;
+    while (next < benchWorld->particles->count) {
+        ctx->drawn += BuildParticleDrawList(benchWorld, &next, items, PARTICLE_DRAW_BATCH);
+    }
+}
+
+static void BenchBuildWorldDrawList(void* context) {
+    int* frame = (int*)context;
+    static BlockDrawItem items[MAX_VISIBLE_BLOCKS];
+    
+    // Pan across the whole world, as the camera would while exploring
+    float span = WORLD_WIDTH * BLOCK_SIZE - SCREEN_WIDTH;
+    benchWorld->camera.target.x = SCREEN_WIDTH / 2 + (float)((*frame)++ % 256) / 256.0f * span;
+    benchWorld->camera.target.y = 50 * BLOCK_SIZE;
+    BuildWorldDrawList(benchWorld, items, MAX_VISIBLE_BLOCKS);
+}
+
+// Every region unsaved, with the previous save finished and collected
+static void SetupRequestSave(void* context) {
+    (void)context;
+    SaveResult result;
+    WaitForSave();
+    PollSaveResult(benchWorld, &result);
+    memset(benchWorld->unsavedRegions, true, sizeof(benchWorld->unsavedRegions));
+}
+
+// What a save costs the main thread: copying the world out for the save thread
+static void BenchRequestSave(void* context) {
+    (void)context;
+    RequestSave(benchWorld);
+}
+
+// Simulated frames at 60 Hz that dig a cell each, with or without a save
+// requested every BENCH_SAVE_INTERVAL frames. The save thread writes
+// between and during frames, so the frame-time tail should not move.
+static void RunSaveFrameScenario(const BenchOptions* options, bool autosave) {
+    const char* name = autosave ? "SaveFrames/autosave" : "SaveFrames/none";
+    if (options->filter != NULL && strstr(name, options->filter) == NULL) return;
+    
+    static double samples[BENCH_SAVE_FRAMES];
+    SaveResult result;
+    WaitForSave();
+    PollSaveResult(benchWorld, &result);
+    
+    int saves = 0;
+    double writeSeconds = 0;
+    size_t bytesWritten = 0;
+    uint64_t nextFrame = PlatformGetTicks();
+    for (int frame = 0; frame < BENCH_SAVE_FRAMES; frame++) {
+        uint64_t start = PlatformGetTicks();
+        UpdateAnimals(benchWorld, 1.0f / 60.0f);
+        int cell = frame * 7919 % (WORLD_WIDTH * WORLD_HEIGHT / 2);
+        SetBlock(benchWorld, cell % WORLD_WIDTH, WORLD_HEIGHT / 2 + cell / WORLD_WIDTH, frame & 1 ? BLOCK_STONE : BLOCK_AIR);
+        if (autosave) {
+            if (PollSaveResult(benchWorld, &result)) {
+                saves++;
+                writeSeconds += result.writeSeconds;
+                bytesWritten += result.bytesWritten;
+            }
+            if (frame % BENCH_SAVE_INTERVAL == 0) RequestSave(benchWorld);
+        }
+        uint64_t end = PlatformGetTicks();
+        samples[frame] = (double)(end - start);
+        
+        nextFrame += 1000000000ull / 60;
+        if (nextFrame > end) PlatformSleep(nextFrame - end);
+    }
+    WaitForSave();
+    if (PollSaveResult(benchWorld, &result)) {
+        saves++;
+        writeSeconds += result.writeSeconds;
+        bytesWritten += result.bytesWritten;
+    }
+    
+    qsort(samples, BENCH_SAVE_FRAMES, sizeof(double), CompareDoubles);
+    printf("{\"name\":\"%s\",\"frames\":%d,\"median_ns\":%.1f,\"p99_ns\":%.1f,\"max_ns\":%.1f,\"saves\":%d,"
+           "\"write_ms_mean\":%.3f,\"bytes_per_save\":%.0f}\n",
+           name, BENCH_SAVE_FRAMES, samples[BENCH_SAVE_FRAMES / 2], samples[BENCH_SAVE_FRAMES * 99 / 100],
+           samples[BENCH_SAVE_FRAMES - 1], saves, saves > 0 ? writeSeconds * 1000.0 / saves : 0.0,
+           saves > 0 ? (double)bytesWritten / saves : 0.0);
+    fflush(stdout);
+}
+
+// A player crossing the saved bench world left to right at 60 Hz, far
+// faster than walking, with regions streamed in behind LoadWorld. Every
+// region was edited, so each one is a real read.
+static void RunStreamScenario(const BenchOptions* options, World* world, bool prefetch) {
+    const char* name = prefetch ? "RegionStream/prefetch" : "RegionStream/demand";
+    if (options->filter != NULL && strstr(name, options->filter) == NULL) return;
+    if (!LoadWorld(world, benchSaveDirectory) || !StartRegionStreaming(benchSaveDirectory, prefetch)) return;
+    
+    Player* player = &world->player;
+    player->x = 0;
+    player->y = WORLD_HEIGHT * BLOCK_SIZE / 2;
+    player->velX = BENCH_STREAM_SPEED;
+    player->velY = 0;
+    
+    int frames = 0;
+    uint64_t nextFrame = PlatformGetTicks();
+    while (player->x < WORLD_WIDTH * BLOCK_SIZE) {
+        UpdateRegionStreaming(world, player);
+        player->x += player->velX / 60.0f;
+        frames++;
+        
+        nextFrame += 1000000000ull / 60;
+        uint64_t now = PlatformGetTicks();
+        if (nextFrame > now) PlatformSleep(nextFrame - now);
+    }
+    
+    RegionStreamStats stats;
+    GetRegionStreamStats(&stats);
+    StopRegionStreaming();
+    printf("{\"name\":\"%s\",\"backend\":\"%s\",\"frames\":%d,\"regions_read\":%u,\"regions_loaded\":%u,"
+           "\"hits\":%u,\"misses\":%u,\"hit_rate\":%.3f,\"stall_ms\":%.3f,\"max_stall_ms\":%.3f}\n",
+           name, stats.backend, frames, stats.regionsQueued, stats.regionsLoaded, stats.hits, stats.misses,
+           stats.hits + stats.misses > 0 ? (double)stats.hits / (stats.hits + stats.misses) : 0.0,
+           stats.stallSeconds * 1000.0, stats.maxStallSeconds * 1000.0);
+    fflush(stdout);
+}
+
+// Load, simulate, save, reload. The player stands at the left edge of the
+// saved bench world, so most regions never stream in, while the block
+// ticks and falling sand run for a while and an autosave goes out. The
+// world is then loaded again with every region applied, and each region's
+// edited corner cell must still be wood: a region saved before its file
+// was applied would have lost it to the generated terrain.
+static void RunStreamRoundTripScenario(const BenchOptions* options, World* world) {
+    const char* name = "RegionStream/roundtrip";
+    if (options->filter != NULL && strstr(name, options->filter) == NULL) return;
+    if (!LoadWorld(world, benchSaveDirectory) || !StartRegionStreaming(benchSaveDirectory, false)) return;
+    
+    Player* player = &world->player;
+    player->x = 0;
+    player->y = WORLD_HEIGHT * BLOCK_SIZE / 2;
+    player->velX = 0;
+    player->velY = 0;
+    for (int frame = 0; frame < BENCH_ROUNDTRIP_FRAMES; frame++) {
+        UpdateRegionStreaming(world, player);
+        UpdateBlockTicks(world, 1.0f / 60.0f);
+        UpdateGranular(world, 1.0f / 60.0f);
+    }
+    // Unloaded regions the simulation reached into, which it should not
+    int unloaded = 0;
+    int unloadedChanged = 0;
+    for (int regionY = 0; regionY < WORLD_REGION_ROWS; regionY++) {
+        for (int regionX = 0; regionX < WORLD_REGION_COLUMNS; regionX++) {
+            unloaded += world->unloadedRegions[regionY][regionX];
+            unloadedChanged += world->unloadedRegions[regionY][regionX] && world->unsavedRegions[regionY][regionX];
+        }
+    }
+    SaveResult result = { 0 };
+    WaitForSave();
+    PollSaveResult(world, &result);
+    bool saved = RequestSave(world);
+    WaitForSave();
+    saved = PollSaveResult(world, &result) && result.ok && saved;
+    StopRegionStreaming();
+    
+    static unsigned char buffer[SAVE_MAX_FILE_SIZE];
+    int kept = 0;
+    LoadWorld(world, benchSaveDirectory);
+    for (int regionY = 0; regionY < WORLD_REGION_ROWS; regionY++) {
+        for (int regionX = 0; regionX < WORLD_REGION_COLUMNS; regionX++) {
+            char path[512];
+            GetSavedRegionPath(path, sizeof(path), benchSaveDirectory, regionX, regionY);
+            FILE* file = fopen(path, "rb");
+            if (file == NULL) continue;
+            int size = (int)fread(buffer, 1, sizeof(buffer), file);
+            fclose(file);
+            if (ApplySavedRegion(world, regionX, regionY, buffer, size) &&
+                world->blocks[regionY * REGION_SIZE][regionX * REGION_SIZE] == BLOCK_WOOD) {
+                kept++;
+            }
+        }
+    }
+    
+    printf("{\"name\":\"%s\",\"frames\":%d,\"regions_unloaded\":%d,\"unloaded_changed\":%d,\"regions_saved\":%d,"
+           "\"edits\":%d,\"edits_kept\":%d,\"ok\":%s}\n",
+           name, BENCH_ROUNDTRIP_FRAMES, unloaded, unloadedChanged, result.regionsWritten,
+           WORLD_REGION_ROWS * WORLD_REGION_COLUMNS, kept,
+           saved && unloadedChanged == 0 && kept == WORLD_REGION_ROWS * WORLD_REGION_COLUMNS ? "true" : "false");
+    fflush(stdout);
+}
+
+// Every region of BENCH_CODEC_WORLDS generated worlds, or each world
+// whole, through the block codec and back. Reports the compression ratio
+// and the throughput each way in cell bytes per second, from the median
+// of the runs.
+static void RunCodecScenario(const BenchOptions* options, World* world, bool wholeWorld) {
+    const char* name = wholeWorld ? "Codec/world" : "Codec/region";
+    if (options->filter != NULL && strstr(name, options->filter) == NULL) return;
+    
+    enum { CELLS = WORLD_WIDTH * WORLD_HEIGHT, REGION_CELLS = REGION_SIZE * REGION_SIZE };
+    static unsigned char cells[BENCH_CODEC_WORLDS][CELLS];
+    static unsigned char encoded[BENCH_CODEC_WORLDS][CODEC_MAX_ENCODED_SIZE(CELLS)];
+    static unsigned char decoded[CELLS];
+    static BlockCodec codec;
+    int chunk = wholeWorld ? CELLS : REGION_CELLS;
+    int chunks = CELLS / chunk;
+    
+    // Regions are laid out one after another, cells past the world's edge
+    // left out so every chunk is a full region
+    for (int w = 0; w < BENCH_CODEC_WORLDS; w++) {
+        InitGame(world, BENCH_SEED + w);
+        if (wholeWorld) {
+            for (int i = 0; i < CELLS; i++) cells[w][i] = (unsigned char)world->blocks[i / WORLD_WIDTH][i % WORLD_WIDTH];
+            continue;
+        }
+        int count = 0;
+        for (int regionY = 0; regionY < WORLD_HEIGHT / REGION_SIZE; regionY++) {
+            for (int regionX = 0; regionX < WORLD_WIDTH / REGION_SIZE; regionX++) {
+                for (int y = 0; y < REGION_SIZE; y++) {
+                    for (int x = 0; x < REGION_SIZE; x++) {
+                        cells[w][count++] = (unsigned char)world->blocks[regionY * REGION_SIZE + y][regionX * REGION_SIZE + x];
+                    }
+                }
+            }
+        }
+        chunks = count / chunk;
+    }
+    
+    static int sizes[BENCH_CODEC_WORLDS][CELLS / (REGION_SIZE * REGION_SIZE)];
+    double* encodeSamples = (double*)malloc(sizeof(double) * options->runs);
+    double* decodeSamples = (double*)malloc(sizeof(double) * options->runs);
+    size_t encodedBytes = 0;
+    bool ok = true;
+    
+    for (int run = 0; run < BENCH_WARMUP_RUNS + options->runs; run++) {
+        uint64_t start = PlatformGetTicks();
+        encodedBytes = 0;
+        for (int w = 0; w < BENCH_CODEC_WORLDS; w++) {
+            int offset = 0;
+            for (int c = 0; c < chunks; c++) {
+                sizes[w][c] = EncodeBlocks(&codec, cells[w] + c * chunk, chunk, encoded[w] + offset,
+                                           (int)sizeof(encoded[w]) - offset);
+                if (sizes[w][c] < 0) ok = false;
+                offset += sizes[w][c] > 0 ? sizes[w][c] : 0;
+            }
+            encodedBytes += offset;
+        }
+        uint64_t middle = PlatformGetTicks();
+        for (int w = 0; w < BENCH_CODEC_WORLDS; w++) {
+            int offset = 0;
+            for (int c = 0; c < chunks; c++) {
+                if (!DecodeBlocks(&codec, encoded[w] + offset, sizes[w][c], decoded + c * chunk, chunk)) ok = false;
+                offset += sizes[w][c];
+            }
+            if (memcmp(decoded, cells[w], (size_t)chunks * chunk) != 0) ok = false;
+        }
+        uint64_t end = PlatformGetTicks();
+        
+        if (run >= BENCH_WARMUP_RUNS) {
+            encodeSamples[run - BENCH_WARMUP_RUNS] = (double)(middle - start);
+            decodeSamples[run - BENCH_WARMUP_RUNS] = (double)(end - middle);
+        }
+    }
+    
+    qsort(encodeSamples, options->runs, sizeof(double), CompareDoubles);
+    qsort(decodeSamples, options->runs, sizeof(double), CompareDoubles);
+    double rawBytes = (double)BENCH_CODEC_WORLDS * chunks * chunk;
+    printf("{\"name\":\"%s\",\"chunks\":%d,\"raw_bytes\":%.0f,\"encoded_bytes\":%zu,\"ratio\":%.2f,"
+           "\"encode_mb_s\":%.1f,\"decode_mb_s\":%.1f,\"roundtrip\":%s}\n",
+           name, BENCH_CODEC_WORLDS * chunks, rawBytes, encodedBytes, rawBytes / encodedBytes,
+           rawBytes / encodeSamples[options->runs / 2] * 1000.0, rawBytes / decodeSamples[options->runs / 2] * 1000.0,
+           ok ? "true" : "false");
+    fflush(stdout);
+    free(encodeSamples);
+    free(decodeSamples);
+}
+
+static void BenchBlockTick(void* context) {
+    (void)context;
+    UpdateBlockTicks(benchWorld, 1.0f / BLOCK_TICK_RATE);
+}
+
+// Every tree trunk in a fresh world cut at once, then block ticks until
+// the leaves have all come down. A tick costs what was due on it, so the
+// time per update is what should stay flat.
+static void RunLeafDecayScenario(const BenchOptions* options, World* world) {
+    const char* name = "BlockUpdates/felled";
+    if (options->filter != NULL && strstr(name, options->filter) == NULL) return;
+    
+    InitGame(world, BENCH_SEED);
+    int leaves = 0;
+    for (int y = 0; y < WORLD_HEIGHT; y++) {
+        for (int x = 0; x < WORLD_WIDTH; x++) {
+            if (world->blocks[y][x] == BLOCK_WOOD) SetBlock(world, x, y, BLOCK_AIR);
+            if (world->blocks[y][x] == BLOCK_LEAVES) leaves++;
+        }
+    }
+    
+    BlockUpdateQueue* queue = world->blockUpdates;
+    int ticks = 0;
+    uint64_t start = PlatformGetTicks();
+    while (queue->pending > 0) {
+        UpdateBlockTicks(world, 1.0f / BLOCK_TICK_RATE);
+        ticks++;
+    }
+    uint64_t elapsed = PlatformGetTicks() - start;
+    
+    int remaining = 0;
+    for (int y = 0; y < WORLD_HEIGHT; y++) {
+        for (int x = 0; x < WORLD_WIDTH; x++) {
+            if (world->blocks[y][x] == BLOCK_LEAVES) remaining++;
+        }
+    }
+    printf("{\"name\":\"%s\",\"ticks\":%d,\"updates\":%llu,\"max_updates_per_tick\":%u,\"leaves_before\":%d,"
+           "\"leaves_after\":%d,\"tick_mean_ns\":%.1f,\"update_mean_ns\":%.1f}\n",
+           name, ticks, (unsigned long long)queue->processedTotal, queue->maxProcessedPerTick, leaves, remaining,
+           ticks > 0 ? (double)elapsed / ticks : 0.0,
+           queue->processedTotal > 0 ? (double)elapsed / queue->processedTotal : 0.0);
+    fflush(stdout);
+}
+
+// Random ticks over a fresh world, then over the same world turned to
+// stone, where no region has anything to tick. The cost is bounded by the
+// region count either way and drops to the scan of the counts.
+static void RunRandomTickScenario(const BenchOptions* options, World* world, bool inert) {
+    const char* name = inert ? "BlockUpdates/random/inert" : "BlockUpdates/random/fresh";
+    if (options->filter != NULL && strstr(name, options->filter) == NULL) return;
+    
+    InitGame(world, BENCH_SEED);
+    if (inert) {
+        for (int y = 0; y < WORLD_HEIGHT; y++) {
+            for (int x = 0; x < WORLD_WIDTH; x++) {
+                world->blocks[y][x] = BLOCK_STONE;
+            }
+        }
+        RebuildBlockPlanes(world);
+        ResetBlockUpdates(world);
+    }
+    
+    BlockUpdateQueue* queue = world->blockUpdates;
+    const int ticks = 2000;
+    uint64_t start = PlatformGetTicks();
+    for (int i = 0; i < ticks; i++) {
+        UpdateBlockTicks(world, 1.0f / BLOCK_TICK_RATE);
+    }
+    uint64_t elapsed = PlatformGetTicks() - start;
+    
+    printf("{\"name\":\"%s\",\"ticks\":%d,\"regions\":%d,\"ticked_regions\":%d,\"random_ticks\":%llu,"
+           "\"updates\":%llu,\"tick_mean_ns\":%.1f}\n",
+           name, ticks, WORLD_REGION_ROWS * WORLD_REGION_COLUMNS, queue->randomRegionsLastTick,
+           (unsigned long long)queue->randomTicksTotal, (unsigned long long)queue->processedTotal,
+           (double)elapsed / ticks);
+    fflush(stdout);
+}
+
+// Digging and building around a follower's target: after each edit the
+// field is repaired, then built again from scratch for comparison. The
+// two must agree on every cell's distance.
+static void RunFlowFieldScenario(const BenchOptions* options, World* world) {
+    const char* name = "FlowField/edits";
+    if (options->filter != NULL && strstr(name, options->filter) == NULL) return;
+    
+    InitGame(world, BENCH_SEED);
+    int targetX, targetY;
+    if (!PickSpawnCell(world, SPAWN_SURFACE, &targetX, &targetY)) return;
+    static unsigned short repaired[FLOW_FIELD_WIDTH * FLOW_FIELD_HEIGHT];
+    AcquireFlowField(world, targetX, targetY);
+    
+    unsigned int state = BENCH_SEED;
+    uint64_t repairTime = 0;
+    uint64_t rebuildTime = 0;
+    int mismatches = 0;
+    for (int i = 0; i < BENCH_FLOW_EDITS; i++) {
+        state = state * 1664525u + 1013904223u;
+        int x = targetX + (int)(state >> 8) % (FLOW_FIELD_WIDTH - 1) - FLOW_FIELD_RADIUS_X;
+        state = state * 1664525u + 1013904223u;
+        int y = targetY + (int)(state >> 8) % (FLOW_FIELD_HEIGHT - 1) - FLOW_FIELD_RADIUS_Y;
+        if (x < 1 || x >= WORLD_WIDTH - 3 || y < 1 || y >= WORLD_HEIGHT - 2) continue;
+        BlockType block = TestBlockPlane(world, BLOCK_PLANE_SOLID, x, y) ? BLOCK_AIR : BLOCK_STONE;
+        if (i % 8 == 0) {
+            FillBlocks(world, x, y, x + 2, y + 1, block);
+        } else {
+            SetBlock(world, x, y, block);
+        }
+        
+        uint64_t start = PlatformGetTicks();
+        FlowField* field = AcquireFlowField(world, targetX, targetY);
+        repairTime += PlatformGetTicks() - start;
+        memcpy(repaired, field->distance, sizeof(repaired));
+        
+        ResetFlowFields(world);
+        start = PlatformGetTicks();
+        field = AcquireFlowField(world, targetX, targetY);
+        rebuildTime += PlatformGetTicks() - start;
+        if (memcmp(repaired, field->distance, sizeof(repaired)) != 0) mismatches++;
+    }
+    
+    printf("{\"name\":\"%s\",\"edits\":%d,\"repair_mean_ns\":%.1f,\"rebuild_mean_ns\":%.1f,\"mismatches\":%d,"
+           "\"ok\":%s}\n",
+           name, BENCH_FLOW_EDITS, (double)repairTime / BENCH_FLOW_EDITS, (double)rebuildTime / BENCH_FLOW_EDITS,
+           mismatches, mismatches == 0 ? "true" : "false");
+    fflush(stdout);
+}
+
+static double ElapsedMs(uint64_t start) {
+    return (PlatformGetTicks() - start) / 1000000.0;
+}
+
+// A million cells changed by whole-world fills, alternating stone and
+// dirt, then every kept edit undone and redone; the same million through
+// SetBlock one cell at a time for comparison
+static void RunWorldEditScenario(const BenchOptions* options, World* world) {
+    const char* name = "WorldEdit/million";
+    if (options->filter != NULL && strstr(name, options->filter) == NULL) return;
+    
+    InitGame(world, BENCH_SEED);
+    int fills = BENCH_EDIT_CELLS / (WORLD_WIDTH * WORLD_HEIGHT);
+    long long changed = 0;
+    uint64_t start = PlatformGetTicks();
+    for (int i = 0; i < fills; i++) {
+        changed += FillBlocks(world, 0, 0, WORLD_WIDTH - 1, WORLD_HEIGHT - 1, i & 1 ? BLOCK_DIRT : BLOCK_STONE);
+    }
+    double fillMs = ElapsedMs(start);
+    int historyBytes = world->editHistory->used;
+    
+    int undone = 0;
+    start = PlatformGetTicks();
+    while (UndoWorldEdit(world)) undone++;
+    double undoMs = ElapsedMs(start);
+    start = PlatformGetTicks();
+    while (RedoWorldEdit(world)) {}
+    double redoMs = ElapsedMs(start);
+    
+    start = PlatformGetTicks();
+    int flooded = FloodReplaceBlocks(world, 0, 0, BLOCK_WATER, WORLD_WIDTH * WORLD_HEIGHT);
+    double floodMs = ElapsedMs(start);
+    
+    InitGame(world, BENCH_SEED);
+    start = PlatformGetTicks();
+    for (int i = 0; i < fills; i++) {
+        for (int y = 0; y < WORLD_HEIGHT; y++) {
+            for (int x = 0; x < WORLD_WIDTH; x++) {
+                SetBlock(world, x, y, i & 1 ? BLOCK_DIRT : BLOCK_STONE);
+            }
+        }
+    }
+    double setBlockMs = ElapsedMs(start);
+    
+    printf("{\"name\":\"%s\",\"cells\":%lld,\"fill_ms\":%.3f,\"undone\":%d,\"history_bytes\":%d,\"undo_ms\":%.3f,"
+           "\"redo_ms\":%.3f,\"flooded\":%d,\"flood_ms\":%.3f,\"setblock_ms\":%.3f}\n",
+           name, changed, fillMs, undone, historyBytes, undoMs, redoMs, flooded, floodMs, setBlockMs);
+    fflush(stdout);
+}
+
+// A block of sand left hanging over a cleared valley, stepped until it has
+// settled, with 'threads' workers helping. The hash must not depend on the
+// worker count.
+static void RunSandPileScenario(const BenchOptions* options, World* world, int threads) {
+    char name[64];
+    snprintf(name, sizeof(name), "Granular/pile/threads=%d", threads);
+    if (options->filter != NULL && strstr(name, options->filter) == NULL) return;
+    
+    InitGame(world, BENCH_SEED);
+    int left = (WORLD_WIDTH - BENCH_PILE_WIDTH) / 2;
+    for (int y = 0; y < WORLD_HEIGHT * 2 / 3; y++) {
+        for (int x = left - 20; x < left + BENCH_PILE_WIDTH + 20; x++) {
+            BlockType block = y >= 2 && y < 2 + BENCH_PILE_HEIGHT && x >= left && x < left + BENCH_PILE_WIDTH ? BLOCK_SAND : BLOCK_AIR;
+            if (world->blocks[y][x] != block) SetBlock(world, x, y, block);
+        }
+    }
+    StartGranularWorkers(threads);
+    
+    GranularState* state = world->granular;
+    int steps = 0;
+    uint64_t total = 0;
+    uint64_t longest = 0;
+    do {
+        uint64_t start = PlatformGetTicks();
+        UpdateGranular(world, 1.0f / GRANULAR_STEP_RATE);
+        uint64_t elapsed = PlatformGetTicks() - start;
+        total += elapsed;
+        if (elapsed > longest) longest = elapsed;
+        steps++;
+    } while (state->movedLastStep > 0 && steps < 10000);
+    
+    uint64_t start = PlatformGetTicks();
+    UpdateGranular(world, 1.0f / GRANULAR_STEP_RATE);
+    uint64_t settled = PlatformGetTicks() - start;
+    
+    printf("{\"name\":\"%s\",\"workers\":%d,\"grains\":%d,\"steps\":%d,\"moves\":%llu,\"step_mean_ms\":%.3f,"
+           "\"step_max_ms\":%.3f,\"move_mean_ns\":%.1f,\"settled_step_ns\":%llu,\"hash\":\"%016llx\"}\n",
+           name, GetGranularWorkerCount(), BENCH_PILE_WIDTH * BENCH_PILE_HEIGHT, steps,
+           (unsigned long long)state->movedTotal, total / 1000000.0 / steps, longest / 1000000.0,
+           state->movedTotal > 0 ? (double)total / state->movedTotal : 0.0, (unsigned long long)settled,
+           (unsigned long long)HashWorldState(world));
+    fflush(stdout);
+    StopGranularWorkers();
+}
+
+static NetClient benchClients[MAX_PLAYERS];
+static World* benchClientWorlds[MAX_PLAYERS];
+
+// Scripted input for one bench client. Spread out, clients walk off in
+// alternating directions, each a little further than the last, before
+// they start digging; clustered, they all dig where they spawned.
+static unsigned int GetBenchClientInput(int index, int frame, bool spread) {
+    if (spread && frame < 90 * (1 + index / 2)) {
+        return 1u << (index % 2 ? INPUT_RIGHT : INPUT_LEFT) | 1u << INPUT_UP;
+    }
+    return 1u << INPUT_PRIMARY;
+}
+
+// A local server with 'clientCount' clients over loopback. Reports what
+// the server sent per tick; with interest management that should follow
+// how many players share a view, not the size of the map.
+static void RunNetScenario(const BenchOptions* options, int clientCount, bool spread) {
+    char name[64];
+    sprintf(name, "Net/%s/%d", spread ? "spread" : "clustered", clientCount);
+    if (options->filter != NULL && strstr(name, options->filter) == NULL) return;
+    
+    if (!ServerStart(BENCH_NET_PORT, BENCH_SEED)) {
+        printf("{\"name\":\"%s\",\"error\":\"could not start server\"}\n", name);
+        return;
+    }
+    
+    for (int i = 0; i < clientCount; i++) {
+        if (benchClientWorlds[i] == NULL) benchClientWorlds[i] = CreateWorld();
+        ClientConnect(&benchClients[i], benchClientWorlds[i], "127.0.0.1", BENCH_NET_PORT);
+    }
+    
+    int connected = 0;
+    for (int attempt = 0; attempt < 100 && connected < clientCount; attempt++) {
+        ServerTick();
+        connected = 0;
+        for (int i = 0; i < clientCount; i++) {
+            ClientReceive(&benchClients[i]);
+            connected += benchClients[i].connected;
+        }
+    }
+    
+    ServerStats before, after;
+    GetServerStats(&before);
+    for (int frame = 0; frame < BENCH_NET_TICKS; frame++) {
+        for (int i = 0; i < clientCount; i++) {
+            InputFrame* input = &benchClientWorlds[i]->input;
+            ApplyInputFrame(input, GetBenchClientInput(i, frame, spread), SCREEN_WIDTH / 2 + 24, SCREEN_HEIGHT / 2 + 24,
+                            0, 1.0f / NET_TICK_RATE);
+            ClientSendInput(&benchClients[i], input);
+        }
+        ServerTick();
+        for (int i = 0; i < clientCount; i++) {
+            ClientReceive(&benchClients[i]);
+        }
+    }
+    GetServerStats(&after);
+    
+    double ticks = after.ticks - before.ticks;
+    double bytes = (double)(after.bytesSent - before.bytesSent);
+    printf("{\"name\":\"%s\",\"clients\":%d,\"ticks\":%d,\"out_bytes_per_tick\":%.1f,\"out_bytes_per_client_tick\":%.1f,"
+           "\"block_bytes_per_tick\":%.1f,\"snapshot_bytes_per_tick\":%.1f,\"tick_mean_ns\":%.1f}\n",
+           name, connected, (int)ticks, bytes / ticks, bytes / ticks / clientCount,
+           (after.blockBytesSent - before.blockBytesSent) / ticks, (after.snapshotBytesSent - before.snapshotBytesSent) / ticks,
+           (after.tickNanos - before.tickNanos) / ticks);
+    fflush(stdout);
+    
+    for (int i = 0; i < clientCount; i++) {
+        ClientDisconnect(&benchClients[i]);
+    }
+    ServerTick();
+    ServerStop();
+}
+
+// One client against a local server over a simulated link, in real time.
+// The player spawns in mid-air and falls straight down; a little later it
+// starts walking right, and the time from that input until the drawn
+// player moves sideways is the input-to-screen latency.
+static void RunLatencyScenario(const BenchOptions* options, int roundTripMs, int lossPercent, bool predict) {
+    char name[64];
+    sprintf(name, "Net/latency/%dms/loss%d/%s", roundTripMs, lossPercent, predict ? "predicted" : "unpredicted");
+    if (options->filter != NULL && strstr(name, options->filter) == NULL) return;
+    
+    if (!ServerStart(BENCH_NET_PORT, BENCH_SEED)) {
+        printf("{\"name\":\"%s\",\"error\":\"could not start server\"}\n", name);
+        return;
+    }
+    
+    NetClient* client = &benchClients[0];
+    if (benchClientWorlds[0] == NULL) benchClientWorlds[0] = CreateWorld();
+    World* world = benchClientWorlds[0];
+    ClientConnect(client, world, "127.0.0.1", BENCH_NET_PORT);
+    client->predict = predict;
+    ClientSimulateLink(client, roundTripMs / 1000.0, 0, lossPercent / 100.0f);
+    
+    double frameTime = 1.0 / NET_TICK_RATE;
+    double start = NetGetTime();
+    while (!client->connected && NetGetTime() - start < 2.0) {
+        ServerTick();
+        ClientReceive(client);
+        PlatformSleep(1000000);
+    }
+    
+    double pressTime = 0;
+    double seenTime = -1;
+    int seenFrames = -1;
+    float startX = 0;
+    double nextFrame = NetGetTime();
+    for (int frame = 0; frame < BENCH_LATENCY_FRAMES; frame++) {
+        bool walking = frame >= BENCH_LATENCY_SETTLE_FRAMES;
+        if (frame == BENCH_LATENCY_SETTLE_FRAMES) {
+            pressTime = NetGetTime();
+            startX = world->player.x;
+        }
+        
+        ApplyInputFrame(&world->input, walking ? 1u << INPUT_RIGHT : 0, SCREEN_WIDTH / 2, SCREEN_HEIGHT / 2, 0,
+                        (float)frameTime);
+        ClientSendInput(client, &world->input);
+        ServerTick();
+        ClientReceive(client);
+        
+        if (walking && seenTime < 0 && world->player.x != startX) {
+            seenTime = NetGetTime();
+            seenFrames = frame - BENCH_LATENCY_SETTLE_FRAMES;
+        }
+        
+        nextFrame += frameTime;
+        double wait = nextFrame - NetGetTime();
+        if (wait > 0) PlatformSleep((uint64_t)(wait * 1000000000.0));
+    }
+    
+    printf("{\"name\":\"%s\",\"round_trip_ms\":%.1f,\"input_to_screen_ms\":%.2f,\"input_to_screen_frames\":%d,"
+           "\"corrections\":%u,\"max_correction_px\":%.2f}\n",
+           name, client->channel.roundTripTime * 1000.0, seenTime >= 0 ? (seenTime - pressTime) * 1000.0 : -1.0,
+           seenFrames, client->corrections, client->maxCorrection);
+    fflush(stdout);
+    
+    ClientDisconnect(client);
+    ServerTick();
+    ServerStop();
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options = { BENCH_DEFAULT_RUNS, NULL };
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) {
+            options.runs = atoi(argv[++i]);
+            if (options.runs < 1) options.runs = 1;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        }
+    }
+    
+    benchWorld = CreateWorld();
+    if (benchWorld == NULL) return 1;
+    bool haveSaveDirectory = PlatformMakeTempDirectory("bench_save", benchSaveDirectory, sizeof(benchSaveDirectory));
+    bool haveTerrainDirectory = PlatformMakeTempDirectory("bench_terrain", benchTerrainDirectory, sizeof(benchTerrainDirectory));
+    InitGame(benchWorld, BENCH_SEED);
+    
+    RunBenchmark(&options, "GenerateWorld", NULL, BenchGenerateWorld, NULL, 1);
+    static int generationThreads[] = { 2, 4, 8 };
+    for (int i = 0; i < (int)(sizeof(generationThreads) / sizeof(generationThreads[0])); i++) {
+        char name[64];
+        sprintf(name, "GenerateWorld/threads=%d", generationThreads[i]);
+        RunBenchmark(&options, name, NULL, BenchGenerateWorldThreaded, &generationThreads[i], 1);
+    }
+    
+    // The same terrain mapped from the cache instead
+    BenchGenerateWorld(NULL);
+    if (haveTerrainDirectory && WriteTerrainCache(benchWorld, benchTerrainDirectory)) {
+        SetTerrainCacheDirectory(benchTerrainDirectory);
+        RunBenchmark(&options, "TerrainCache/load", NULL, BenchLoadTerrainCache, NULL, 1);
+        SetTerrainCacheDirectory(NULL);
+    }
+    
+    InitGame(benchWorld, BENCH_SEED);
+    
+    static CollisionContext collision;
+    unsigned int state = BENCH_SEED;
+    for (int i = 0; i < 1024; i++) {
+        state = state * 1664525u + 1013904223u;
+        collision.points[i][0] = (int)(state % (WORLD_WIDTH * BLOCK_SIZE));
+        state = state * 1664525u + 1013904223u;
+        collision.points[i][1] = (int)(state % (WORLD_HEIGHT * BLOCK_SIZE));
+    }
+    RunBenchmark(&options, "CheckCollision", NULL, BenchCheckCollision, &collision, 10000);
+    RunBenchmark(&options, "CheckAnimalCollision", NULL, BenchCheckAnimalCollision, &collision, 10000);
+    
+    // Fill every slot so the population sizes below are exact
+    while (benchWorld->animalCount < MAX_ANIMALS) {
+        int cellX, cellY;
+        if (!PickSpawnCell(benchWorld, SPAWN_SURFACE, &cellX, &cellY)) break;
+        SpawnAnimal(benchWorld, ANIMAL_PIG, cellX * BLOCK_SIZE, (cellY + 1) * BLOCK_SIZE - 16);
+    }
+    memcpy(baselineAnimals, benchWorld->animals, sizeof(baselineAnimals));
+    baselineRngState = benchWorld->rngState;
+    
+    static const int populations[] = { 1, 5, 10, MAX_ANIMALS };
+    for (int i = 0; i < (int)(sizeof(populations) / sizeof(populations[0])); i++) {
+        AnimalContext animals = { populations[i] };
+        char name[64];
+        sprintf(name, "UpdateAnimals/%d", populations[i]);
+        RunBenchmark(&options, name, SetupAnimals, BenchUpdateAnimals, &animals, 60);
+    }
+    
+    // The full herd again through each integration kernel this processor
+    // runs, then back to the widest
+    static const int simdWidths[] = { 1, 4, 8 };
+    for (int i = 0; i < (int)(sizeof(simdWidths) / sizeof(simdWidths[0])); i++) {
+        if (!SetAnimalSimdWidth(simdWidths[i])) continue;
+        AnimalContext animals = { MAX_ANIMALS };
+        char name[64];
+        sprintf(name, "UpdateAnimals/%d/simd=%d", MAX_ANIMALS, simdWidths[i]);
+        RunBenchmark(&options, name, SetupAnimals, BenchUpdateAnimals, &animals, 60);
+    }
+    
+    static float laneData[10][BENCH_ANIMAL_LANES];
+    AnimalLanes lanes = { laneData[0], laneData[1], laneData[2], laneData[3], laneData[4], laneData[5],
+                          laneData[6], laneData[7], laneData[8], laneData[9], BENCH_ANIMAL_LANES };
+    for (int i = 0; i < (int)(sizeof(simdWidths) / sizeof(simdWidths[0])); i++) {
+        if (!SetAnimalSimdWidth(simdWidths[i])) continue;
+        char name[64];
+        sprintf(name, "AnimalIntegrate/%d/simd=%d", BENCH_ANIMAL_LANES, simdWidths[i]);
+        RunBenchmark(&options, name, SetupAnimalLanes, BenchIntegrateAnimalLanes, &lanes, 100);
+    }
+    SetAnimalSimdWidth(0);
+    
+    RunBenchmark(&options, "AddToInventory", SetupInventory, BenchAddToInventory, NULL, 1);
+    
+    int craftable = 0;
+    InitPlayer(&benchWorld->player);
+    RunBenchmark(&options, "CanCraftTool", NULL, BenchCanCraftTool, &craftable, 1000);
+    
+    // Cursors within twice the reach of the player, who is on the surface
+    // with ground below and open sky above
+    static TargetingContext targeting;
+    for (int i = 0; i < 256; i++) {
+        state = state * 1664525u + 1013904223u;
+        targeting.cursors[i][0] = (short)(SCREEN_WIDTH / 2 + (int)(state % 400) - 200);
+        state = state * 1664525u + 1013904223u;
+        targeting.cursors[i][1] = (short)(SCREEN_HEIGHT / 2 + (int)(state % 400) - 200);
+    }
+    RunBenchmark(&options, "Targeting/UpdateBlockTarget", NULL, BenchUpdateBlockTarget, &targeting, 10000);
+    
+    static const int particleCounts[] = { 1000, 10000, 50000 };
+    for (int i = 0; i < (int)(sizeof(particleCounts) / sizeof(particleCounts[0])); i++) {
+        ParticleContext particles = { particleCounts[i], 0 };
+        char name[64];
+        sprintf(name, "Particles/update/%d", particleCounts[i]);
+        RunBenchmark(&options, name, SetupParticles, BenchUpdateParticles, &particles, 60);
+        sprintf(name, "Particles/drawlist/%d", particleCounts[i]);
+        RunBenchmark(&options, name, SetupParticles, BenchBuildParticleDrawList, &particles, 60);
+    }
+    ResetParticles(benchWorld);
+    
+    int frame = 0;
+    RunBenchmark(&options, "BuildWorldDrawList", NULL, BenchBuildWorldDrawList, &frame, 256);
+    
+    // Nothing queued, so only the random ticks: a tick should cost the same
+    // in any size of world
+    RunBenchmark(&options, "BlockUpdates/idle", NULL, BenchBlockTick, NULL, 1000);
+    
+    World* scratchWorld = CreateWorld();
+    if (scratchWorld != NULL) {
+        RunLeafDecayScenario(&options, scratchWorld);
+        RunFlowFieldScenario(&options, scratchWorld);
+        RunRandomTickScenario(&options, scratchWorld, false);
+        RunRandomTickScenario(&options, scratchWorld, true);
+        RunWorldEditScenario(&options, scratchWorld);
+        static const int sandThreads[] = { 0, 1, 3, 7 };
+        for (int i = 0; i < (int)(sizeof(sandThreads) / sizeof(sandThreads[0])); i++) {
+            RunSandPileScenario(&options, scratchWorld, sandThreads[i]);
+        }
+        RunCodecScenario(&options, scratchWorld, false);
+        RunCodecScenario(&options, scratchWorld, true);
+        DestroyWorld(scratchWorld);
+    }
+    
+    if (haveSaveDirectory && SaveInit(benchSaveDirectory)) {
+        RunBenchmark(&options, "RequestSave", SetupRequestSave, BenchRequestSave, NULL, 1);
+        RunSaveFrameScenario(&options, false);
+        RunSaveFrameScenario(&options, true);
+        
+        // One edited cell per region, so every region has a file to stream
+        SaveResult result;
+        WaitForSave();
+        PollSaveResult(benchWorld, &result);
+        for (int regionY = 0; regionY < WORLD_REGION_ROWS; regionY++) {
+            for (int regionX = 0; regionX < WORLD_REGION_COLUMNS; regionX++) {
+                SetBlock(benchWorld, regionX * REGION_SIZE, regionY * REGION_SIZE, BLOCK_WOOD);
+            }
+        }
+        RequestSave(benchWorld);
+        WaitForSave();
+        PollSaveResult(benchWorld, &result);
+        
+        World* streamWorld = CreateWorld();
+        if (streamWorld != NULL) {
+            RunStreamScenario(&options, streamWorld, false);
+            RunStreamScenario(&options, streamWorld, true);
+            RunStreamRoundTripScenario(&options, streamWorld);
+            DestroyWorld(streamWorld);
+        }
+        SaveShutdown();
+    }
+    
+    static const int clientCounts[] = { 1, 4, MAX_PLAYERS };
+    for (int i = 0; i < (int)(sizeof(clientCounts) / sizeof(clientCounts[0])); i++) {
+        RunNetScenario(&options, clientCounts[i], true);
+    }
+    RunNetScenario(&options, MAX_PLAYERS, false);
+    
+    static const int roundTrips[] = { 50, 100, 200 };
+    for (int i = 0; i < (int)(sizeof(roundTrips) / sizeof(roundTrips[0])); i++) {
+        RunLatencyScenario(&options, roundTrips[i], 0, true);
+        RunLatencyScenario(&options, roundTrips[i], 0, false);
+    }
+    RunLatencyScenario(&options, 100, 5, true);
+    
+    // Persistent memory per subsystem, and the deepest frame scratch use
+    for (int tag = 0; tag < MEMORY_TAG_COUNT; tag++) {
+        if (benchWorld->memory.tagBytes[tag] == 0) continue;
+        printf("{\"memory\":\"%s\",\"bytes\":%u}\n", GetMemoryTagName((MemoryTag)tag),
+               (unsigned int)benchWorld->memory.tagBytes[tag]);
+    }
+    printf("{\"memory\":\"Frame peak\",\"bytes\":%u}\n", (unsigned int)benchWorld->frameMemory.peak);
+    
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (benchClientWorlds[i] != NULL) DestroyWorld(benchClientWorlds[i]);
+    }
+    DestroyWorld(benchWorld);
+    if (haveSaveDirectory) PlatformRemoveDirectory(benchSaveDirectory);
+    if (haveTerrainDirectory) PlatformRemoveDirectory(benchTerrainDirectory);
+    return 0;
+}
@@ -14,6 +14,18 @@ newoption
     default = "opengl33"
 }
 
+newoption
+{
+    trigger = "profiler",
+    description = "Compile the frame profiler into Release builds (always on in Debug)"
+}
+
+newoption
+{
+    trigger = "avx2",
+    description = "Build the game with AVX2 enabled (8-wide particle kernel; animals pick AVX2 at run time regardless)"
+}
+
 function download_progress(total, current)
     local ratio = current / total;
     ratio = math.min(math.max(ratio, 0), 1);
@@ -86,6 +98,51 @@ function platform_defines()
     filter{}
 end
 
+-- settings shared by every project that compiles the game sources
+function game_settings()
+    includedirs { "../src" }
+    includedirs { "../include" }
+
+    links {"raylib"}
+
+    cdialect "C17"
+    cppdialect "C++17"
+
+    includedirs {raylib_dir .. "/src" }
+    includedirs {raylib_dir .."/src/external" }
+    includedirs { raylib_dir .."/src/external/glfw/include" }
+    flags { "ShadowedVariables"}
+    platform_defines()
+
+    filter {"options:avx2", "platforms:x64 or x86"}
+        vectorextensions "AVX2"
+
+    filter {"options:profiler"}
+        defines { "ENABLE_PROFILER" }
+
+    filter{}
+
+    filter "action:vs*"
+        defines{"_WINSOCK_DEPRECATED_NO_WARNINGS", "_CRT_SECURE_NO_WARNINGS"}
+        dependson {"raylib"}
+        links {"raylib.lib"}
+        characterset ("Unicode")
+        buildoptions { "/Zc:__cplusplus" }
+
+    filter "system:windows"
+        defines{"_WIN32"}
+        links {"winmm", "gdi32", "opengl32", "ws2_32"}
+        libdirs {"../bin/%{cfg.buildcfg}"}
+
+    filter "system:linux"
+        links {"pthread", "m", "dl", "rt", "X11"}
+
+    filter "system:macosx"
+        links {"OpenGL.framework", "Cocoa.framework", "IOKit.framework", "CoreFoundation.framework", "CoreAudio.framework", "CoreVideo.framework", "AudioToolbox.framework"}
+
+    filter{}
+end
+
 -- if you don't want to download raylib, then set this to false, and set the raylib dir to where you want raylib to be pulled from, must be full sources.
 downloadRaylib = true
 raylib_dir = "external/raylib-master"
@@ -114,7 +171,7 @@ workspace (workspaceName)
     defaultplatform ("x64")
 
     filter "configurations:Debug or Debug_RGFW"
-        defines { "DEBUG" }
+        defines { "DEBUG", "ENABLE_PROFILER" }
         symbols "On"
 
     filter "configurations:Release or Release_RGFW"
@@ -169,40 +226,49 @@ if (downloadRaylib) then
 
         filter{}
         
-        includedirs { "../src" }
-        includedirs { "../include" }
+        game_settings()
+
+    project "benchmark"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
 
-        links {"raylib"}
+        filter "action:vs*"
+            debugdir "$(SolutionDir)"
 
-        cdialect "C17"
-        cppdialect "C++17"
+        filter{}
 
-        includedirs {raylib_dir .. "/src" }
-        includedirs {raylib_dir .."/src/external" }
-        includedirs { raylib_dir .."/src/external/glfw/include" }
-        flags { "ShadowedVariables"}
-        platform_defines()
+        vpaths
+        {
+            ["Header Files/*"] = { "../include/**.h", "../src/**.h"},
+            ["Source Files/*"] = {"../src/**.c", "../bench/**.c"},
+        }
 
-        filter "action:vs*"
-            defines{"_WINSOCK_DEPRECATED_NO_WARNINGS", "_CRT_SECURE_NO_WARNINGS"}
-            dependson {"raylib"}
-            links {"raylib.lib"}
-            characterset ("Unicode")
-            buildoptions { "/Zc:__cplusplus" }
+        files {"../src/**.c", "../src/**.h", "../include/**.h", "../bench/**.c"}
+        removefiles {"../src/main.c"}
 
-        filter "system:windows"
-            defines{"_WIN32"}
-            links {"winmm", "gdi32", "opengl32"}
-            libdirs {"../bin/%{cfg.buildcfg}"}
+        game_settings()
 
-        filter "system:linux"
-            links {"pthread", "m", "dl", "rt", "X11"}
+    project "pregen"
+        kind "ConsoleApp"
+        location "build_files/"
+        targetdir "../bin/%{cfg.buildcfg}"
 
-        filter "system:macosx"
-            links {"OpenGL.framework", "Cocoa.framework", "IOKit.framework", "CoreFoundation.framework", "CoreAudio.framework", "CoreVideo.framework", "AudioToolbox.framework"}
+        filter "action:vs*"
+            debugdir "$(SolutionDir)"
 
         filter{}
-        
+
+        vpaths
+        {
+            ["Header Files/*"] = { "../include/**.h", "../src/**.h"},
+            ["Source Files/*"] = {"../src/**.c", "../tools/**.c"},
+        }
+
+        files {"../src/**.c", "../src/**.h", "../include/**.h", "../tools/**.c"}
+        removefiles {"../src/main.c"}
+
+        game_settings()
 
     project "raylib"
         kind "StaticLib"
@@ -1,4 +1,5 @@
 #include "game.h"
+#include "platform.h"
 #include <math.h>
 #include <stdlib.h>
 
@@ -8,271 +9,455 @@ bool CheckAnimalCollision(World* world, float x, float y, int width, int height)
     int blockX2 = (int)(x + width - 1) / BLOCK_SIZE;
     int blockY2 = (int)(y + height - 1) / BLOCK_SIZE;
     
-    for (int bx = blockX1; bx <= blockX2; bx++) {
-        for (int by = blockY1; by <= blockY2; by++) {
-            if (bx < 0 || bx >= WORLD_WIDTH || by < 0 || by >= WORLD_HEIGHT) {
-                return true;
-            }
-            if (IsBlockSolid(world->blocks[by][bx])) {
-                return true;
-            }
-        }
+    if (blockX1 < 0 || blockX2 >= WORLD_WIDTH || blockY1 < 0 || blockY2 >= WORLD_HEIGHT) {
+        return true;
     }
-    return false;
+    return AnyBlockPlaneInRect(world, BLOCK_PLANE_SOLID, blockX1, blockY1, blockX2, blockY2);
 }
 
 bool IsAnimalInWater(World* world, float x, float y, int width, int height) {
-    int blockX1 = (int)x / BLOCK_SIZE;
-    int blockY1 = (int)y / BLOCK_SIZE;
-    int blockX2 = (int)(x + width - 1) / BLOCK_SIZE;
-    int blockY2 = (int)(y + height - 1) / BLOCK_SIZE;
-    
-    for (int bx = blockX1; bx <= blockX2; bx++) {
-        for (int by = blockY1; by <= blockY2; by++) {
-            if (bx >= 0 && bx < WORLD_WIDTH && by >= 0 && by < WORLD_HEIGHT) {
-                if (world->blocks[by][bx] == BLOCK_WATER) {
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
+    return AnyBlockPlaneInRect(world, BLOCK_PLANE_LIQUID, (int)x / BLOCK_SIZE, (int)y / BLOCK_SIZE,
+                               (int)(x + width - 1) / BLOCK_SIZE, (int)(y + height - 1) / BLOCK_SIZE);
 }
 
-int FindGroundHeight(World* world, int x) {
-    for (int y = 0; y < WORLD_HEIGHT; y++) {
-        if (world->blocks[y][x] != BLOCK_AIR && world->blocks[y][x] != BLOCK_WATER) {
-            return y * BLOCK_SIZE - 16;
+static const AnimalType landAnimals[] = { ANIMAL_RABBIT, ANIMAL_BIRD, ANIMAL_PIG, ANIMAL_CHICKEN };
+
+// Places a new animal on a uniformly chosen valid spawn cell. Fish fall
+// back to a land animal when the world holds no water.
+static void SpawnAnimalAtRandomCell(World* world, AnimalType type) {
+    int cellX, cellY;
+    
+    if (type == ANIMAL_FISH) {
+        if (PickSpawnCell(world, SPAWN_WATER, &cellX, &cellY)) {
+            SpawnAnimal(world, type, cellX * BLOCK_SIZE + WorldRandom(world, 0, BLOCK_SIZE - 12),
+                        cellY * BLOCK_SIZE + WorldRandom(world, 0, BLOCK_SIZE - 8));
+            return;
         }
+        type = landAnimals[WorldRandom(world, 0, 3)];
+    }
+    
+    if (PickSpawnCell(world, SPAWN_SURFACE, &cellX, &cellY)) {
+        SpawnAnimal(world, type, cellX * BLOCK_SIZE + WorldRandom(world, 0, BLOCK_SIZE - 12),
+                    (cellY + 1) * BLOCK_SIZE - 16);
     }
-    return (WORLD_HEIGHT - 1) * BLOCK_SIZE;
 }
 
 void InitAnimals(World* world) {
     world->animalCount = 0;
+    PoolReset(&world->animalPool);
     
     for (int i = 0; i < MAX_ANIMALS; i++) {
         world->animals[i].alive = false;
     }
     
     for (int i = 0; i < 8; i++) {
-        AnimalType type = (AnimalType)GetRandomValue(0, ANIMAL_COUNT - 2);
-        float x = GetRandomValue(50, (WORLD_WIDTH - 50) * BLOCK_SIZE);
-        float y = FindGroundHeight(world, x / BLOCK_SIZE);
-        
-        SpawnAnimal(world, type, x, y);
+        SpawnAnimalAtRandomCell(world, landAnimals[WorldRandom(world, 0, 3)]);
     }
     
-    for (int i = 0; i < 6; i++) {
-        float x = GetRandomValue(50, (WORLD_WIDTH - 50) * BLOCK_SIZE);
-        float y = GetRandomValue(40, 80) * BLOCK_SIZE;
-        
-        for (int attempt = 0; attempt < 20; attempt++) {
-            x = GetRandomValue(50, (WORLD_WIDTH - 50) * BLOCK_SIZE);
-            y = GetRandomValue(40, 80) * BLOCK_SIZE;
-            if (IsAnimalInWater(world, x, y, 12, 8)) {
-                SpawnAnimal(world, ANIMAL_FISH, x, y);
-                break;
-            }
+    if (world->spawnSets[SPAWN_WATER].count > 0) {
+        for (int i = 0; i < 6; i++) {
+            SpawnAnimalAtRandomCell(world, ANIMAL_FISH);
         }
     }
 }
 
-void SpawnAnimal(World* world, AnimalType type, float x, float y) {
-    if (world->animalCount >= MAX_ANIMALS) return;
+// NULL when every slot is taken
+Animal* SpawnAnimal(World* world, AnimalType type, float x, float y) {
+    Animal* animal = (Animal*)PoolAlloc(&world->animalPool);
+    if (animal == NULL) return NULL;
     
-    for (int i = 0; i < MAX_ANIMALS; i++) {
-        if (!world->animals[i].alive) {
-            Animal* animal = &world->animals[i];
-            animal->type = type;
-            animal->x = x;
-            animal->y = y;
-            animal->velX = 0;
-            animal->velY = 0;
-            animal->state = AI_WANDER;
-            animal->stateTimer = GetRandomValue(2, 8);
-            animal->direction = GetRandomValue(0, 1) ? 1.0f : -1.0f;
-            animal->onGround = false;
-            animal->inWater = false;
-            animal->alive = true;
-            animal->animTime = 0;
-            world->animalCount++;
-            break;
-        }
+    animal->type = type;
+    animal->x = x;
+    animal->y = y;
+    animal->velX = 0;
+    animal->velY = 0;
+    animal->state = AI_WANDER;
+    animal->stateTimer = WorldRandom(world, 2, 8);
+    animal->direction = WorldRandom(world, 0, 1) ? 1.0f : -1.0f;
+    animal->onGround = false;
+    animal->inWater = false;
+    animal->alive = true;
+    animal->animTime = 0;
+    world->animalCount++;
+    return animal;
+}
+
+void DespawnAnimal(World* world, Animal* animal) {
+    animal->alive = false;
+    world->animalCount--;
+    PoolFree(&world->animalPool, animal);
+}
+
+#define FOLLOW_START_DISTANCE 256.0f
+#define FOLLOW_STOP_DISTANCE 384.0f
+
+// Land animals trail a player who holds leaves out in the hotbar
+static bool IsLuredBy(Animal* animal, Player* player) {
+    if (player == NULL) return false;
+    if (animal->type != ANIMAL_RABBIT && animal->type != ANIMAL_PIG && animal->type != ANIMAL_CHICKEN) {
+        return false;
     }
+    InventorySlot* slot = &player->hotbar.slots[player->selectedSlot];
+    return slot->tool == TOOL_NONE && slot->count > 0 && slot->type == BLOCK_LEAVES;
 }
 
 void UpdateAnimalAI(World* world, Animal* animal, float deltaTime) {
-    float playerDist = sqrt((animal->x - world->player.x) * (animal->x - world->player.x) + 
-                           (animal->y - world->player.y) * (animal->y - world->player.y));
+    Player* player = GetNearestPlayer(world, animal->x, animal->y);
+    float playerDist = INFINITY;
+    if (player != NULL) {
+        playerDist = sqrt((animal->x - player->x) * (animal->x - player->x) + 
+                          (animal->y - player->y) * (animal->y - player->y));
+    }
     
     animal->stateTimer -= deltaTime;
     animal->animTime += deltaTime;
     
     switch (animal->state) {
         case AI_WANDER:
-            if (playerDist < 80 && animal->type != ANIMAL_FISH) {
+            if (playerDist < FOLLOW_START_DISTANCE && IsLuredBy(animal, player)) {
+                animal->state = AI_FOLLOW;
+            } else if (playerDist < 80 && animal->type != ANIMAL_FISH) {
                 animal->state = AI_FLEE;
                 animal->stateTimer = 3.0f;
-                animal->direction = (animal->x > world->player.x) ? 1.0f : -1.0f;
+                animal->direction = (animal->x > player->x) ? 1.0f : -1.0f;
             } else if (animal->stateTimer <= 0) {
-                animal->direction = GetRandomValue(0, 1) ? 1.0f : -1.0f;
-                animal->stateTimer = GetRandomValue(2, 6);
+                animal->direction = WorldRandom(world, 0, 1) ? 1.0f : -1.0f;
+                animal->stateTimer = WorldRandom(world, 2, 6);
             }
             break;
             
         case AI_FLEE:
             if (playerDist > 120) {
                 animal->state = AI_WANDER;
-                animal->stateTimer = GetRandomValue(2, 8);
+                animal->stateTimer = WorldRandom(world, 2, 8);
             } else if (animal->stateTimer <= 0) {
                 animal->state = AI_WANDER;
-                animal->stateTimer = GetRandomValue(1, 3);
+                animal->stateTimer = WorldRandom(world, 1, 3);
+            }
+            break;
+            
+        case AI_FOLLOW:
+            if (playerDist > FOLLOW_STOP_DISTANCE || !IsLuredBy(animal, player)) {
+                animal->state = AI_WANDER;
+                animal->stateTimer = WorldRandom(world, 2, 8);
             }
             break;
             
         case AI_SWIM:
             if (!animal->inWater) {
                 animal->state = AI_WANDER;
-                animal->stateTimer = GetRandomValue(2, 8);
+                animal->stateTimer = WorldRandom(world, 2, 8);
             } else if (animal->stateTimer <= 0) {
-                animal->direction = GetRandomValue(0, 1) ? 1.0f : -1.0f;
-                animal->stateTimer = GetRandomValue(2, 5);
+                animal->direction = WorldRandom(world, 0, 1) ? 1.0f : -1.0f;
+                animal->stateTimer = WorldRandom(world, 2, 5);
             }
             break;
     }
 }
 
-void UpdateAnimalPhysics(World* world, Animal* animal, float deltaTime) {
-    float speed = 50.0f;
-    float jumpForce = 200.0f;
-    float gravity = 400.0f;
+typedef struct {
+    float speed;
+    float jumpForce;
+    float gravity;
+    int width;
+    int height;
+} AnimalPhysicsParams;
+
+static const AnimalPhysicsParams animalPhysics[ANIMAL_COUNT] = {
+    [ANIMAL_RABBIT]  = { 80.0f, 300.0f, 400.0f, 12, 12 },
+    [ANIMAL_BIRD]    = { 60.0f, 150.0f, 100.0f,  8, 12 },
+    [ANIMAL_FISH]    = { 40.0f, 200.0f,   0.0f, 12,  6 },
+    [ANIMAL_PIG]     = { 30.0f, 180.0f, 400.0f, 12, 12 },
+    [ANIMAL_CHICKEN] = { 50.0f, 250.0f, 400.0f, 12, 12 },
+};
+
+// The cloud an animal leaves where it dies. Clients call it for animals
+// that vanish from their snapshots, since the server's particles stay put.
+void EmitAnimalPuff(World* world, const Animal* animal) {
+    const AnimalPhysicsParams* params = &animalPhysics[animal->type];
+    EmitParticles(world, PARTICLE_PUFF, animal->x + params->width / 2, animal->y + params->height / 2, 10,
+                  GetAnimalColor(animal->type));
+}
+
+// The AVX2 kernel is built on any x86 compiler and only picked when the
+// processor has it, so a default build still runs 8 wide where it can
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#include <immintrin.h>
+#define ANIMAL_HAVE_AVX2 1
+#if defined(__GNUC__) && !defined(__AVX2__)
+#define ANIMAL_AVX2_TARGET __attribute__((target("avx2")))
+#else
+#define ANIMAL_AVX2_TARGET
+#endif
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ANIMAL_HAVE_SSE2 1
+#endif
+
+#define ANIMAL_BATCH_CAPACITY (((MAX_ANIMALS) + 7) & ~7)
+#define ANIMAL_MAX_FALL_SPEED 300.0f
+
+// Structure-of-arrays view of the live animals for one physics step.
+// The per-animal decisions (AI, random jumps, water checks) fill in the
+// velocity terms, then IntegrateAnimalLanes advances every lane at once:
+//   velX = velX * velXScale + velXDrive
+//   velY = velY * velYScale + gravity * dt   (clamped)
+//   newX = x + velX * dt, newY = y + velY * dt
+typedef struct {
+    float x[ANIMAL_BATCH_CAPACITY];
+    float y[ANIMAL_BATCH_CAPACITY];
+    float velX[ANIMAL_BATCH_CAPACITY];
+    float velY[ANIMAL_BATCH_CAPACITY];
+    float velXScale[ANIMAL_BATCH_CAPACITY];
+    float velXDrive[ANIMAL_BATCH_CAPACITY];
+    float velYScale[ANIMAL_BATCH_CAPACITY];
+    float gravity[ANIMAL_BATCH_CAPACITY];
+    float newX[ANIMAL_BATCH_CAPACITY];
+    float newY[ANIMAL_BATCH_CAPACITY];
+    int index[ANIMAL_BATCH_CAPACITY];
+    int count;
+} AnimalBatch;
+
+#if defined(ANIMAL_HAVE_AVX2)
+static ANIMAL_AVX2_TARGET int IntegrateAnimalsAvx2(const AnimalLanes* lanes, float deltaTime) {
+    int i = 0;
+    __m256 dt = _mm256_set1_ps(deltaTime);
+    __m256 maxVel = _mm256_set1_ps(ANIMAL_MAX_FALL_SPEED);
+    __m256 minVel = _mm256_set1_ps(-ANIMAL_MAX_FALL_SPEED);
+    for (; i + 8 <= lanes->count; i += 8) {
+        __m256 velX = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&lanes->velX[i]), _mm256_loadu_ps(&lanes->velXScale[i])),
+                                    _mm256_loadu_ps(&lanes->velXDrive[i]));
+        __m256 velY = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(&lanes->velY[i]), _mm256_loadu_ps(&lanes->velYScale[i])),
+                                    _mm256_mul_ps(_mm256_loadu_ps(&lanes->gravity[i]), dt));
+        velY = _mm256_min_ps(_mm256_max_ps(velY, minVel), maxVel);
+        _mm256_storeu_ps(&lanes->velX[i], velX);
+        _mm256_storeu_ps(&lanes->velY[i], velY);
+        _mm256_storeu_ps(&lanes->newX[i], _mm256_add_ps(_mm256_loadu_ps(&lanes->x[i]), _mm256_mul_ps(velX, dt)));
+        _mm256_storeu_ps(&lanes->newY[i], _mm256_add_ps(_mm256_loadu_ps(&lanes->y[i]), _mm256_mul_ps(velY, dt)));
+    }
+    return i;
+}
+#endif
+
+#if defined(ANIMAL_HAVE_SSE2)
+static int IntegrateAnimalsSse2(const AnimalLanes* lanes, float deltaTime) {
+    int i = 0;
+    __m128 dt = _mm_set1_ps(deltaTime);
+    __m128 maxVel = _mm_set1_ps(ANIMAL_MAX_FALL_SPEED);
+    __m128 minVel = _mm_set1_ps(-ANIMAL_MAX_FALL_SPEED);
+    for (; i + 4 <= lanes->count; i += 4) {
+        __m128 velX = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&lanes->velX[i]), _mm_loadu_ps(&lanes->velXScale[i])),
+                                 _mm_loadu_ps(&lanes->velXDrive[i]));
+        __m128 velY = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&lanes->velY[i]), _mm_loadu_ps(&lanes->velYScale[i])),
+                                 _mm_mul_ps(_mm_loadu_ps(&lanes->gravity[i]), dt));
+        velY = _mm_min_ps(_mm_max_ps(velY, minVel), maxVel);
+        _mm_storeu_ps(&lanes->velX[i], velX);
+        _mm_storeu_ps(&lanes->velY[i], velY);
+        _mm_storeu_ps(&lanes->newX[i], _mm_add_ps(_mm_loadu_ps(&lanes->x[i]), _mm_mul_ps(velX, dt)));
+        _mm_storeu_ps(&lanes->newY[i], _mm_add_ps(_mm_loadu_ps(&lanes->y[i]), _mm_mul_ps(velY, dt)));
+    }
+    return i;
+}
+#endif
+
+// 0 until the first batch, or SetAnimalSimdWidth, picks one
+static int animalSimdWidth;
+
+int GetAnimalSimdWidth(void) {
+    if (animalSimdWidth == 0) SetAnimalSimdWidth(0);
+    return animalSimdWidth;
+}
+
+// Picks the kernel by lane count: 8 for AVX2, 4 for SSE2, 1 for plain
+// code, or 0 for the widest this processor runs. False, changing nothing,
+// when the width asked for is not available here.
+bool SetAnimalSimdWidth(int width) {
+    bool haveAvx2 = false;
+    bool haveSse2 = false;
+#if defined(ANIMAL_HAVE_AVX2)
+    haveAvx2 = PlatformHasAvx2();
+#endif
+#if defined(ANIMAL_HAVE_SSE2)
+    haveSse2 = true;
+#endif
     
-    switch (animal->type) {
-        case ANIMAL_RABBIT:
-            speed = 80.0f;
-            jumpForce = 300.0f;
-            break;
-        case ANIMAL_BIRD:
-            speed = 60.0f;
-            gravity = 100.0f;
-            jumpForce = 150.0f;
-            break;
-        case ANIMAL_FISH:
-            speed = 40.0f;
-            gravity = 0.0f;
+    if (width == 0) width = haveAvx2 ? 8 : haveSse2 ? 4 : 1;
+    if ((width == 8 && !haveAvx2) || (width == 4 && !haveSse2) || (width != 1 && width != 4 && width != 8)) return false;
+    animalSimdWidth = width;
+    return true;
+}
+
+void IntegrateAnimalLanes(const AnimalLanes* lanes, float deltaTime) {
+    int i = 0;
+    
+    switch (GetAnimalSimdWidth()) {
+#if defined(ANIMAL_HAVE_AVX2)
+        case 8:
+            i = IntegrateAnimalsAvx2(lanes, deltaTime);
             break;
-        case ANIMAL_PIG:
-            speed = 30.0f;
-            jumpForce = 180.0f;
+#endif
+#if defined(ANIMAL_HAVE_SSE2)
+        case 4:
+            i = IntegrateAnimalsSse2(lanes, deltaTime);
             break;
-        case ANIMAL_CHICKEN:
-            speed = 50.0f;
-            jumpForce = 250.0f;
+#endif
+        default:
             break;
     }
     
-    int animalWidth = (animal->type == ANIMAL_BIRD) ? 8 : 12;
-    int animalHeight = (animal->type == ANIMAL_FISH) ? 6 : 12;
+    // Scalar tail, and every lane when no vector unit is available
+    for (; i < lanes->count; i++) {
+        float velX = lanes->velX[i] * lanes->velXScale[i] + lanes->velXDrive[i];
+        float velY = lanes->velY[i] * lanes->velYScale[i] + lanes->gravity[i] * deltaTime;
+        if (velY > ANIMAL_MAX_FALL_SPEED) velY = ANIMAL_MAX_FALL_SPEED;
+        if (velY < -ANIMAL_MAX_FALL_SPEED) velY = -ANIMAL_MAX_FALL_SPEED;
+        lanes->velX[i] = velX;
+        lanes->velY[i] = velY;
+        lanes->newX[i] = lanes->x[i] + velX * deltaTime;
+        lanes->newY[i] = lanes->y[i] + velY * deltaTime;
+    }
+}
+
+// Decides this frame's drive, jump and gravity terms for one animal and
+// appends it to the batch. Returns false if the animal died instead.
+static bool PrepareAnimalPhysics(World* world, Animal* animal, AnimalBatch* batch, int index) {
+    const AnimalPhysicsParams* params = &animalPhysics[animal->type];
     
-    animal->inWater = IsAnimalInWater(world, animal->x, animal->y, animalWidth, animalHeight);
+    animal->inWater = IsAnimalInWater(world, animal->x, animal->y, params->width, params->height);
     
     if (animal->type == ANIMAL_FISH && !animal->inWater) {
-        animal->alive = false;
-        world->animalCount--;
-        return;
+        EmitAnimalPuff(world, animal);
+        DespawnAnimal(world, animal);
+        return false;
     }
     
+    int lane = batch->count++;
+    batch->index[lane] = index;
+    batch->x[lane] = animal->x;
+    batch->y[lane] = animal->y;
+    batch->velY[lane] = animal->velY;
+    batch->velYScale[lane] = 1.0f;
+    batch->gravity[lane] = 0.0f;
+    
     if (animal->type == ANIMAL_FISH) {
         animal->state = AI_SWIM;
-        animal->velX = animal->direction * speed;
-        if (GetRandomValue(0, 100) < 5) {
-            animal->velY = GetRandomValue(-50, 50);
+        batch->velX[lane] = 0.0f;
+        batch->velXScale[lane] = 0.0f;
+        batch->velXDrive[lane] = animal->direction * params->speed;
+        if (WorldRandom(world, 0, 100) < 5) {
+            batch->velY[lane] = WorldRandom(world, -50, 50);
         }
     } else {
-        if (animal->state == AI_FLEE || (animal->state == AI_WANDER && GetRandomValue(0, 100) < 50)) {
-            animal->velX = animal->direction * speed;
+        batch->velX[lane] = animal->velX;
+        FlowMove move = FLOW_NONE;
+        
+        Player* player = GetNearestPlayer(world, animal->x, animal->y);
+        if (animal->state == AI_FOLLOW && player != NULL) {
+            int targetX = (int)(player->x + 8) / BLOCK_SIZE;
+            int targetY = (int)(player->y + 31) / BLOCK_SIZE;
+            int cellX = (int)(animal->x + params->width / 2) / BLOCK_SIZE;
+            int cellY = (int)(animal->y + params->height - 1) / BLOCK_SIZE;
+            move = GetFlowMove(world, targetX, targetY, cellX, cellY);
+            
+            if (move == FLOW_LEFT || move == FLOW_JUMP_LEFT) animal->direction = -1.0f;
+            if (move == FLOW_RIGHT || move == FLOW_JUMP_RIGHT) animal->direction = 1.0f;
+        }
+        
+        if (animal->state == AI_FLEE || (animal->state == AI_WANDER && WorldRandom(world, 0, 100) < 50) ||
+            (move != FLOW_NONE && move != FLOW_ARRIVED)) {
+            batch->velXScale[lane] = 0.0f;
+            batch->velXDrive[lane] = animal->direction * params->speed;
         } else {
-            animal->velX *= 0.9f;
+            batch->velXScale[lane] = 0.9f;
+            batch->velXDrive[lane] = 0.0f;
         }
         
-        if (animal->type == ANIMAL_BIRD && GetRandomValue(0, 100) < 10) {
-            animal->velY = -jumpForce;
-        } else if (animal->onGround && GetRandomValue(0, 100) < 5 && animal->type == ANIMAL_RABBIT) {
-            animal->velY = -jumpForce;
+        if ((move == FLOW_JUMP_LEFT || move == FLOW_JUMP_RIGHT) && animal->onGround) {
+            batch->velY[lane] = -params->jumpForce;
+        } else if (animal->type == ANIMAL_BIRD && WorldRandom(world, 0, 100) < 10) {
+            batch->velY[lane] = -params->jumpForce;
+        } else if (animal->onGround && WorldRandom(world, 0, 100) < 5 && animal->type == ANIMAL_RABBIT) {
+            batch->velY[lane] = -params->jumpForce;
         }
         
         if (!animal->inWater) {
-            animal->velY += gravity * deltaTime;
+            batch->gravity[lane] = params->gravity;
         } else {
-            animal->velY *= 0.8f;
-            animal->velY += gravity * deltaTime * 0.3f;
+            batch->velYScale[lane] = 0.8f;
+            batch->gravity[lane] = params->gravity * 0.3f;
         }
     }
     
-    if (animal->velY > 300.0f) animal->velY = 300.0f;
-    if (animal->velY < -300.0f) animal->velY = -300.0f;
+    return true;
+}
+
+// Gather step: sweeps each animal from its old to its integrated position
+// and writes the results back.
+static void ResolveAnimalCollision(World* world, Animal* animal, const AnimalBatch* batch, int lane) {
+    const AnimalPhysicsParams* params = &animalPhysics[animal->type];
     
-    float newX = animal->x + animal->velX * deltaTime;
-    float newY = animal->y + animal->velY * deltaTime;
+    animal->velX = batch->velX[lane];
+    animal->velY = batch->velY[lane];
     
-    if (!CheckAnimalCollision(world, newX, animal->y, animalWidth, animalHeight)) {
-        animal->x = newX;
-    } else {
+    BoxMoveResult move = MoveBox(world, &animal->x, &animal->y, params->width, params->height,
+                                 batch->newX[lane] - animal->x, batch->newY[lane] - animal->y);
+    
+    if (move.hitX) {
         animal->velX = 0;
         animal->direction *= -1;
     }
     
-    if (!CheckAnimalCollision(world, animal->x, newY, animalWidth, animalHeight)) {
-        animal->y = newY;
-        animal->onGround = false;
-    } else {
+    if (move.hitY) {
         if (animal->velY > 0) {
             animal->onGround = true;
         }
         animal->velY = 0;
+    } else {
+        animal->onGround = false;
     }
     
     if (animal->x < 0 || animal->x > WORLD_WIDTH * BLOCK_SIZE || 
         animal->y > WORLD_HEIGHT * BLOCK_SIZE) {
-        animal->alive = false;
-        world->animalCount--;
+        EmitAnimalPuff(world, animal);
+        DespawnAnimal(world, animal);
     }
 }
 
+void UpdateAnimalPhysics(World* world, float deltaTime) {
+    size_t scratchMark = ArenaMark(&world->frameMemory);
+    AnimalBatch* batch = (AnimalBatch*)ArenaAlloc(&world->frameMemory, sizeof(AnimalBatch), MEMORY_PHYSICS);
+    if (batch == NULL) return;
+    batch->count = 0;
+    
+    for (int i = 0; i < MAX_ANIMALS; i++) {
+        if (world->animals[i].alive) {
+            PrepareAnimalPhysics(world, &world->animals[i], batch, i);
+        }
+    }
+    
+    AnimalLanes lanes = { batch->x, batch->y, batch->velX, batch->velY, batch->velXScale, batch->velXDrive,
+                          batch->velYScale, batch->gravity, batch->newX, batch->newY, batch->count };
+    IntegrateAnimalLanes(&lanes, deltaTime);
+    
+    for (int lane = 0; lane < batch->count; lane++) {
+        ResolveAnimalCollision(world, &world->animals[batch->index[lane]], batch, lane);
+    }
+    
+    ArenaRewind(&world->frameMemory, scratchMark);
+}
+
 void UpdateAnimals(World* world, float deltaTime) {
     for (int i = 0; i < MAX_ANIMALS; i++) {
         if (world->animals[i].alive) {
             UpdateAnimalAI(world, &world->animals[i], deltaTime);
-            UpdateAnimalPhysics(world, &world->animals[i], deltaTime);
         }
     }
     
-    if (world->animalCount < 12 && GetRandomValue(0, 1000) < 3) {
-        AnimalType type = (AnimalType)GetRandomValue(0, ANIMAL_COUNT - 1);
-        float x = GetRandomValue(50, (WORLD_WIDTH - 50) * BLOCK_SIZE);
-        float y = FindGroundHeight(world, x / BLOCK_SIZE);
-        
-        if (type == ANIMAL_FISH) {
-            bool spawned = false;
-            for (int attempt = 0; attempt < 15; attempt++) {
-                x = GetRandomValue(50, (WORLD_WIDTH - 50) * BLOCK_SIZE);
-                y = GetRandomValue(40, 80) * BLOCK_SIZE;
-                if (IsAnimalInWater(world, x, y, 12, 8)) {
-                    SpawnAnimal(world, type, x, y);
-                    spawned = true;
-                    break;
-                }
-            }
-            if (!spawned) {
-                type = (AnimalType)GetRandomValue(0, ANIMAL_COUNT - 2);
-                x = GetRandomValue(50, (WORLD_WIDTH - 50) * BLOCK_SIZE);
-                y = FindGroundHeight(world, x / BLOCK_SIZE);
-                SpawnAnimal(world, type, x, y);
-            }
-        } else {
-            SpawnAnimal(world, type, x, y);
-        }
+    UpdateAnimalPhysics(world, deltaTime);
+    
+    if (world->animalCount < 12 && WorldRandom(world, 0, 1000) < 3) {
+        SpawnAnimalAtRandomCell(world, (AnimalType)WorldRandom(world, 0, ANIMAL_COUNT - 1));
     }
 }
 
@@ -309,8 +494,8 @@ void DrawAnimals(World* world) {
             Animal* animal = &world->animals[i];
             Color color = GetAnimalColor(animal->type);
             
-            int width = (animal->type == ANIMAL_BIRD) ? 8 : 12;
-            int height = (animal->type == ANIMAL_FISH) ? 6 : 12;
+            int width = animalPhysics[animal->type].width;
+            int height = animalPhysics[animal->type].height;
             
             Rectangle animalRect = { animal->x, animal->y, width, height };
             DrawRectangleRec(animalRect, color);
@@ -0,0 +1,135 @@
+#include "game.h"
+#include <string.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+int CountTrailingZeros64(uint64_t bits) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int)index;
+#elif defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(bits);
+#else
+    int index = 0;
+    while (!((bits >> index) & 1)) index++;
+    return index;
+#endif
+}
+
+int CountBits64(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(bits);
+#else
+    int count = 0;
+    for (; bits != 0; bits &= bits - 1) count++;
+    return count;
+#endif
+}
+
+void UpdateBlockPlanes(World* world, int x, int y, BlockType block) {
+    unsigned int mask = GetBlockPlaneMask(block);
+    uint64_t bit = (uint64_t)1 << (x & 63);
+    int word = x >> 6;
+    
+    for (int plane = 0; plane < BLOCK_PLANE_COUNT; plane++) {
+        if (mask & (1u << plane)) {
+            world->blockPlanes[plane][y][word] |= bit;
+        } else {
+            world->blockPlanes[plane][y][word] &= ~bit;
+        }
+    }
+}
+
+void RebuildBlockPlanes(World* world) {
+    memset(world->blockPlanes, 0, sizeof(world->blockPlanes));
+    UpdateBlockPlaneRect(world, 0, 0, WORLD_WIDTH - 1, WORLD_HEIGHT - 1);
+}
+
+bool TestBlockPlane(World* world, BlockPlane plane, int x, int y) {
+    return (world->blockPlanes[plane][y][x >> 6] >> (x & 63)) & 1;
+}
+
+// Bits x1..x2 (inclusive) of the given row word
+static uint64_t RowWordMask(int word, int x1, int x2) {
+    int lo = x1 - word * 64;
+    int hi = x2 - word * 64;
+    if (lo < 0) lo = 0;
+    if (hi > 63) hi = 63;
+    uint64_t upper = (hi == 63) ? ~(uint64_t)0 : (((uint64_t)1 << (hi + 1)) - 1);
+    return upper & ~(((uint64_t)1 << lo) - 1);
+}
+
+// Rederives the planes for a rectangle of cells, for edits that have
+// already stored many blocks. Each word is built up and merged once.
+void UpdateBlockPlaneRect(World* world, int x1, int y1, int x2, int y2) {
+    unsigned int masks[BLOCK_COUNT];
+    for (int block = 0; block < BLOCK_COUNT; block++) {
+        masks[block] = GetBlockPlaneMask((BlockType)block);
+    }
+    
+    for (int y = y1; y <= y2; y++) {
+        for (int word = x1 >> 6; word <= (x2 >> 6); word++) {
+            uint64_t bits[BLOCK_PLANE_COUNT] = { 0 };
+            int first = word * 64 > x1 ? word * 64 : x1;
+            int last = word * 64 + 63 < x2 ? word * 64 + 63 : x2;
+            // By runs of one block, which is most of any row
+            for (int x = first; x <= last;) {
+                BlockType block = world->blocks[y][x];
+                int end = x;
+                while (end < last && world->blocks[y][end + 1] == block) end++;
+                uint64_t run = RowWordMask(word, x, end);
+                for (int plane = 0; plane < BLOCK_PLANE_COUNT; plane++) {
+                    if (masks[block] & (1u << plane)) bits[plane] |= run;
+                }
+                x = end + 1;
+            }
+            
+            uint64_t keep = ~RowWordMask(word, x1, x2);
+            for (int plane = 0; plane < BLOCK_PLANE_COUNT; plane++) {
+                uint64_t* target = &world->blockPlanes[plane][y][word];
+                *target = (*target & keep) | bits[plane];
+            }
+        }
+    }
+}
+
+int FindBlockPlaneInRow(World* world, BlockPlane plane, int y, int x1, int x2) {
+    if (x1 < 0) x1 = 0;
+    if (x2 >= WORLD_WIDTH) x2 = WORLD_WIDTH - 1;
+    if (y < 0 || y >= WORLD_HEIGHT || x1 > x2) return -1;
+    
+    const uint64_t* row = world->blockPlanes[plane][y];
+    for (int word = x1 >> 6; word <= (x2 >> 6); word++) {
+        uint64_t bits = row[word] & RowWordMask(word, x1, x2);
+        if (bits) {
+            return word * 64 + CountTrailingZeros64(bits);
+        }
+    }
+    return -1;
+}
+
+// Checks a tile rectangle with one masked word test per row and word.
+// Tiles outside the world are ignored.
+bool AnyBlockPlaneInRect(World* world, BlockPlane plane, int x1, int y1, int x2, int y2) {
+    if (x1 < 0) x1 = 0;
+    if (y1 < 0) y1 = 0;
+    if (x2 >= WORLD_WIDTH) x2 = WORLD_WIDTH - 1;
+    if (y2 >= WORLD_HEIGHT) y2 = WORLD_HEIGHT - 1;
+    if (x1 > x2 || y1 > y2) return false;
+    
+    int word1 = x1 >> 6;
+    int word2 = x2 >> 6;
+    
+    for (int word = word1; word <= word2; word++) {
+        uint64_t mask = RowWordMask(word, x1, x2);
+        for (int y = y1; y <= y2; y++) {
+            if (world->blockPlanes[plane][y][word] & mask) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
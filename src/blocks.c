@@ -0,0 +1,86 @@
+#include "game.h"
+
+#define PLANE(name) (1u << BLOCK_PLANE_##name)
+
+typedef struct {
+    const char* name;
+    Color color;
+    float hardness;
+    ToolType minTool;
+    BlockDrawStyle drawStyle;
+    unsigned int planes;
+    // Ticks from a nearby change until the block looks at its
+    // surroundings again; 0 for blocks that never do
+    int updateDelay;
+} BlockDefinition;
+
+// The block registry: one row per block, indexed by block ID. Every other
+// block property is read from here or derived from it in InitBlockRegistry.
+static const BlockDefinition blockDefinitions[BLOCK_COUNT] = {
+    [BLOCK_AIR]         = { "Air",         { 255, 255, 255, 255 },  1.0f, TOOL_NONE,           BLOCK_DRAW_OUTLINED, PLANE(REPLACEABLE),                              0 },
+    [BLOCK_DIRT]        = { "Dirt",        { 127, 106,  79, 255 },  0.5f, TOOL_NONE,           BLOCK_DRAW_OUTLINED, PLANE(SOLID) | PLANE(OPAQUE),                   60 },
+    [BLOCK_STONE]       = { "Stone",       { 130, 130, 130, 255 },  1.5f, TOOL_WOODEN_PICKAXE, BLOCK_DRAW_OUTLINED, PLANE(SOLID) | PLANE(OPAQUE),                    0 },
+    [BLOCK_GRASS]       = { "Grass",       {   0, 228,  48, 255 },  0.6f, TOOL_NONE,           BLOCK_DRAW_OUTLINED, PLANE(SOLID) | PLANE(OPAQUE),                   40 },
+    [BLOCK_WATER]       = { "Water",       { 100, 150, 255, 180 },  1.0f, TOOL_NONE,           BLOCK_DRAW_FLAT,     PLANE(LIQUID) | PLANE(REPLACEABLE),              0 },
+    [BLOCK_SAND]        = { "Sand",        { 253, 249,   0, 255 },  0.5f, TOOL_NONE,           BLOCK_DRAW_OUTLINED, PLANE(SOLID) | PLANE(OPAQUE) | PLANE(GRANULAR),  0 },
+    [BLOCK_WOOD]        = { "Wood",        { 139,  69,  19, 255 },  2.0f, TOOL_NONE,           BLOCK_DRAW_OUTLINED, PLANE(SOLID) | PLANE(OPAQUE),                    0 },
+    [BLOCK_LEAVES]      = { "Leaves",      {  50, 170,  50, 255 },  0.2f, TOOL_NONE,           BLOCK_DRAW_OUTLINED, PLANE(SOLID),                                   10 },
+    [BLOCK_COAL_ORE]    = { "Coal Ore",    {  64,  64,  64, 255 },  3.0f, TOOL_WOODEN_PICKAXE, BLOCK_DRAW_OUTLINED, PLANE(SOLID) | PLANE(OPAQUE),                    0 },
+    [BLOCK_IRON_ORE]    = { "Iron Ore",    { 205, 127,  50, 255 },  3.0f, TOOL_WOODEN_PICKAXE, BLOCK_DRAW_OUTLINED, PLANE(SOLID) | PLANE(OPAQUE),                    0 },
+    [BLOCK_GOLD_ORE]    = { "Gold Ore",    { 255, 215,   0, 255 },  3.0f, TOOL_IRON_PICKAXE,   BLOCK_DRAW_OUTLINED, PLANE(SOLID) | PLANE(OPAQUE),                    0 },
+    [BLOCK_DIAMOND_ORE] = { "Diamond Ore", { 185, 242, 255, 255 }, 15.0f, TOOL_IRON_PICKAXE,   BLOCK_DRAW_OUTLINED, PLANE(SOLID) | PLANE(OPAQUE),                    0 },
+    [BLOCK_EMERALD_ORE] = { "Emerald Ore", {  80, 200, 120, 255 },  3.0f, TOOL_IRON_PICKAXE,   BLOCK_DRAW_OUTLINED, PLANE(SOLID) | PLANE(OPAQUE),                    0 },
+};
+
+// Seconds to break each block with each tool. A tool below the block's
+// minimum tier still works, at five times the bare hardness.
+static float blockBreakTimes[BLOCK_COUNT][TOOL_COUNT];
+
+void InitBlockRegistry(void) {
+    for (int block = 0; block < BLOCK_COUNT; block++) {
+        const BlockDefinition* definition = &blockDefinitions[block];
+        for (int tool = 0; tool < TOOL_COUNT; tool++) {
+            if (tool >= (int)definition->minTool) {
+                blockBreakTimes[block][tool] = definition->hardness / GetToolSpeed((ToolType)tool);
+            } else {
+                blockBreakTimes[block][tool] = definition->hardness * 5.0f;
+            }
+        }
+    }
+}
+
+bool IsBlockSolid(BlockType block) {
+    return (blockDefinitions[block].planes & PLANE(SOLID)) != 0;
+}
+
+Color GetBlockColor(BlockType block) {
+    return blockDefinitions[block].color;
+}
+
+const char* GetBlockName(BlockType block) {
+    return blockDefinitions[block].name;
+}
+
+BlockDrawStyle GetBlockDrawStyle(BlockType block) {
+    return blockDefinitions[block].drawStyle;
+}
+
+unsigned int GetBlockPlaneMask(BlockType block) {
+    return blockDefinitions[block].planes;
+}
+
+float GetBlockHardness(BlockType block) {
+    return blockDefinitions[block].hardness;
+}
+
+bool CanToolBreak(ToolType tool, BlockType block) {
+    return tool >= blockDefinitions[block].minTool;
+}
+
+float GetBreakTime(BlockType block, ToolType tool) {
+    return blockBreakTimes[block][tool];
+}
+
+int GetBlockUpdateDelay(BlockType block) {
+    return blockDefinitions[block].updateDelay;
+}
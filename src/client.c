@@ -0,0 +1,349 @@
+#include "game.h"
+#include "platform.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CLIENT_CONNECT_RETRY 0.5
+// Cells an animal may cover between two snapshots
+#define CLIENT_PUFF_MARGIN 2
+
+// Shared by every client in the process, which all receive on one thread
+static BlockCodec codec;
+
+static void SendToServer(NetClient* client, const NetWriter* writer) {
+    NetSendPacket(&client->link, client->socket, client->serverHost, client->serverPort, &client->channel, writer);
+}
+
+static void SendConnect(NetClient* client) {
+    NetWriter writer;
+    NetBeginPacket(&writer, &client->channel, NET_MESSAGE_CONNECT);
+    SendToServer(client, &writer);
+    client->lastConnectTime = NetGetTime();
+}
+
+// Opens a socket and asks to join; the answer is picked up by ClientReceive
+bool ClientConnect(NetClient* client, World* world, const char* host, unsigned short port) {
+    memset(client, 0, sizeof(*client));
+    client->world = world;
+    client->socket = -1;
+    client->playerId = -1;
+    client->predict = true;
+    
+    uint32_t address;
+    if (!PlatformInitNetwork()) return false;
+    if (!PlatformResolveHost(host, &address) || (client->socket = PlatformOpenUdpSocket(0)) < 0) {
+        PlatformShutdownNetwork();
+        return false;
+    }
+    
+    client->serverHost = address;
+    client->serverPort = port;
+    NetInitChannel(&client->channel);
+    SendConnect(client);
+    return true;
+}
+
+bool ClientWaitForAccept(NetClient* client, double timeout) {
+    double start = NetGetTime();
+    while (!client->connected && !client->disconnected && NetGetTime() - start < timeout) {
+        ClientReceive(client);
+        PlatformSleep(5000000);
+    }
+    return client->connected;
+}
+
+// Movement is all that is predicted. Breaking, placing and the inventory
+// wait for the server, and the UI flags it last sent decide whether the
+// player moves at all.
+static void PredictPlayer(NetClient* client, const InputFrame* input) {
+    Player* player = &client->world->player;
+    if (!player->inventoryOpen && !player->craftingOpen) {
+        UpdatePlayer(client->world, player, input, input->deltaTime);
+    }
+}
+
+// INPUT: the newest sequence number and up to NET_INPUT_REDUNDANCY frames
+// ending with it, skipping any the server has already confirmed
+void ClientSendInput(NetClient* client, const InputFrame* input) {
+    if (!client->connected) return;
+    
+    client->inputSequence++;
+    NetInput* sent = &client->inputs[client->inputSequence % NET_INPUT_BUFFER];
+    *sent = NetQuantizeInput(input);
+    NetApplyInput(&client->predictedInput, sent);
+    client->predictedFrames[client->inputSequence % NET_INPUT_BUFFER] = client->predictedInput;
+    if (client->predict) PredictPlayer(client, &client->predictedInput);
+    
+    unsigned int count = client->inputSequence - client->ackedInputSequence;
+    if (count > NET_INPUT_REDUNDANCY) count = NET_INPUT_REDUNDANCY;
+    
+    NetWriter writer;
+    NetBeginPacket(&writer, &client->channel, NET_MESSAGE_INPUT);
+    NetWriteU32(&writer, client->inputSequence);
+    NetWriteU8(&writer, count);
+    for (unsigned int sequence = client->inputSequence - count + 1; sequence <= client->inputSequence; sequence++) {
+        NetWriteInput(&writer, &client->inputs[sequence % NET_INPUT_BUFFER]);
+    }
+    SendToServer(client, &writer);
+}
+
+static void ReadAccept(NetClient* client, NetReader* reader) {
+    int playerId = NetReadU8(reader);
+    unsigned int seed = NetReadU32(reader);
+    if (reader->error || client->connected) return;
+    
+    client->playerId = playerId;
+    client->connected = true;
+    client->world->role = NET_ROLE_CLIENT;
+    InitGame(client->world, seed);
+    memset(&client->predictedInput, 0, sizeof(client->predictedInput));
+    memset(client->cellSequence, 0, sizeof(client->cellSequence));
+}
+
+// A cell only takes a value from a newer batch than the one it last took,
+// so a delayed packet cannot roll back a later change
+static void ApplyBlock(NetClient* client, unsigned int batch, int x, int y, BlockType block) {
+    if (batch <= client->cellSequence[y][x]) return;
+    
+    client->cellSequence[y][x] = batch;
+    if (client->world->blocks[y][x] != block) SetBlock(client->world, x, y, block);
+}
+
+static void ReadBlocks(NetClient* client, NetReader* reader) {
+    unsigned int batch = NetReadU32(reader);
+    unsigned int count = NetReadVarUint(reader);
+    unsigned int cell = 0;
+    
+    for (unsigned int i = 0; i < count; i++) {
+        cell += NetReadVarUint(reader);
+        BlockType block = (BlockType)NetReadU8(reader);
+        if (reader->error || cell >= WORLD_WIDTH * WORLD_HEIGHT || block >= BLOCK_COUNT) return;
+        ApplyBlock(client, batch, cell % WORLD_WIDTH, cell / WORLD_WIDTH, block);
+    }
+}
+
+static void ReadRegion(NetClient* client, NetReader* reader) {
+    unsigned int batch = NetReadU32(reader);
+    int regionX = NetReadU8(reader);
+    int regionY = NetReadU8(reader);
+    int encodedSize = NetReadU16(reader);
+    if (reader->error || regionX >= WORLD_REGION_COLUMNS || regionY >= WORLD_REGION_ROWS) return;
+    if (encodedSize > reader->size - reader->position) return;
+    
+    unsigned char blocks[REGION_SIZE * REGION_SIZE];
+    if (!DecodeBlocks(&codec, reader->data + reader->position, encodedSize, blocks, sizeof(blocks))) return;
+    
+    for (int y = 0; y < REGION_SIZE && regionY * REGION_SIZE + y < WORLD_HEIGHT; y++) {
+        for (int x = 0; x < REGION_SIZE && regionX * REGION_SIZE + x < WORLD_WIDTH; x++) {
+            BlockType block = (BlockType)blocks[y * REGION_SIZE + x];
+            if (block < BLOCK_COUNT) ApplyBlock(client, batch, regionX * REGION_SIZE + x, regionY * REGION_SIZE + y, block);
+        }
+    }
+}
+
+static void ReadOwnPlayer(NetReader* reader, Player* player) {
+    player->x = NetReadFloat(reader);
+    player->y = NetReadFloat(reader);
+    player->velX = NetReadFloat(reader);
+    player->velY = NetReadFloat(reader);
+    player->lastJumpTime = NetReadFloat(reader);
+    
+    unsigned int flags = NetReadU8(reader);
+    player->onGround = flags & 1;
+    player->inWater = (flags >> 1) & 1;
+    player->inventoryOpen = (flags >> 2) & 1;
+    player->craftingOpen = (flags >> 3) & 1;
+    player->isDragging = (flags >> 4) & 1;
+    player->dragFromExtended = (flags >> 5) & 1;
+    player->isBreaking = (flags >> 6) & 1;
+    
+    player->selectedSlot = NetReadU8(reader) % INVENTORY_SIZE;
+    player->draggedSlot = (int)NetReadU8(reader) - 1;
+    player->health = NetReadU8(reader);
+    player->breakingBlockX = (int)NetReadU16(reader) - 1;
+    player->breakingBlockY = (int)NetReadU16(reader) - 1;
+    player->breakProgress = NetReadU8(reader) / 255.0f;
+    
+    if (!NetReadU8(reader)) return;
+    
+    for (int i = 0; i < INVENTORY_SIZE + EXTENDED_INVENTORY_SIZE; i++) {
+        InventorySlot slot;
+        slot.type = (BlockType)NetReadU8(reader);
+        slot.tool = (ToolType)NetReadU8(reader);
+        slot.count = NetReadU8(reader);
+        slot.durability = NetReadU16(reader);
+        if (reader->error || slot.type >= BLOCK_COUNT || slot.tool >= TOOL_COUNT) return;
+        
+        if (i < INVENTORY_SIZE) {
+            SetContainerSlot(&player->hotbar, i, slot);
+        } else {
+            SetContainerSlot(&player->backpack, i - INVENTORY_SIZE, slot);
+        }
+    }
+}
+
+// The snapshot holds our player as of input 'ackedInput'. Everything sent
+// since is replayed on top, which lands where prediction already was
+// unless the server saw something we did not.
+static void Reconcile(NetClient* client, unsigned int ackedInput, float predictedX, float predictedY) {
+    Player* player = &client->world->player;
+    if (client->inputSequence - ackedInput < NET_INPUT_BUFFER) {
+        for (unsigned int sequence = ackedInput + 1; sequence <= client->inputSequence; sequence++) {
+            PredictPlayer(client, &client->predictedFrames[sequence % NET_INPUT_BUFFER]);
+        }
+    }
+    
+    float error = sqrtf((player->x - predictedX) * (player->x - predictedX) +
+                        (player->y - predictedY) * (player->y - predictedY));
+    client->lastCorrection = error;
+    if (error > 0.01f) client->corrections++;
+    if (error > client->maxCorrection) client->maxCorrection = error;
+}
+
+// Client worlds never spawn animals themselves, so the server's slots are
+// mirrored straight into the array and the pool is left alone
+static void ReadSnapshot(NetClient* client, NetReader* reader) {
+    World* world = client->world;
+    unsigned int tick = NetReadU32(reader);
+    unsigned int ackedInput = NetReadU32(reader);
+    if (reader->error || tick <= client->lastSnapshotTick) return;
+    
+    float elapsed = client->lastSnapshotTick > 0 ? (float)(tick - client->lastSnapshotTick) / NET_TICK_RATE : 0.0f;
+    client->lastSnapshotTick = tick;
+    if (ackedInput > client->ackedInputSequence) client->ackedInputSequence = ackedInput;
+    
+    float predictedX = world->player.x;
+    float predictedY = world->player.y;
+    ReadOwnPlayer(reader, &world->player);
+    if (client->predict) Reconcile(client, ackedInput, predictedX, predictedY);
+    
+    memset(world->playerActive, 0, sizeof(world->playerActive));
+    int playerCount = NetReadU8(reader);
+    for (int i = 0; i < playerCount; i++) {
+        int id = NetReadU8(reader);
+        float x = NetReadU16(reader) / 4.0f;
+        float y = NetReadU16(reader) / 4.0f;
+        bool inWater = NetReadU8(reader) & 1;
+        if (reader->error || id >= MAX_PLAYERS) return;
+        
+        world->players[id].x = x;
+        world->players[id].y = y;
+        world->players[id].inWater = inWater;
+        world->playerActive[id] = true;
+    }
+    
+    bool seen[MAX_ANIMALS] = { 0 };
+    int animalCount = NetReadU8(reader);
+    for (int i = 0; i < animalCount; i++) {
+        int slot = NetReadU8(reader);
+        AnimalType type = (AnimalType)NetReadU8(reader);
+        float x = NetReadU16(reader) / 4.0f;
+        float y = NetReadU16(reader) / 4.0f;
+        unsigned int flags = NetReadU8(reader);
+        if (reader->error || slot >= MAX_ANIMALS || type >= ANIMAL_COUNT) break;
+        
+        Animal* animal = &world->animals[slot];
+        animal->animTime = (animal->alive && animal->type == type) ? animal->animTime + elapsed : 0.0f;
+        animal->type = type;
+        animal->x = x;
+        animal->y = y;
+        animal->direction = (flags & 1) ? 1.0f : -1.0f;
+        animal->inWater = (flags >> 1) & 1;
+        animal->alive = true;
+        seen[slot] = true;
+    }
+    
+    // An animal can also drop out by walking off the edge of the view, so
+    // only those that vanish well inside it are taken to have died
+    int viewX = (int)(world->player.x + 8) / BLOCK_SIZE;
+    int viewY = (int)(world->player.y + 16) / BLOCK_SIZE;
+    world->animalCount = 0;
+    for (int i = 0; i < MAX_ANIMALS; i++) {
+        Animal* animal = &world->animals[i];
+        if (animal->alive && !seen[i] &&
+            abs((int)animal->x / BLOCK_SIZE - viewX) < NET_VIEW_CELLS_X - CLIENT_PUFF_MARGIN &&
+            abs((int)animal->y / BLOCK_SIZE - viewY) < NET_VIEW_CELLS_Y - CLIENT_PUFF_MARGIN) {
+            EmitAnimalPuff(world, animal);
+        }
+        world->animals[i].alive = seen[i];
+        if (seen[i]) world->animalCount++;
+    }
+    
+    int breakCount = NetReadU8(reader);
+    for (int i = 0; i < breakCount; i++) {
+        int x = NetReadU16(reader);
+        int y = NetReadU16(reader);
+        BlockType block = (BlockType)NetReadU8(reader);
+        if (reader->error || x >= WORLD_WIDTH || y >= WORLD_HEIGHT || block >= BLOCK_COUNT) break;
+        EmitBlockParticles(world, x, y, block);
+    }
+}
+
+void ClientReceive(NetClient* client) {
+    if (client->socket < 0 || client->disconnected) return;
+    
+    double now = NetGetTime();
+    if (!client->connected && now - client->lastConnectTime > CLIENT_CONNECT_RETRY) {
+        SendConnect(client);
+    }
+    
+    unsigned char buffer[NET_MAX_PACKET];
+    uint32_t host;
+    uint16_t port;
+    int size;
+    while ((size = NetLinkReceive(&client->link, client->socket, &host, &port, buffer, sizeof(buffer))) > 0) {
+        if (host != client->serverHost || port != client->serverPort) continue;
+        
+        // World updates that beat our accept are dropped unacknowledged,
+        // so they are resent into the world the accept sets up
+        NetMessageType peeked = NetPeekType(buffer, size);
+        bool update = peeked == NET_MESSAGE_BLOCKS || peeked == NET_MESSAGE_REGION || peeked == NET_MESSAGE_SNAPSHOT;
+        if (update && !client->connected) continue;
+        
+        NetReader reader;
+        NetMessageType type;
+        NetReaderInit(&reader, buffer, size);
+        if (!NetReadHeader(&reader, &client->channel, &type)) continue;
+        
+        switch (type) {
+            case NET_MESSAGE_ACCEPT: ReadAccept(client, &reader); break;
+            case NET_MESSAGE_BLOCKS: ReadBlocks(client, &reader); break;
+            case NET_MESSAGE_REGION: ReadRegion(client, &reader); break;
+            case NET_MESSAGE_SNAPSHOT: ReadSnapshot(client, &reader); break;
+            case NET_MESSAGE_REJECT:
+            case NET_MESSAGE_DISCONNECT:
+                client->connected = false;
+                client->disconnected = true;
+                return;
+            default: break;
+        }
+    }
+    
+    if (client->connected && now - client->channel.lastReceiveTime > NET_TIMEOUT) {
+        client->connected = false;
+        client->disconnected = true;
+    }
+}
+
+// Round trip split evenly between the two directions, plus up to 'jitter'
+// more each way; 'loss' is the chance each packet is dropped
+void ClientSimulateLink(NetClient* client, double roundTrip, double jitter, float loss) {
+    NetInitLinkSim(&client->link, roundTrip, jitter, loss, (unsigned int)client->socket);
+}
+
+void ClientDisconnect(NetClient* client) {
+    if (client->socket < 0) return;
+    
+    if (client->connected) {
+        // Straight out, since nothing will flush the simulator after this
+        client->link.enabled = false;
+        NetWriter writer;
+        NetBeginPacket(&writer, &client->channel, NET_MESSAGE_DISCONNECT);
+        SendToServer(client, &writer);
+    }
+    PlatformCloseSocket(client->socket);
+    PlatformShutdownNetwork();
+    client->socket = -1;
+    client->connected = false;
+}
@@ -0,0 +1,207 @@
+#include "game.h"
+#include <string.h>
+
+// Block data goes through two stages. Runs come first: each is a block ID
+// and a varint of its length less one, taken in row-major order, so a row
+// of stone is three bytes. Terrain also repeats itself from one row to
+// the next, and the run bytes of those rows are alike, so an LZ pass over
+// them (LZ4-style sequences of literals and back references) takes out
+// most of what is left.
+//
+// Encoded: varint cell count, varint run bytes, then the sequences. Each
+// sequence is a token whose high nibble is the literal count and low
+// nibble the match length less CODEC_MIN_MATCH, 15 meaning more follows
+// in bytes of 255 and a final smaller one; the literals; and, unless it
+// is the last, a 16-bit offset back into the run bytes.
+
+#define CODEC_MIN_MATCH 4
+#define CODEC_MAX_OFFSET 65535
+
+typedef struct {
+    unsigned char* data;
+    int size;
+    int capacity;
+    bool overflow;
+} CodecWriter;
+
+static void PutByte(CodecWriter* writer, unsigned int value) {
+    if (writer->size >= writer->capacity) {
+        writer->overflow = true;
+        return;
+    }
+    writer->data[writer->size++] = (unsigned char)value;
+}
+
+static void PutVarint(CodecWriter* writer, unsigned int value) {
+    while (value >= 0x80) {
+        PutByte(writer, (value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    PutByte(writer, value);
+}
+
+// What is left of a length once its nibble says 15
+static void PutLengthTail(CodecWriter* writer, int length) {
+    for (length -= 15; length >= 255; length -= 255) {
+        PutByte(writer, 255);
+    }
+    PutByte(writer, length);
+}
+
+static void PutSequence(CodecWriter* writer, const unsigned char* literals, int literalCount, int offset, int matchLength) {
+    int matchCode = matchLength > 0 ? matchLength - CODEC_MIN_MATCH : 0;
+    PutByte(writer, (literalCount < 15 ? literalCount : 15) << 4 | (matchCode < 15 ? matchCode : 15));
+    if (literalCount >= 15) PutLengthTail(writer, literalCount);
+    
+    if (writer->size + literalCount > writer->capacity) {
+        writer->overflow = true;
+        return;
+    }
+    memcpy(writer->data + writer->size, literals, literalCount);
+    writer->size += literalCount;
+    if (matchLength == 0) return;
+    
+    PutByte(writer, offset & 0xff);
+    PutByte(writer, offset >> 8);
+    if (matchCode >= 15) PutLengthTail(writer, matchCode);
+}
+
+static unsigned int HashRunBytes(const unsigned char* bytes, int bits) {
+    unsigned int value = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (unsigned int)bytes[3] << 24;
+    return (value * 2654435761u) >> (32 - bits);
+}
+
+static int EncodeRuns(const unsigned char* cells, int count, unsigned char* runs) {
+    CodecWriter writer = { runs, 0, CODEC_MAX_CELLS * 2, false };
+    for (int i = 0; i < count;) {
+        int run = 1;
+        while (i + run < count && cells[i + run] == cells[i]) run++;
+        PutByte(&writer, cells[i]);
+        PutVarint(&writer, run - 1);
+        i += run;
+    }
+    return writer.size;
+}
+
+// Compresses 'count' cells into 'output'. Returns the encoded size, or -1
+// if it does not fit in 'capacity'; CODEC_MAX_ENCODED_SIZE(count) always
+// does.
+int EncodeBlocks(BlockCodec* codec, const unsigned char* cells, int count, unsigned char* output, int capacity) {
+    if (count < 0 || count > CODEC_MAX_CELLS) return -1;
+    
+    const unsigned char* runs = codec->runs;
+    int runSize = EncodeRuns(cells, count, codec->runs);
+    CodecWriter writer = { output, 0, capacity, false };
+    PutVarint(&writer, count);
+    PutVarint(&writer, runSize);
+    
+    // Positions are stored plus one, so a cleared table means empty. A
+    // region's runs are small, and clearing the whole table would cost
+    // more than compressing them.
+    int hashBits = CODEC_HASH_BITS;
+    while (hashBits > 6 && 1 << (hashBits - 1) >= runSize) hashBits--;
+    memset(codec->hashTable, 0, sizeof(int) << hashBits);
+    int anchor = 0;
+    int i = 0;
+    while (i + CODEC_MIN_MATCH <= runSize && !writer.overflow) {
+        unsigned int hash = HashRunBytes(runs + i, hashBits);
+        int candidate = codec->hashTable[hash] - 1;
+        codec->hashTable[hash] = i + 1;
+        if (candidate < 0 || i - candidate > CODEC_MAX_OFFSET || memcmp(runs + candidate, runs + i, CODEC_MIN_MATCH) != 0) {
+            i++;
+            continue;
+        }
+        
+        int length = CODEC_MIN_MATCH;
+        while (i + length < runSize && runs[candidate + length] == runs[i + length]) length++;
+        PutSequence(&writer, runs + anchor, i - anchor, i - candidate, length);
+        i += length;
+        anchor = i;
+    }
+    PutSequence(&writer, runs + anchor, runSize - anchor, 0, 0);
+    return writer.overflow ? -1 : writer.size;
+}
+
+typedef struct {
+    const unsigned char* data;
+    int size;
+    int position;
+    bool error;
+} CodecReader;
+
+static unsigned int GetByte(CodecReader* reader) {
+    if (reader->position >= reader->size) {
+        reader->error = true;
+        return 0;
+    }
+    return reader->data[reader->position++];
+}
+
+static unsigned int GetVarint(CodecReader* reader) {
+    unsigned int value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        unsigned int byte = GetByte(reader);
+        value |= (byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return value;
+    }
+    reader->error = true;
+    return 0;
+}
+
+static int GetLength(CodecReader* reader, int nibble) {
+    int length = nibble;
+    if (nibble < 15) return length;
+    
+    unsigned int byte;
+    do {
+        byte = GetByte(reader);
+        length += byte;
+    } while (byte == 255 && !reader->error && length < CODEC_MAX_CELLS * 2);
+    return length;
+}
+
+// Undoes EncodeBlocks into exactly 'count' cells. False if the data is
+// damaged or holds some other number of cells.
+bool DecodeBlocks(BlockCodec* codec, const unsigned char* input, int size, unsigned char* cells, int count) {
+    CodecReader reader = { input, size, 0, false };
+    unsigned int cellCount = GetVarint(&reader);
+    unsigned int runSize = GetVarint(&reader);
+    if (reader.error || cellCount != (unsigned int)count || runSize > sizeof(codec->runs)) return false;
+    
+    unsigned char* runs = codec->runs;
+    int position = 0;
+    for (;;) {
+        unsigned int token = GetByte(&reader);
+        int literalCount = GetLength(&reader, token >> 4);
+        if (reader.error || literalCount > (int)runSize - position || literalCount > reader.size - reader.position) {
+            return false;
+        }
+        memcpy(runs + position, reader.data + reader.position, literalCount);
+        reader.position += literalCount;
+        position += literalCount;
+        if (reader.position == reader.size) break;
+        
+        int offset = GetByte(&reader);
+        offset |= GetByte(&reader) << 8;
+        int length = GetLength(&reader, token & 15) + CODEC_MIN_MATCH;
+        if (reader.error || offset == 0 || offset > position || length > (int)runSize - position) return false;
+        
+        // Byte by byte, since a match may overlap what it is copying
+        for (int i = 0; i < length; i++) {
+            runs[position + i] = runs[position - offset + i];
+        }
+        position += length;
+    }
+    if (position != (int)runSize) return false;
+    
+    CodecReader runReader = { runs, (int)runSize, 0, false };
+    int filled = 0;
+    while (runReader.position < runReader.size) {
+        unsigned int value = GetByte(&runReader);
+        unsigned int run = GetVarint(&runReader) + 1;
+        if (runReader.error || run == 0 || run > (unsigned int)(count - filled)) return false;
+        memset(cells + filled, value, run);
+        filled += run;
+    }
+    return filled == count;
+}
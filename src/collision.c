@@ -0,0 +1,132 @@
+#include "game.h"
+#include <limits.h>
+#include <math.h>
+
+#define NO_BLOCKING_TILE INT_MIN
+
+// Tiles outside the world always block
+static int FirstBlockingRow(World* world, int bx, int rowLo, int rowHi) {
+    if (bx < 0 || bx >= WORLD_WIDTH) {
+        return rowLo;
+    }
+    for (int by = rowLo; by <= rowHi; by++) {
+        if (by < 0 || by >= WORLD_HEIGHT || TestBlockPlane(world, BLOCK_PLANE_SOLID, bx, by)) {
+            return by;
+        }
+    }
+    return NO_BLOCKING_TILE;
+}
+
+static int FirstBlockingColumn(World* world, int by, int colLo, int colHi) {
+    if (by < 0 || by >= WORLD_HEIGHT || colLo < 0) {
+        return colLo;
+    }
+    int bx = FindBlockPlaneInRow(world, BLOCK_PLANE_SOLID, by, colLo, colHi);
+    if (bx >= 0) {
+        return bx;
+    }
+    return (colHi >= WORLD_WIDTH) ? WORLD_WIDTH : NO_BLOCKING_TILE;
+}
+
+// Walks the tiles entered by the box [x, x + width) x [y, y + height) as it
+// moves by (dx, dy), one tile column or row at a time in the order they are
+// crossed. Only newly entered tiles are tested, so a box that starts inside
+// a solid block can still move out of it.
+SweepResult SweepBox(World* world, float x, float y, float width, float height, float dx, float dy) {
+    SweepResult result = { 1.0f, 0, 0, -1, -1, false };
+    
+    int stepX = (dx > 0) - (dx < 0);
+    int stepY = (dy > 0) - (dy < 0);
+    
+    // Tiles currently overlapped by the box
+    int colLo = (int)floorf(x / BLOCK_SIZE);
+    int colHi = (int)ceilf((x + width) / BLOCK_SIZE) - 1;
+    int rowLo = (int)floorf(y / BLOCK_SIZE);
+    int rowHi = (int)ceilf((y + height) / BLOCK_SIZE) - 1;
+    
+    int nextCol = (stepX > 0) ? colHi + 1 : colLo - 1;
+    int nextRow = (stepY > 0) ? rowHi + 1 : rowLo - 1;
+    
+    float timeX = INFINITY;
+    float timeY = INFINITY;
+    if (stepX > 0) timeX = (nextCol * BLOCK_SIZE - (x + width)) / dx;
+    if (stepX < 0) timeX = ((nextCol + 1) * BLOCK_SIZE - x) / dx;
+    if (stepY > 0) timeY = (nextRow * BLOCK_SIZE - (y + height)) / dy;
+    if (stepY < 0) timeY = ((nextRow + 1) * BLOCK_SIZE - y) / dy;
+    
+    float deltaX = (stepX != 0) ? BLOCK_SIZE / fabsf(dx) : INFINITY;
+    float deltaY = (stepY != 0) ? BLOCK_SIZE / fabsf(dy) : INFINITY;
+    
+    while (timeX <= 1.0f || timeY <= 1.0f) {
+        bool crossX = timeX <= timeY;
+        float t = crossX ? timeX : timeY;
+        
+        // The trailing edges may have left tiles by now
+        if (stepX > 0) colLo = (int)floorf((x + dx * t) / BLOCK_SIZE);
+        if (stepX < 0) colHi = (int)ceilf((x + width + dx * t) / BLOCK_SIZE) - 1;
+        if (stepY > 0) rowLo = (int)floorf((y + dy * t) / BLOCK_SIZE);
+        if (stepY < 0) rowHi = (int)ceilf((y + height + dy * t) / BLOCK_SIZE) - 1;
+        
+        if (crossX) {
+            int blockingRow = FirstBlockingRow(world, nextCol, rowLo, rowHi);
+            if (blockingRow != NO_BLOCKING_TILE) {
+                result.time = t;
+                result.normalX = -stepX;
+                result.tileX = nextCol;
+                result.tileY = blockingRow;
+                result.hit = true;
+                return result;
+            }
+            if (stepX > 0) colHi = nextCol; else colLo = nextCol;
+            nextCol += stepX;
+            timeX += deltaX;
+        } else {
+            int blockingCol = FirstBlockingColumn(world, nextRow, colLo, colHi);
+            if (blockingCol != NO_BLOCKING_TILE) {
+                result.time = t;
+                result.normalY = -stepY;
+                result.tileX = blockingCol;
+                result.tileY = nextRow;
+                result.hit = true;
+                return result;
+            }
+            if (stepY > 0) rowHi = nextRow; else rowLo = nextRow;
+            nextRow += stepY;
+            timeY += deltaY;
+        }
+    }
+    
+    return result;
+}
+
+// Moves the box as far as it can and slides the remaining motion along any
+// surface it hits. The box ends flush against the blocking tile.
+BoxMoveResult MoveBox(World* world, float* x, float* y, float width, float height, float dx, float dy) {
+    BoxMoveResult result = { false, false };
+    
+    for (int pass = 0; pass < 2 && (dx != 0 || dy != 0); pass++) {
+        SweepResult sweep = SweepBox(world, *x, *y, width, height, dx, dy);
+        
+        if (!sweep.hit) {
+            *x += dx;
+            *y += dy;
+            break;
+        }
+        
+        if (sweep.normalX != 0) {
+            *x = (sweep.normalX < 0) ? sweep.tileX * BLOCK_SIZE - width : (sweep.tileX + 1) * BLOCK_SIZE;
+            *y += dy * sweep.time;
+            dy *= 1.0f - sweep.time;
+            dx = 0;
+            result.hitX = true;
+        } else {
+            *y = (sweep.normalY < 0) ? sweep.tileY * BLOCK_SIZE - height : (sweep.tileY + 1) * BLOCK_SIZE;
+            *x += dx * sweep.time;
+            dx *= 1.0f - sweep.time;
+            dy = 0;
+            result.hitY = true;
+        }
+    }
+    
+    return result;
+}
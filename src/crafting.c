@@ -1,22 +1,6 @@
 #include "game.h"
-#include <math.h>
-
-float GetBlockHardness(BlockType block) {
-    switch (block) {
-        case BLOCK_DIRT: return 0.5f;
-        case BLOCK_GRASS: return 0.6f;
-        case BLOCK_SAND: return 0.5f;
-        case BLOCK_WOOD: return 2.0f;
-        case BLOCK_LEAVES: return 0.2f;
-        case BLOCK_STONE: return 1.5f;
-        case BLOCK_COAL_ORE: return 3.0f;
-        case BLOCK_IRON_ORE: return 3.0f;
-        case BLOCK_GOLD_ORE: return 3.0f;
-        case BLOCK_DIAMOND_ORE: return 15.0f;
-        case BLOCK_EMERALD_ORE: return 3.0f;
-        default: return 1.0f;
-    }
-}
+#include <limits.h>
+#include <stdio.h>
 
 float GetToolSpeed(ToolType tool) {
     switch (tool) {
@@ -30,33 +14,6 @@ float GetToolSpeed(ToolType tool) {
     }
 }
 
-bool CanToolBreak(ToolType tool, BlockType block) {
-    switch (block) {
-        case BLOCK_STONE:
-        case BLOCK_COAL_ORE:
-        case BLOCK_IRON_ORE:
-            return tool >= TOOL_WOODEN_PICKAXE;
-        case BLOCK_GOLD_ORE:
-        case BLOCK_EMERALD_ORE:
-            return tool >= TOOL_IRON_PICKAXE;
-        case BLOCK_DIAMOND_ORE:
-            return tool >= TOOL_IRON_PICKAXE;
-        default:
-            return true;
-    }
-}
-
-float GetBreakTime(BlockType block, ToolType tool) {
-    float hardness = GetBlockHardness(block);
-    float speed = GetToolSpeed(tool);
-    
-    if (!CanToolBreak(tool, block)) {
-        return hardness * 5.0f;
-    }
-    
-    return hardness / speed;
-}
-
 const char* GetToolName(ToolType tool) {
     switch (tool) {
         case TOOL_WOODEN_PICKAXE: return "Wooden Pickaxe";
@@ -79,172 +36,141 @@ int GetToolDurability(ToolType tool) {
     }
 }
 
+#define MAX_RECIPE_INGREDIENTS 2
+
+typedef struct {
+    BlockType item;
+    int count;
+} RecipeIngredient;
+
+typedef struct {
+    int ingredientCount;
+    RecipeIngredient ingredients[MAX_RECIPE_INGREDIENTS];
+} Recipe;
+
+// What each tool costs, indexed by the tool it makes
+static const Recipe toolRecipes[TOOL_COUNT] = {
+    [TOOL_WOODEN_PICKAXE]  = { 1, { { BLOCK_WOOD, 3 } } },
+    [TOOL_STONE_PICKAXE]   = { 2, { { BLOCK_STONE, 3 }, { BLOCK_WOOD, 2 } } },
+    [TOOL_IRON_PICKAXE]    = { 2, { { BLOCK_IRON_ORE, 3 }, { BLOCK_WOOD, 2 } } },
+    [TOOL_GOLD_PICKAXE]    = { 2, { { BLOCK_GOLD_ORE, 3 }, { BLOCK_WOOD, 2 } } },
+    [TOOL_DIAMOND_PICKAXE] = { 2, { { BLOCK_DIAMOND_ORE, 3 }, { BLOCK_WOOD, 2 } } },
+};
+
+// How many of 'tool' the carried materials pay for, from the item-count
+// index, so it costs one read per ingredient
+int GetCraftableCount(Player* player, ToolType tool) {
+    const Recipe* recipe = &toolRecipes[tool];
+    if (recipe->ingredientCount == 0) return 0;
+    
+    int craftable = INT_MAX;
+    for (int i = 0; i < recipe->ingredientCount; i++) {
+        int affordable = GetItemCount(player, recipe->ingredients[i].item) / recipe->ingredients[i].count;
+        if (affordable < craftable) craftable = affordable;
+    }
+    return craftable;
+}
+
 bool CanCraftTool(Player* player, ToolType tool) {
-    int stickCount = 0;
-    int materialCount = 0;
-    BlockType requiredMaterial = BLOCK_AIR;
-    
-    for (int i = 0; i < INVENTORY_SIZE; i++) {
-        if (player->inventory[i].type == BLOCK_WOOD) {
-            stickCount += player->inventory[i].count;
-        }
-    }
-    
-    for (int i = 0; i < EXTENDED_INVENTORY_SIZE; i++) {
-        if (player->extendedInventory[i].type == BLOCK_WOOD) {
-            stickCount += player->extendedInventory[i].count;
-        }
-    }
-    
-    switch (tool) {
-        case TOOL_WOODEN_PICKAXE:
-            requiredMaterial = BLOCK_WOOD;
-            break;
-        case TOOL_STONE_PICKAXE:
-            requiredMaterial = BLOCK_STONE;
-            break;
-        case TOOL_IRON_PICKAXE:
-            requiredMaterial = BLOCK_IRON_ORE;
-            break;
-        case TOOL_GOLD_PICKAXE:
-            requiredMaterial = BLOCK_GOLD_ORE;
-            break;
-        case TOOL_DIAMOND_PICKAXE:
-            requiredMaterial = BLOCK_DIAMOND_ORE;
-            break;
-        default:
-            return false;
-    }
-    
-    for (int i = 0; i < INVENTORY_SIZE; i++) {
-        if (player->inventory[i].type == requiredMaterial) {
-            materialCount += player->inventory[i].count;
-        }
-    }
-    
-    for (int i = 0; i < EXTENDED_INVENTORY_SIZE; i++) {
-        if (player->extendedInventory[i].type == requiredMaterial) {
-            materialCount += player->extendedInventory[i].count;
-        }
-    }
-    
-    return (stickCount >= 2 && materialCount >= 3);
+    return GetCraftableCount(player, tool) > 0;
 }
 
-void ConsumeCraftingMaterials(Player* player, ToolType tool) {
-    int sticksNeeded = 2;
-    int materialsNeeded = 3;
-    BlockType requiredMaterial = BLOCK_AIR;
-    
-    switch (tool) {
-        case TOOL_WOODEN_PICKAXE:
-            requiredMaterial = BLOCK_WOOD;
-            sticksNeeded = 0;
-            materialsNeeded = 3;
-            break;
-        case TOOL_STONE_PICKAXE:
-            requiredMaterial = BLOCK_STONE;
-            break;
-        case TOOL_IRON_PICKAXE:
-            requiredMaterial = BLOCK_IRON_ORE;
-            break;
-        case TOOL_GOLD_PICKAXE:
-            requiredMaterial = BLOCK_GOLD_ORE;
-            break;
-        case TOOL_DIAMOND_PICKAXE:
-            requiredMaterial = BLOCK_DIAMOND_ORE;
-            break;
-        default:
-            return;
-    }
+// Slots that paying for 'count' crafts empties, taking from the hotbar
+// first and then the backpack as RemoveFromInventory does
+static int CountSlotsFreedByCrafting(Player* player, ToolType tool, int count) {
+    const Recipe* recipe = &toolRecipes[tool];
+    int freed = 0;
+    for (int i = 0; i < recipe->ingredientCount; i++) {
+        BlockType item = recipe->ingredients[i].item;
+        int needed = recipe->ingredients[i].count * count;
+        int fromHotbar = player->hotbar.itemCounts[item] < needed ? player->hotbar.itemCounts[item] : needed;
+        freed += CountSlotsEmptiedByRemoving(&player->hotbar, item, fromHotbar);
+        freed += CountSlotsEmptiedByRemoving(&player->backpack, item, needed - fromHotbar);
+    }
+    return freed;
+}
+
+// What a shift-click makes: as many as the materials allow, while there
+// are slots to put them in once the materials are gone. More crafts never
+// free fewer slots, so shrinking to the room each count leaves settles on
+// the largest count that fits.
+int GetCraftMaxCount(Player* player, ToolType tool) {
+    int count = GetCraftableCount(player, tool);
+    int freeSlots = player->hotbar.freeCount + player->backpack.freeCount;
+    while (count > 0) {
+        int room = freeSlots + CountSlotsFreedByCrafting(player, tool, count);
+        if (count <= room) break;
+        count = room;
+    }
+    return count;
+}
+
+// Writes the ingredient list for the crafting menu, e.g. "3 Stone + 2 Wood"
+void GetRecipeText(ToolType tool, char* buffer, int size) {
+    const Recipe* recipe = &toolRecipes[tool];
+    int length = 0;
+    buffer[0] = '\0';
     
-    for (int i = 0; i < INVENTORY_SIZE && sticksNeeded > 0; i++) {
-        if (player->inventory[i].type == BLOCK_WOOD) {
-            int taken = fmin(sticksNeeded, player->inventory[i].count);
-            player->inventory[i].count -= taken;
-            sticksNeeded -= taken;
-            if (player->inventory[i].count == 0) {
-                player->inventory[i].type = BLOCK_AIR;
-            }
-        }
+    for (int i = 0; i < recipe->ingredientCount && length < size; i++) {
+        length += snprintf(buffer + length, size - length, "%s%d %s", i > 0 ? " + " : "",
+                           recipe->ingredients[i].count, GetBlockName(recipe->ingredients[i].item));
     }
-    
-    for (int i = 0; i < EXTENDED_INVENTORY_SIZE && sticksNeeded > 0; i++) {
-        if (player->extendedInventory[i].type == BLOCK_WOOD) {
-            int taken = fmin(sticksNeeded, player->extendedInventory[i].count);
-            player->extendedInventory[i].count -= taken;
-            sticksNeeded -= taken;
-            if (player->extendedInventory[i].count == 0) {
-                player->extendedInventory[i].type = BLOCK_AIR;
-            }
-        }
+}
+
+// Removes the materials for 'count' crafts, touching only the stacks of
+// each ingredient
+static void ConsumeCraftingMaterials(Player* player, ToolType tool, int count) {
+    const Recipe* recipe = &toolRecipes[tool];
+    for (int i = 0; i < recipe->ingredientCount; i++) {
+        RemoveFromInventory(player, recipe->ingredients[i].item, recipe->ingredients[i].count * count);
     }
+}
+
+static void AddToolToInventory(Player* player, ToolType tool) {
+    InventorySlot slot = { BLOCK_AIR, tool, 1, GetToolDurability(tool) };
     
-    for (int i = 0; i < INVENTORY_SIZE && materialsNeeded > 0; i++) {
-        if (player->inventory[i].type == requiredMaterial) {
-            int taken = fmin(materialsNeeded, player->inventory[i].count);
-            player->inventory[i].count -= taken;
-            materialsNeeded -= taken;
-            if (player->inventory[i].count == 0) {
-                player->inventory[i].type = BLOCK_AIR;
-            }
-        }
+    int index = FindFreeContainerSlot(&player->hotbar);
+    if (index >= 0) {
+        SetContainerSlot(&player->hotbar, index, slot);
+        return;
     }
     
-    for (int i = 0; i < EXTENDED_INVENTORY_SIZE && materialsNeeded > 0; i++) {
-        if (player->extendedInventory[i].type == requiredMaterial) {
-            int taken = fmin(materialsNeeded, player->extendedInventory[i].count);
-            player->extendedInventory[i].count -= taken;
-            materialsNeeded -= taken;
-            if (player->extendedInventory[i].count == 0) {
-                player->extendedInventory[i].type = BLOCK_AIR;
-            }
-        }
+    index = FindFreeContainerSlot(&player->backpack);
+    if (index >= 0) {
+        SetContainerSlot(&player->backpack, index, slot);
     }
 }
 
-void AddToolToInventory(Player* player, ToolType tool) {
-    for (int i = 0; i < INVENTORY_SIZE; i++) {
-        if (player->inventory[i].type == BLOCK_AIR || player->inventory[i].count == 0) {
-            player->inventory[i].type = BLOCK_AIR;
-            player->inventory[i].tool = tool;
-            player->inventory[i].count = 1;
-            player->inventory[i].durability = GetToolDurability(tool);
-            return;
-        }
-    }
-    
-    for (int i = 0; i < EXTENDED_INVENTORY_SIZE; i++) {
-        if (player->extendedInventory[i].type == BLOCK_AIR || player->extendedInventory[i].count == 0) {
-            player->extendedInventory[i].type = BLOCK_AIR;
-            player->extendedInventory[i].tool = tool;
-            player->extendedInventory[i].count = 1;
-            player->extendedInventory[i].durability = GetToolDurability(tool);
-            return;
-        }
-    }
+// Crafts up to 'count' of 'tool', limited by materials and by free slots
+// for the results. Returns how many were made.
+int CraftTool(Player* player, ToolType tool, int count) {
+    int most = GetCraftMaxCount(player, tool);
+    if (most < count) count = most;
+    if (count <= 0) return 0;
+    
+    ConsumeCraftingMaterials(player, tool, count);
+    for (int i = 0; i < count; i++) {
+        AddToolToInventory(player, tool);
+    }
+    return count;
 }
 
-void HandleCrafting(World* world) {
-    Player* player = &world->player;
-    
-    if (IsKeyPressed(KEY_C)) {
+void HandleCrafting(Player* player, const InputFrame* input) {
+    if (InputPressed(input, INPUT_CRAFTING)) {
         player->craftingOpen = !player->craftingOpen;
     }
     
     if (!player->craftingOpen) return;
     
-    Vector2 mousePos = GetMousePosition();
+    Vector2 mousePos = input->mouse;
     int startX = SCREEN_WIDTH / 2 - 200;
     int startY = SCREEN_HEIGHT / 2 - 150;
     
     for (int i = 1; i < TOOL_COUNT; i++) {
         Rectangle toolRect = {startX, startY + (i - 1) * 60, 400, 50};
-        if (CheckCollisionPointRec(mousePos, toolRect) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
-            if (CanCraftTool(player, (ToolType)i)) {
-                ConsumeCraftingMaterials(player, (ToolType)i);
-                AddToolToInventory(player, (ToolType)i);
-            }
+        if (CheckCollisionPointRec(mousePos, toolRect) && InputPressed(input, INPUT_PRIMARY)) {
+            // Shift-click crafts as many as the materials allow
+            CraftTool(player, (ToolType)i, InputDown(input, INPUT_MODIFIER) ? INT_MAX : 1);
         }
     }
 }
\ No newline at end of file
@@ -0,0 +1,354 @@
+#include "game.h"
+#include <string.h>
+
+// Bulk world edits. Each one builds whole rows and stores them with a
+// single copy per row, noting which cells really changed, and then has
+// CommitBlockRect bring the world's tables up to date once for the lot
+// rather than per cell as SetBlock does. The rectangle an edit covered
+// goes into the world's EditHistory before and after, so it can be undone
+// and redone.
+
+typedef struct {
+    World* world;
+    int x1, y1, x2, y2;
+    // Bounds of the cells that really changed
+    int minX, minY, maxX, maxY;
+    uint64_t (*changed)[WORLD_ROW_WORDS];
+    // Scratch for building a row before it is written
+    BlockType* row;
+    int changedCount;
+    bool woodRemoved;
+    bool record;
+    size_t mark;
+} WorldEdit;
+
+// Puts the corners in order and clips them to the world. False if nothing
+// is left.
+static bool ClipRect(int* x1, int* y1, int* x2, int* y2) {
+    if (*x1 > *x2) {
+        int temp = *x1;
+        *x1 = *x2;
+        *x2 = temp;
+    }
+    if (*y1 > *y2) {
+        int temp = *y1;
+        *y1 = *y2;
+        *y2 = temp;
+    }
+    if (*x1 < 0) *x1 = 0;
+    if (*y1 < 0) *y1 = 0;
+    if (*x2 >= WORLD_WIDTH) *x2 = WORLD_WIDTH - 1;
+    if (*y2 >= WORLD_HEIGHT) *y2 = WORLD_HEIGHT - 1;
+    return *x1 <= *x2 && *y1 <= *y2;
+}
+
+static void SnapshotRect(World* world, int x, int y, int width, int height, unsigned char* cells) {
+    for (int row = 0; row < height; row++) {
+        for (int column = 0; column < width; column++) {
+            cells[row * width + column] = (unsigned char)world->blocks[y + row][x + column];
+        }
+    }
+}
+
+static bool BeginEdit(WorldEdit* edit, World* world, int x1, int y1, int x2, int y2, bool record) {
+    if (!ClipRect(&x1, &y1, &x2, &y2)) return false;
+    
+    edit->mark = ArenaMark(&world->frameMemory);
+    edit->changed = (uint64_t (*)[WORLD_ROW_WORDS])ArenaAlloc(&world->frameMemory,
+                                                               sizeof(uint64_t) * WORLD_HEIGHT * WORLD_ROW_WORDS,
+                                                               MEMORY_EDITING);
+    edit->row = (BlockType*)ArenaAlloc(&world->frameMemory, sizeof(BlockType) * WORLD_WIDTH, MEMORY_EDITING);
+    if (edit->changed == NULL || edit->row == NULL) {
+        ArenaRewind(&world->frameMemory, edit->mark);
+        return false;
+    }
+    memset(edit->changed, 0, sizeof(uint64_t) * WORLD_HEIGHT * WORLD_ROW_WORDS);
+    
+    edit->world = world;
+    edit->x1 = x1;
+    edit->y1 = y1;
+    edit->x2 = x2;
+    edit->y2 = y2;
+    edit->minX = WORLD_WIDTH;
+    edit->minY = WORLD_HEIGHT;
+    edit->maxX = -1;
+    edit->maxY = -1;
+    edit->changedCount = 0;
+    edit->woodRemoved = false;
+    edit->record = record;
+    if (record) SnapshotRect(world, x1, y1, x2 - x1 + 1, y2 - y1 + 1, world->editHistory->before);
+    return true;
+}
+
+// Stores 'count' blocks from 'source' into row 'y' from 'x' on
+static void WriteRow(WorldEdit* edit, int y, int x, int count, const BlockType* source) {
+    BlockType* row = &edit->world->blocks[y][x];
+    int first = -1;
+    int last = -1;
+    for (int i = 0; i < count; i++) {
+        if (row[i] == source[i]) continue;
+        
+        int cellX = x + i;
+        edit->changed[y][cellX >> 6] |= (uint64_t)1 << (cellX & 63);
+        if (row[i] == BLOCK_WOOD) edit->woodRemoved = true;
+        if (first < 0) first = cellX;
+        last = cellX;
+        edit->changedCount++;
+    }
+    if (first < 0) return;
+    
+    memcpy(row, source, sizeof(BlockType) * count);
+    if (first < edit->minX) edit->minX = first;
+    if (last > edit->maxX) edit->maxX = last;
+    if (y < edit->minY) edit->minY = y;
+    if (y > edit->maxY) edit->maxY = y;
+}
+
+static void DropOldestRecord(EditHistory* history) {
+    int size = history->records[0].beforeSize + history->records[0].afterSize;
+    memmove(history->data, history->data + size, history->used - size);
+    memmove(history->records, history->records + 1, sizeof(EditRecord) * (history->count - 1));
+    history->used -= size;
+    history->count--;
+    history->position--;
+    for (int i = 0; i < history->count; i++) {
+        history->records[i].offset -= size;
+    }
+}
+
+// A new edit ends whatever redo there was. An edit too large for the
+// whole history is not kept, and leaves nothing before it to undo.
+static void PushEditRecord(World* world, int x, int y, int width, int height) {
+    EditHistory* history = world->editHistory;
+    SnapshotRect(world, x, y, width, height, history->after);
+    
+    history->count = history->position;
+    if (history->count > 0) {
+        const EditRecord* last = &history->records[history->count - 1];
+        history->used = last->offset + last->beforeSize + last->afterSize;
+    } else {
+        history->used = 0;
+    }
+    if (history->count == EDIT_HISTORY_RECORDS) DropOldestRecord(history);
+    
+    int cells = width * height;
+    for (;;) {
+        unsigned char* output = history->data + history->used;
+        int capacity = EDIT_HISTORY_BYTES - history->used;
+        int beforeSize = EncodeBlocks(&history->codec, history->before, cells, output, capacity);
+        int afterSize = beforeSize < 0 ? -1 :
+                        EncodeBlocks(&history->codec, history->after, cells, output + beforeSize, capacity - beforeSize);
+        if (afterSize >= 0) {
+            history->records[history->count++] = (EditRecord){ x, y, width, height, history->used, beforeSize, afterSize };
+            history->position = history->count;
+            history->used += beforeSize + afterSize;
+            return;
+        }
+        if (history->count == 0) return;
+        DropOldestRecord(history);
+    }
+}
+
+static int FinishEdit(WorldEdit* edit) {
+    World* world = edit->world;
+    if (edit->changedCount > 0) {
+        if (edit->record) PushEditRecord(world, edit->x1, edit->y1, edit->x2 - edit->x1 + 1, edit->y2 - edit->y1 + 1);
+        CommitBlockRect(world, edit->minX, edit->minY, edit->maxX, edit->maxY,
+                        (const uint64_t (*)[WORLD_ROW_WORDS])edit->changed, edit->woodRemoved);
+    }
+    ArenaRewind(&world->frameMemory, edit->mark);
+    return edit->changedCount;
+}
+
+void ResetWorldEdits(World* world) {
+    world->editHistory->count = 0;
+    world->editHistory->position = 0;
+    world->editHistory->used = 0;
+}
+
+// Each edit returns the number of cells it changed
+int FillBlocks(World* world, int x1, int y1, int x2, int y2, BlockType block) {
+    WorldEdit edit;
+    if (!BeginEdit(&edit, world, x1, y1, x2, y2, true)) return 0;
+    
+    // One row of the block, copied into every row of the box
+    int width = edit.x2 - edit.x1 + 1;
+    for (int i = 0; i < width; i++) {
+        edit.row[i] = block;
+    }
+    for (int y = edit.y1; y <= edit.y2; y++) {
+        WriteRow(&edit, y, edit.x1, width, edit.row);
+    }
+    return FinishEdit(&edit);
+}
+
+int ReplaceBlocks(World* world, int x1, int y1, int x2, int y2, BlockType from, BlockType to) {
+    WorldEdit edit;
+    if (from == to || !BeginEdit(&edit, world, x1, y1, x2, y2, true)) return 0;
+    
+    int width = edit.x2 - edit.x1 + 1;
+    for (int y = edit.y1; y <= edit.y2; y++) {
+        const BlockType* source = &world->blocks[y][edit.x1];
+        for (int i = 0; i < width; i++) {
+            edit.row[i] = source[i] == from ? to : source[i];
+        }
+        WriteRow(&edit, y, edit.x1, width, edit.row);
+    }
+    return FinishEdit(&edit);
+}
+
+#define IS_MARKED(marks, x, y) (((marks)[y][(x) >> 6] >> ((x) & 63)) & 1)
+
+// Replaces the area of like blocks joined edge to edge with (x, y), at
+// most 'limit' cells of it. Spans are filled a row at a time, and the
+// rows above and below are searched for where the area carries on.
+int FloodReplaceBlocks(World* world, int x, int y, BlockType block, int limit) {
+    if (x < 0 || x >= WORLD_WIDTH || y < 0 || y >= WORLD_HEIGHT || limit <= 0) return 0;
+    BlockType target = world->blocks[y][x];
+    if (target == block) return 0;
+    
+    // Every cell can be pushed once from the row above and once from below
+    size_t mark = ArenaMark(&world->frameMemory);
+    int stackCapacity = WORLD_WIDTH * WORLD_HEIGHT * 2;
+    int* stack = (int*)ArenaAlloc(&world->frameMemory, sizeof(int) * stackCapacity, MEMORY_EDITING);
+    uint64_t (*marks)[WORLD_ROW_WORDS] = (uint64_t (*)[WORLD_ROW_WORDS])ArenaAlloc(
+        &world->frameMemory, sizeof(uint64_t) * WORLD_HEIGHT * WORLD_ROW_WORDS, MEMORY_EDITING);
+    if (stack == NULL || marks == NULL) {
+        ArenaRewind(&world->frameMemory, mark);
+        return 0;
+    }
+    memset(marks, 0, sizeof(uint64_t) * WORLD_HEIGHT * WORLD_ROW_WORDS);
+    
+    int minX = x, minY = y, maxX = x, maxY = y;
+    int count = 0;
+    int stackSize = 0;
+    stack[stackSize++] = y * WORLD_WIDTH + x;
+    while (stackSize > 0 && count < limit) {
+        int cell = stack[--stackSize];
+        int seedX = cell % WORLD_WIDTH;
+        int seedY = cell / WORLD_WIDTH;
+        if (IS_MARKED(marks, seedX, seedY)) continue;
+        
+        const BlockType* row = world->blocks[seedY];
+        int left = seedX;
+        int right = seedX;
+        while (left > 0 && row[left - 1] == target && !IS_MARKED(marks, left - 1, seedY)) left--;
+        while (right < WORLD_WIDTH - 1 && row[right + 1] == target && !IS_MARKED(marks, right + 1, seedY)) right++;
+        if (right - left + 1 > limit - count) right = left + (limit - count) - 1;
+        
+        for (int spanX = left; spanX <= right; spanX++) {
+            marks[seedY][spanX >> 6] |= (uint64_t)1 << (spanX & 63);
+        }
+        count += right - left + 1;
+        if (left < minX) minX = left;
+        if (right > maxX) maxX = right;
+        if (seedY < minY) minY = seedY;
+        if (seedY > maxY) maxY = seedY;
+        
+        for (int nextY = seedY - 1; nextY <= seedY + 1; nextY += 2) {
+            if (nextY < 0 || nextY >= WORLD_HEIGHT) continue;
+            
+            const BlockType* next = world->blocks[nextY];
+            bool inRun = false;
+            for (int spanX = left; spanX <= right; spanX++) {
+                bool open = next[spanX] == target && !IS_MARKED(marks, spanX, nextY);
+                if (open && !inRun && stackSize < stackCapacity) stack[stackSize++] = nextY * WORLD_WIDTH + spanX;
+                inRun = open;
+            }
+        }
+    }
+    
+    WorldEdit edit;
+    int changed = 0;
+    if (BeginEdit(&edit, world, minX, minY, maxX, maxY, true)) {
+        int width = maxX - minX + 1;
+        for (int editY = minY; editY <= maxY; editY++) {
+            const BlockType* source = &world->blocks[editY][minX];
+            for (int i = 0; i < width; i++) {
+                edit.row[i] = IS_MARKED(marks, minX + i, editY) ? block : source[i];
+            }
+            WriteRow(&edit, editY, minX, width, edit.row);
+        }
+        changed = FinishEdit(&edit);
+    }
+    ArenaRewind(&world->frameMemory, mark);
+    return changed;
+}
+
+// Anything of the rectangle outside the world is left out
+void CopyBlocks(World* world, int x1, int y1, int x2, int y2, BlockClipboard* clipboard) {
+    clipboard->width = 0;
+    clipboard->height = 0;
+    if (!ClipRect(&x1, &y1, &x2, &y2)) return;
+    
+    clipboard->width = x2 - x1 + 1;
+    clipboard->height = y2 - y1 + 1;
+    for (int row = 0; row < clipboard->height; row++) {
+        memcpy(&clipboard->cells[row * clipboard->width], &world->blocks[y1 + row][x1], sizeof(BlockType) * clipboard->width);
+    }
+}
+
+// Puts the clipboard's top left corner at (x, y). Cells holding 'mask'
+// leave the world as it was, so pasting with BLOCK_AIR keeps only the
+// shape; BLOCK_COUNT pastes every cell.
+int PasteBlocks(World* world, const BlockClipboard* clipboard, int x, int y, BlockType mask) {
+    WorldEdit edit;
+    if (clipboard->width <= 0 || clipboard->height <= 0 ||
+        !BeginEdit(&edit, world, x, y, x + clipboard->width - 1, y + clipboard->height - 1, true)) {
+        return 0;
+    }
+    
+    int width = edit.x2 - edit.x1 + 1;
+    for (int row = edit.y1; row <= edit.y2; row++) {
+        const BlockType* source = &clipboard->cells[(row - y) * clipboard->width + (edit.x1 - x)];
+        if (mask >= BLOCK_COUNT) {
+            WriteRow(&edit, row, edit.x1, width, source);
+            continue;
+        }
+        
+        const BlockType* target = &world->blocks[row][edit.x1];
+        for (int i = 0; i < width; i++) {
+            edit.row[i] = source[i] == mask ? target[i] : source[i];
+        }
+        WriteRow(&edit, row, edit.x1, width, edit.row);
+    }
+    return FinishEdit(&edit);
+}
+
+// Puts back the state before or after a recorded edit, as an edit of its
+// own that is not recorded
+static void ApplyEditRecord(World* world, const EditRecord* record, bool after) {
+    EditHistory* history = world->editHistory;
+    const unsigned char* data = history->data + record->offset + (after ? record->beforeSize : 0);
+    int size = after ? record->afterSize : record->beforeSize;
+    if (!DecodeBlocks(&history->codec, data, size, history->before, record->width * record->height)) return;
+    
+    WorldEdit edit;
+    if (!BeginEdit(&edit, world, record->x, record->y, record->x + record->width - 1, record->y + record->height - 1, false)) {
+        return;
+    }
+    for (int row = 0; row < record->height; row++) {
+        const unsigned char* cells = &history->before[row * record->width];
+        for (int i = 0; i < record->width; i++) {
+            edit.row[i] = (BlockType)cells[i];
+        }
+        WriteRow(&edit, record->y + row, record->x, record->width, edit.row);
+    }
+    FinishEdit(&edit);
+}
+
+bool UndoWorldEdit(World* world) {
+    EditHistory* history = world->editHistory;
+    if (history->position == 0) return false;
+    
+    ApplyEditRecord(world, &history->records[--history->position], false);
+    return true;
+}
+
+bool RedoWorldEdit(World* world) {
+    EditHistory* history = world->editHistory;
+    if (history->position == history->count) return false;
+    
+    ApplyEditRecord(world, &history->records[history->position++], true);
+    return true;
+}
@@ -3,6 +3,8 @@
 
 #include "raylib.h"
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
 
 #define WORLD_WIDTH 200
 #define WORLD_HEIGHT 100 
@@ -11,8 +13,65 @@
 #define SCREEN_HEIGHT 800
 #define INVENTORY_SIZE 9
 #define EXTENDED_INVENTORY_SIZE 27
+#define MAX_STACK_SIZE 64
+#define CONTAINER_MAX_SLOTS 64
+#define CONTAINER_WORDS ((CONTAINER_MAX_SLOTS + 63) / 64)
 #define MAX_REACH_DISTANCE 100.0f
 #define MAX_ANIMALS 20
+#define WORLD_ROW_WORDS ((WORLD_WIDTH + 63) / 64)
+#define MAX_VISIBLE_BLOCKS ((SCREEN_WIDTH / BLOCK_SIZE + 3) * (SCREEN_HEIGHT / BLOCK_SIZE + 3))
+#define MAX_FLOW_FIELDS 4
+#define FLOW_FIELD_RADIUS_X 48
+#define FLOW_FIELD_RADIUS_Y 24
+#define FLOW_FIELD_WIDTH (FLOW_FIELD_RADIUS_X * 2 + 1)
+#define FLOW_FIELD_HEIGHT (FLOW_FIELD_RADIUS_Y * 2 + 1)
+#define FRAME_MEMORY_SIZE (256 * 1024)
+// ArenaAlloc rounds every size up to a multiple of this
+#define MEMORY_ALIGNMENT 16
+#define MEMORY_ALIGNED_SIZE(size) (((size_t)(size) + MEMORY_ALIGNMENT - 1) & ~(size_t)(MEMORY_ALIGNMENT - 1))
+#define REGION_SIZE 16
+#define WORLD_REGION_COLUMNS ((WORLD_WIDTH + REGION_SIZE - 1) / REGION_SIZE)
+#define WORLD_REGION_ROWS ((WORLD_HEIGHT + REGION_SIZE - 1) / REGION_SIZE)
+#define CODEC_MAX_CELLS (WORLD_WIDTH * WORLD_HEIGHT)
+#define CODEC_HASH_BITS 12
+// Worst case for EncodeBlocks: two run bytes per cell, plus LZ framing
+#define CODEC_MAX_ENCODED_SIZE(cells) ((cells) * 2 + (cells) * 2 / 255 + 16)
+// Save files are built in a NetWriter, so none is larger than a packet
+#define SAVE_MAX_FILE_SIZE NET_MAX_PACKET
+#define MAX_PLAYERS 8
+#define BLOCK_TICK_RATE 20
+#define BLOCK_MAX_TICKS_PER_FRAME 4
+#define BLOCK_WHEEL_BITS 6
+#define BLOCK_WHEEL_SLOTS (1 << BLOCK_WHEEL_BITS)
+#define BLOCK_WHEEL_LEVELS 3
+#define RANDOM_TICKS_PER_REGION 3
+#define GRANULAR_STEP_RATE 30
+#define GRANULAR_MAX_STEPS_PER_FRAME 2
+#define GRANULAR_TILE_SIZE 16
+#define GRANULAR_TILE_COLUMNS ((WORLD_WIDTH + GRANULAR_TILE_SIZE - 1) / GRANULAR_TILE_SIZE)
+#define GRANULAR_TILE_ROWS ((WORLD_HEIGHT + GRANULAR_TILE_SIZE - 1) / GRANULAR_TILE_SIZE)
+#define GRANULAR_MAX_WORKERS 8
+#define EDIT_HISTORY_RECORDS 64
+#define EDIT_HISTORY_BYTES (256 * 1024)
+#define MAX_PARTICLES 65536
+// Bump whenever GenerateWorld's output for a seed changes, so cached
+// terrain from the old generator is no longer picked up
+#define TERRAIN_GENERATOR_VERSION 2
+#define MAX_GENERATION_THREADS 64
+#define PARTICLE_DRAW_BATCH 4096
+#define MAX_BLOCK_BREAKS 32
+#define NET_DEFAULT_PORT 27015
+#define NET_TICK_RATE 60
+#define NET_MAX_PACKET 1200
+#define NET_SEQUENCE_BUFFER 256
+#define NET_INPUT_BUFFER 64
+#define NET_INPUT_REDUNDANCY 16
+#define NET_TIMEOUT 5.0
+#define NET_SIM_QUEUE 64
+// Snapshots carry what is within this many cells of a client's player:
+// the screen plus a margin
+#define NET_VIEW_CELLS_X (SCREEN_WIDTH / BLOCK_SIZE / 2 + 4)
+#define NET_VIEW_CELLS_Y (SCREEN_HEIGHT / BLOCK_SIZE / 2 + 4)
 
 typedef enum {
     BLOCK_AIR = 0,
@@ -31,6 +90,16 @@ typedef enum {
     BLOCK_COUNT
 } BlockType;
 
+// Derived per-block properties, packed 64 cells per word along each row
+typedef enum {
+    BLOCK_PLANE_SOLID = 0,
+    BLOCK_PLANE_LIQUID,
+    BLOCK_PLANE_OPAQUE,
+    BLOCK_PLANE_REPLACEABLE,
+    BLOCK_PLANE_GRANULAR,
+    BLOCK_PLANE_COUNT
+} BlockPlane;
+
 typedef enum {
     TOOL_NONE = 0,
     TOOL_WOODEN_PICKAXE,
@@ -50,6 +119,65 @@ typedef enum {
     ANIMAL_COUNT
 } AnimalType;
 
+typedef enum {
+    INPUT_LEFT = 0,
+    INPUT_RIGHT,
+    INPUT_UP,
+    INPUT_DOWN,
+    INPUT_INVENTORY,
+    INPUT_CRAFTING,
+    INPUT_SLOT_1,
+    INPUT_SLOT_2,
+    INPUT_SLOT_3,
+    INPUT_SLOT_4,
+    INPUT_SLOT_5,
+    INPUT_SLOT_6,
+    INPUT_SLOT_7,
+    INPUT_SLOT_8,
+    INPUT_SLOT_9,
+    INPUT_PRIMARY,
+    INPUT_SECONDARY,
+    INPUT_MODIFIER,
+    INPUT_ACTION_COUNT
+} InputAction;
+
+typedef enum {
+    SPAWN_WATER = 0,
+    SPAWN_SURFACE,
+    SPAWN_SET_COUNT
+} SpawnSetType;
+
+typedef enum {
+    MEMORY_WORLD = 0,
+    MEMORY_ENTITIES,
+    MEMORY_PATHFINDING,
+    MEMORY_SPAWNING,
+    MEMORY_FRAME,
+    MEMORY_GENERATION,
+    MEMORY_PHYSICS,
+    MEMORY_RENDER,
+    MEMORY_SIMULATION,
+    MEMORY_EDITING,
+    MEMORY_TAG_COUNT
+} MemoryTag;
+
+typedef enum {
+    NET_ROLE_OFFLINE = 0,
+    NET_ROLE_SERVER,
+    NET_ROLE_CLIENT
+} NetRole;
+
+typedef enum {
+    NET_MESSAGE_CONNECT = 1,
+    NET_MESSAGE_ACCEPT,
+    NET_MESSAGE_REJECT,
+    NET_MESSAGE_INPUT,
+    NET_MESSAGE_SNAPSHOT,
+    NET_MESSAGE_BLOCKS,
+    NET_MESSAGE_DISCONNECT,
+    NET_MESSAGE_REGION
+} NetMessageType;
+
 typedef enum {
     AI_WANDER = 0,
     AI_FLEE,
@@ -57,6 +185,149 @@ typedef enum {
     AI_SWIM
 } AIState;
 
+typedef enum {
+    BLOCK_DRAW_OUTLINED = 0,
+    BLOCK_DRAW_FLAT,
+    BLOCK_DRAW_GRASS_PATCH
+} BlockDrawStyle;
+
+typedef struct {
+    short x, y;
+    unsigned char block;
+    unsigned char style;
+} BlockDrawItem;
+
+typedef enum {
+    PARTICLE_DEBRIS = 0,
+    PARTICLE_SPLASH,
+    PARTICLE_BUBBLE,
+    PARTICLE_PUFF,
+    PARTICLE_KIND_COUNT
+} ParticleKind;
+
+typedef struct {
+    short x, y;
+    unsigned char size;
+    Color color;
+} ParticleDrawItem;
+
+typedef enum {
+    FLOW_NONE = 0,
+    FLOW_LEFT,
+    FLOW_RIGHT,
+    FLOW_JUMP_LEFT,
+    FLOW_JUMP_RIGHT,
+    FLOW_ARRIVED
+} FlowMove;
+
+// One simulation tick worth of input. Gameplay reads only this, never
+// raylib directly, so recorded sessions replay exactly.
+typedef struct {
+    unsigned int down;
+    unsigned int pressed;
+    Vector2 mouse;
+    float wheel;
+    float deltaTime;
+    double time;
+    unsigned int frame;
+} InputFrame;
+
+typedef struct {
+    FILE* file;
+    bool replaying;
+    unsigned int seed;
+    unsigned int frameCount;
+    unsigned int framesRead;
+    uint64_t finalHash;
+} InputRecording;
+
+// Little-endian packet builder and parser. Running past the end sets the
+// flag instead of touching memory, so callers check once at the end.
+typedef struct {
+    unsigned char data[NET_MAX_PACKET];
+    int size;
+    bool overflow;
+} NetWriter;
+
+typedef struct {
+    const unsigned char* data;
+    int size;
+    int position;
+    bool error;
+} NetReader;
+
+// One side of a connection: outgoing sequence numbers, which of the peer's
+// packets arrived (sent back as ack + ackBits on every packet) and which of
+// ours the peer has acknowledged
+typedef struct {
+    unsigned short localSequence;
+    unsigned short remoteSequence;
+    unsigned int receivedBits;
+    bool receivedAny;
+    unsigned short sentSequences[NET_SEQUENCE_BUFFER];
+    double sentTimes[NET_SEQUENCE_BUFFER];
+    bool sentAcked[NET_SEQUENCE_BUFFER];
+    double lastReceiveTime;
+    double roundTripTime;
+    unsigned int bytesSent;
+    unsigned int bytesReceived;
+    unsigned int packetsSent;
+    unsigned int packetsReceived;
+} NetChannel;
+
+// An InputFrame as it goes over the wire, already rounded the way the
+// server will see it
+typedef struct {
+    unsigned int down;
+    short mouseX, mouseY;
+    signed char wheel;
+    unsigned short deltaMicros;
+} NetInput;
+
+// A packet held back by the link simulator until its delivery time
+typedef struct {
+    double deliverTime;
+    uint32_t host;
+    uint16_t port;
+    int size;
+    unsigned char data[NET_MAX_PACKET];
+} NetDelayedPacket;
+
+// Artificial latency, jitter and loss for testing over loopback. Packets
+// in both directions are dropped or queued before the socket sees them
+// (outgoing) or before the caller does (incoming).
+typedef struct {
+    bool enabled;
+    double latency;
+    double jitter;
+    float loss;
+    uint64_t random;
+    NetDelayedPacket outgoing[NET_SIM_QUEUE];
+    NetDelayedPacket incoming[NET_SIM_QUEUE];
+    int outgoingCount;
+    int incomingCount;
+} NetLinkSim;
+
+// Bump allocator over one fixed block; memory is only given back by
+// rewinding 'used'. tagBytes counts what each subsystem allocated.
+typedef struct {
+    unsigned char* base;
+    size_t capacity;
+    size_t used;
+    size_t peak;
+    size_t tagBytes[MEMORY_TAG_COUNT];
+} MemoryArena;
+
+// Fixed-size slots carved from an arena, recycled through an index free list
+typedef struct {
+    unsigned char* items;
+    int* next;
+    size_t itemSize;
+    int capacity;
+    int used;
+    int freeHead;
+} MemoryPool;
+
 typedef struct {
     BlockType type;
     ToolType tool;
@@ -64,14 +335,45 @@ typedef struct {
     int durability;
 } InventorySlot;
 
+// A run of slots plus an index kept in step with them: bitsets of the free
+// slots and, per block type, of its stacks and of those with room left.
+// Change type, tool or count only through the container functions.
+typedef struct {
+    int slotCount;
+    int freeCount;
+    InventorySlot slots[CONTAINER_MAX_SLOTS];
+    uint64_t freeSlots[CONTAINER_WORDS];
+    uint64_t stacks[BLOCK_COUNT][CONTAINER_WORDS];
+    uint64_t partialStacks[BLOCK_COUNT][CONTAINER_WORDS];
+    int itemCounts[BLOCK_COUNT];
+} InventoryContainer;
+
+// What the cursor points at, worked out once a frame by UpdateBlockTarget.
+// A grid ray runs from the player's eye toward the cursor and stops at
+// the first solid block within reach; with none in the way, the cell
+// under the cursor is the target if it is within reach.
+typedef struct {
+    bool valid;
+    bool hitSolid;
+    int blockX, blockY;
+    // Normal of the face the ray came in through; zero if it started
+    // inside the block
+    int faceX, faceY;
+    // Where a block placed now would go: in front of that face, or the
+    // target cell itself when nothing solid was hit
+    int placeX, placeY;
+    // The cursor in world coordinates
+    Vector2 cursor;
+} BlockTarget;
+
 typedef struct {
-    int x, y;
+    float x, y;
     float velX, velY;
     bool onGround;
     bool inWater;
     int health;
-    InventorySlot inventory[INVENTORY_SIZE];
-    InventorySlot extendedInventory[EXTENDED_INVENTORY_SIZE];
+    InventoryContainer hotbar;
+    InventoryContainer backpack;
     int selectedSlot;
     float lastJumpTime;
     float lastClickTime;
@@ -84,6 +386,7 @@ typedef struct {
     float breakProgress;
     int breakingBlockX, breakingBlockY;
     bool craftingOpen;
+    BlockTarget target;
 } Player;
 
 typedef struct {
@@ -99,26 +402,385 @@ typedef struct {
     float animTime;
 } Animal;
 
+// One physics step's worth of animals, a float per animal in each array.
+// IntegrateAnimalLanes reads the first eight and writes velX, velY, newX
+// and newY.
+typedef struct {
+    float* x;
+    float* y;
+    float* velX;
+    float* velY;
+    float* velXScale;
+    float* velXDrive;
+    float* velYScale;
+    float* gravity;
+    float* newX;
+    float* newY;
+    int count;
+} AnimalLanes;
+
+typedef struct {
+    float time;
+    int normalX, normalY;
+    int tileX, tileY;
+    bool hit;
+} SweepResult;
+
+typedef struct {
+    bool hitX;
+    bool hitY;
+} BoxMoveResult;
+
+// Shortest first steps toward one target cell, for every standable cell in
+// a window around it. Any number of followers can read the same field.
+typedef struct {
+    bool active;
+    // Edits since the field was last brought up to date, as one rectangle
+    bool dirty;
+    int dirtyMinX, dirtyMinY, dirtyMaxX, dirtyMaxY;
+    int targetX, targetY;
+    int minX, minY, maxX, maxY;
+    unsigned int lastUsed;
+    unsigned short distance[FLOW_FIELD_WIDTH * FLOW_FIELD_HEIGHT];
+    // The cell each one's first step lands on
+    unsigned short next[FLOW_FIELD_WIDTH * FLOW_FIELD_HEIGHT];
+    unsigned char move[FLOW_FIELD_WIDTH * FLOW_FIELD_HEIGHT];
+} FlowField;
+
+// Dense set of cells (y * WORLD_WIDTH + x) with O(1) insert, remove and
+// uniform sampling
+typedef struct {
+    int count;
+    int cells[WORLD_WIDTH * WORLD_HEIGHT];
+    int slot[WORLD_WIDTH * WORLD_HEIGHT];
+} CellSet;
+
+// Block updates waiting for a future tick, on a hierarchical timing wheel:
+// each level has BLOCK_WHEEL_SLOTS slots, each slot BLOCK_WHEEL_SLOTS
+// times as long as one on the level below. A cell is queued at most once,
+// so the lists are linked through per-cell arrays, and asking again for a
+// cell already queued keeps whichever time is sooner.
+typedef struct {
+    unsigned int tick;
+    float accumulator;
+    int heads[BLOCK_WHEEL_LEVELS * BLOCK_WHEEL_SLOTS];
+    int next[WORLD_WIDTH * WORLD_HEIGHT];
+    int previous[WORLD_WIDTH * WORLD_HEIGHT];
+    unsigned int due[WORLD_WIDTH * WORLD_HEIGHT];
+    // Level and slot the cell is listed in, or -1
+    short bucket[WORLD_WIDTH * WORLD_HEIGHT];
+    int pending;
+    unsigned int processedLastTick;
+    unsigned int maxProcessedPerTick;
+    uint64_t processedTotal;
+    // Random ticks: RANDOM_TICKS_PER_REGION cells a tick in each region
+    // holding any block with a random tick handler, on a generator of
+    // their own so they leave the world's random sequence alone
+    unsigned int randomState;
+    unsigned short randomTickable[WORLD_REGION_ROWS][WORLD_REGION_COLUMNS];
+    int randomRegionsLastTick;
+    uint64_t randomTicksTotal;
+} BlockUpdateQueue;
+
+typedef struct {
+    int minX, minY, maxX, maxY;
+} GranularRect;
+
+typedef struct {
+    int cell;
+    BlockType previous;
+} GranularChange;
+
+// The cells of one tile that may hold a grain able to move: 'dirty'
+// gathers them for the next step, 'active' is what the current step
+// looks at. A step writes into the tile's own log and leaves the rest of
+// the world alone; moving a grain changes two cells.
 typedef struct {
+    GranularRect dirty;
+    GranularRect active;
+    int changeCount;
+    GranularChange changes[GRANULAR_TILE_SIZE * GRANULAR_TILE_SIZE * 2];
+} GranularTile;
+
+typedef struct {
+    unsigned int step;
+    float accumulator;
+    GranularTile tiles[GRANULAR_TILE_ROWS][GRANULAR_TILE_COLUMNS];
+    int activeTilesLastStep;
+    int movedLastStep;
+    uint64_t movedTotal;
+} GranularState;
+
+typedef struct {
+    unsigned short x, y;
+    unsigned char block;
+} BlockBreak;
+
+// Live particles, packed at the front of each array: one dying swaps the
+// last live one into its place, so the free slots are always the tail
+// and emitting is an append.
+typedef struct {
+    int count;
+    unsigned int rngState;
+    float bubbleTimer[MAX_PLAYERS + 1];
+    bool wasInWater[MAX_PLAYERS + 1];
+    int drawnLastFrame;
+    float x[MAX_PARTICLES];
+    float y[MAX_PARTICLES];
+    float velX[MAX_PARTICLES];
+    float velY[MAX_PARTICLES];
+    float gravity[MAX_PARTICLES];
+    float life[MAX_PARTICLES];
+    Color color[MAX_PARTICLES];
+    unsigned char kind[MAX_PARTICLES];
+    // On a server, the blocks players broke since the last snapshot, which
+    // carries them to the clients in view to throw the chips themselves
+    BlockBreak breaks[MAX_BLOCK_BREAKS];
+    int breakCount;
+} ParticleSystem;
+
+// Working space for the block codec, kept by the caller so encoding and
+// decoding never allocate. One per thread using it.
+typedef struct {
+    unsigned char runs[CODEC_MAX_CELLS * 2];
+    int hashTable[1 << CODEC_HASH_BITS];
+} BlockCodec;
+
+// One world edit: the rectangle it covered, before and after, each
+// through the block codec
+typedef struct {
+    int x, y, width, height;
+    int offset;
+    int beforeSize;
+    int afterSize;
+} EditRecord;
+
+// Undo and redo for world edits. The first 'position' records are the
+// ones applied; those past it are what redo brings back. The oldest
+// records go once either the records or the bytes run out.
+typedef struct {
+    int count;
+    int position;
+    int used;
+    EditRecord records[EDIT_HISTORY_RECORDS];
+    unsigned char data[EDIT_HISTORY_BYTES];
+    BlockCodec codec;
+    unsigned char before[WORLD_WIDTH * WORLD_HEIGHT];
+    unsigned char after[WORLD_WIDTH * WORLD_HEIGHT];
+} EditHistory;
+
+// Blocks lifted out of the world by CopyBlocks, in rows
+typedef struct {
+    int width, height;
+    BlockType cells[WORLD_WIDTH * WORLD_HEIGHT];
+} BlockClipboard;
+
+// Lives at the start of its own arena, together with everything it points
+// to, so a world is one allocation. Create with CreateWorld.
+typedef struct {
+    MemoryArena memory;
+    MemoryArena frameMemory;
+    MemoryPool animalPool;
+    unsigned int seed;
+    unsigned int rngState;
+    InputFrame input;
     BlockType blocks[WORLD_HEIGHT][WORLD_WIDTH];
+    uint64_t blockPlanes[BLOCK_PLANE_COUNT][WORLD_HEIGHT][WORLD_ROW_WORDS];
     Camera2D camera;
+    NetRole role;
     Player player;
-    Animal animals[MAX_ANIMALS];
+    Player players[MAX_PLAYERS];
+    bool playerActive[MAX_PLAYERS];
+    uint64_t modifiedCells[WORLD_HEIGHT][WORLD_ROW_WORDS];
+    uint64_t changedCells[WORLD_HEIGHT][WORLD_ROW_WORDS];
+    bool unsavedRegions[WORLD_REGION_ROWS][WORLD_REGION_COLUMNS];
+    // Saved regions LoadWorld found that streaming has not laid over the
+    // generated terrain yet. Nothing simulates or saves them until it has.
+    bool unloadedRegions[WORLD_REGION_ROWS][WORLD_REGION_COLUMNS];
+    // GenerateWorld's ground level per column, kept here rather than in
+    // frame scratch so generation has nothing to allocate and cannot fail
+    int surfaceHeights[WORLD_WIDTH];
+    Animal* animals;
     int animalCount;
+    FlowField* flowFields;
+    unsigned int flowFieldStamp;
+    CellSet* spawnSets;
+    int surfaceRow[WORLD_WIDTH];
+    BlockUpdateQueue* blockUpdates;
+    GranularState* granular;
+    EditHistory* editHistory;
+    ParticleSystem* particles;
 } World;
 
+// Running totals since ServerStart
+typedef struct {
+    int clients;
+    unsigned int ticks;
+    uint64_t tickNanos;
+    uint64_t maxTickNanos;
+    uint64_t bytesSent;
+    uint64_t bytesReceived;
+    uint64_t packetsSent;
+    uint64_t blockBytesSent;
+    uint64_t snapshotBytesSent;
+} ServerStats;
+
+// What the save thread reports back once it has finished a save
+typedef struct {
+    bool ok;
+    int regionsWritten;
+    size_t bytesWritten;
+    double copySeconds;
+    double writeSeconds;
+} SaveResult;
+
+typedef struct {
+    const char* backend;
+    unsigned int regionsQueued;
+    unsigned int regionsLoaded;
+    // Regions that were already resident when they first came on screen,
+    // and those the frame had to wait for
+    unsigned int hits;
+    unsigned int misses;
+    double stallSeconds;
+    double maxStallSeconds;
+} RegionStreamStats;
+
+// Client end of a connection. The world is generated locally from the
+// seed the server hands out; after that only diffs and snapshots arrive.
+// With prediction on, the local player moves at once on our own input and
+// is rewound to each snapshot and replayed over the inputs the server has
+// not seen yet.
+typedef struct {
+    World* world;
+    intptr_t socket;
+    unsigned int serverHost;
+    unsigned short serverPort;
+    NetChannel channel;
+    bool connected;
+    bool disconnected;
+    int playerId;
+    double lastConnectTime;
+    unsigned int inputSequence;
+    unsigned int ackedInputSequence;
+    NetInput inputs[NET_INPUT_BUFFER];
+    // Each sent input as the server will apply it, so a replay sees the
+    // same frame times and key edges
+    InputFrame predictedInput;
+    InputFrame predictedFrames[NET_INPUT_BUFFER];
+    bool predict;
+    unsigned int corrections;
+    float lastCorrection;
+    float maxCorrection;
+    NetLinkSim link;
+    unsigned int lastSnapshotTick;
+    unsigned int cellSequence[WORLD_HEIGHT][WORLD_WIDTH];
+} NetClient;
+
+void InitBlockRegistry(void);
 bool IsBlockSolid(BlockType block);
 Color GetBlockColor(BlockType block);
 const char* GetBlockName(BlockType block);
+BlockDrawStyle GetBlockDrawStyle(BlockType block);
+float GetBlockHardness(BlockType block);
+bool CanToolBreak(ToolType tool, BlockType block);
+float GetBreakTime(BlockType block, ToolType tool);
+int GetBlockUpdateDelay(BlockType block);
+
+void SetBlock(World* world, int x, int y, BlockType block);
+void CommitBlockChange(World* world, int x, int y, BlockType previous);
+void CommitBlockRect(World* world, int x1, int y1, int x2, int y2, const uint64_t (*changed)[WORLD_ROW_WORDS],
+                     bool woodRemoved);
+void ResetWorldEdits(World* world);
+int FillBlocks(World* world, int x1, int y1, int x2, int y2, BlockType block);
+int ReplaceBlocks(World* world, int x1, int y1, int x2, int y2, BlockType from, BlockType to);
+int FloodReplaceBlocks(World* world, int x, int y, BlockType block, int limit);
+void CopyBlocks(World* world, int x1, int y1, int x2, int y2, BlockClipboard* clipboard);
+int PasteBlocks(World* world, const BlockClipboard* clipboard, int x, int y, BlockType mask);
+bool UndoWorldEdit(World* world);
+bool RedoWorldEdit(World* world);
+void ResetBlockUpdates(World* world);
+void ScheduleBlockUpdate(World* world, int x, int y, int delay);
+void NotifyBlockChanged(World* world, int x, int y, BlockType previous);
+void NotifyBlockRectChanged(World* world, int x1, int y1, int x2, int y2, bool woodRemoved);
+void UpdateBlockTicks(World* world, float deltaTime);
+void StartGranularWorkers(int count);
+void StopGranularWorkers(void);
+int GetGranularWorkerCount(void);
+void ResetGranular(World* world);
+void MarkGranularDirty(World* world, int x, int y);
+void MarkGranularDirtyRect(World* world, int x1, int y1, int x2, int y2);
+void UpdateGranular(World* world, float deltaTime);
+unsigned int GetBlockPlaneMask(BlockType block);
+int CountTrailingZeros64(uint64_t bits);
+int CountBits64(uint64_t bits);
+void UpdateBlockPlanes(World* world, int x, int y, BlockType block);
+void UpdateBlockPlaneRect(World* world, int x1, int y1, int x2, int y2);
+void RebuildBlockPlanes(World* world);
+bool TestBlockPlane(World* world, BlockPlane plane, int x, int y);
+int FindBlockPlaneInRow(World* world, BlockPlane plane, int y, int x1, int x2);
+bool AnyBlockPlaneInRect(World* world, BlockPlane plane, int x1, int y1, int x2, int y2);
+
+SweepResult SweepBox(World* world, float x, float y, float width, float height, float dx, float dy);
+BoxMoveResult MoveBox(World* world, float* x, float* y, float width, float height, float dx, float dy);
+
+bool ArenaInit(MemoryArena* arena, size_t capacity);
+bool ArenaInitFrom(MemoryArena* arena, MemoryArena* parent, size_t capacity, MemoryTag tag);
+void ArenaFree(MemoryArena* arena);
+void* ArenaAlloc(MemoryArena* arena, size_t size, MemoryTag tag);
+size_t ArenaMark(MemoryArena* arena);
+void ArenaRewind(MemoryArena* arena, size_t mark);
+void ArenaReset(MemoryArena* arena);
+bool PoolInit(MemoryPool* pool, MemoryArena* arena, size_t itemSize, int capacity, MemoryTag tag);
+size_t PoolArenaSize(size_t itemSize, int capacity);
+void PoolReset(MemoryPool* pool);
+void* PoolAlloc(MemoryPool* pool);
+void PoolFree(MemoryPool* pool, void* item);
+const char* GetMemoryTagName(MemoryTag tag);
 
-void InitGame(World* world);
+World* CreateWorld(void);
+void DestroyWorld(World* world);
+void InitGame(World* world, unsigned int seed);
+int WorldRandom(World* world, int min, int max);
+
+void PollInput(World* world);
+void ApplyInputFrame(InputFrame* input, unsigned int down, short mouseX, short mouseY, float wheel, float deltaTime);
+bool InputDown(const InputFrame* input, InputAction action);
+bool InputPressed(const InputFrame* input, InputAction action);
+bool BeginInputRecording(InputRecording* recording, const char* path, unsigned int seed);
+void RecordInputFrame(InputRecording* recording, const InputFrame* input);
+void EndInputRecording(InputRecording* recording, World* world);
+bool BeginInputReplay(InputRecording* recording, const char* path);
+bool ReplayInputFrame(InputRecording* recording, World* world);
+uint64_t HashWorldState(World* world);
 void InitPlayer(Player* player);
-void UpdatePlayer(World* world, float deltaTime);
-void HandleBlockInteraction(World* world, float deltaTime);
-void HandleInventoryInput(World* world);
-void HandleExtendedInventory(World* world);
-void HandleCrafting(World* world);
+bool CheckCollision(World* world, int x, int y);
+bool IsInWater(World* world, int x, int y, int width, int height);
+void InitContainer(InventoryContainer* container, int slotCount);
+void SetContainerSlot(InventoryContainer* container, int index, InventorySlot slot);
+void SwapContainerSlots(InventoryContainer* a, int indexA, InventoryContainer* b, int indexB);
+int FindFreeContainerSlot(InventoryContainer* container);
+int AddToContainer(InventoryContainer* container, BlockType type, int count);
+int RemoveFromContainer(InventoryContainer* container, BlockType type, int count);
+int CountSlotsEmptiedByRemoving(const InventoryContainer* container, BlockType type, int count);
+int TakeFromContainerSlot(InventoryContainer* container, int index, int count);
+int MoveBetweenContainers(InventoryContainer* from, InventoryContainer* to, BlockType type, int count);
+bool MoveSlotToContainer(InventoryContainer* from, int index, InventoryContainer* to);
+
+int GetItemCount(Player* player, BlockType blockType);
+int AddToInventory(Player* player, BlockType blockType, int count);
+int RemoveFromInventory(Player* player, BlockType blockType, int count);
+void UpdatePlayer(World* world, Player* player, const InputFrame* input, float deltaTime);
+void UpdateBlockTarget(World* world, Player* player, const InputFrame* input);
+void HandleBlockInteraction(World* world, Player* player, const InputFrame* input, float deltaTime);
+void HandleInventoryInput(Player* player, const InputFrame* input);
+void HandleExtendedInventory(Player* player, const InputFrame* input);
+void HandleCrafting(Player* player, const InputFrame* input);
+void StepPlayer(World* world, Player* player, const InputFrame* input);
+Camera2D GetPlayerCamera(const Player* player);
+Player* GetNearestPlayer(World* world, float x, float y);
 
+int BuildWorldDrawList(World* world, BlockDrawItem* items, int capacity);
 void DrawWorld(World* world);
 void DrawPlayer(World* world);
 void DrawUI(World* world);
@@ -127,19 +789,137 @@ void DrawExtendedInventory(World* world);
 void DrawCrafting(World* world);
 void DrawAnimals(World* world);
 
-float GetBlockHardness(BlockType block);
+void ResetParticles(World* world);
+int EmitParticles(World* world, ParticleKind kind, float x, float y, int count, Color color);
+void EmitBlockParticles(World* world, int x, int y, BlockType block);
+void UpdateParticles(World* world, float deltaTime);
+int BuildParticleDrawList(World* world, int* next, ParticleDrawItem* items, int capacity);
+void DrawParticles(World* world);
+
 float GetToolSpeed(ToolType tool);
-bool CanToolBreak(ToolType tool, BlockType block);
-float GetBreakTime(BlockType block, ToolType tool);
 const char* GetToolName(ToolType tool);
 int GetToolDurability(ToolType tool);
+int GetCraftableCount(Player* player, ToolType tool);
 bool CanCraftTool(Player* player, ToolType tool);
+int GetCraftMaxCount(Player* player, ToolType tool);
+int CraftTool(Player* player, ToolType tool, int count);
+void GetRecipeText(ToolType tool, char* buffer, int size);
+
+void ResetFlowFields(World* world);
+void InvalidateFlowFields(World* world, int x, int y, BlockType previous);
+void InvalidateFlowFieldRect(World* world, int x1, int y1, int x2, int y2);
+FlowField* AcquireFlowField(World* world, int targetX, int targetY);
+FlowMove GetFlowMove(World* world, int targetX, int targetY, int x, int y);
+
+void RebuildSpawnSets(World* world);
+void UpdateSpawnSets(World* world, int x, int y);
+void UpdateSpawnSetRect(World* world, int x1, int y1, int x2, int y2);
+bool PickSpawnCell(World* world, SpawnSetType type, int* x, int* y);
 
 void GenerateWorld(World* world);
+void GenerateWorldThreaded(World* world, int threadCount);
 void InitAnimals(World* world);
-void SpawnAnimal(World* world, AnimalType type, float x, float y);
+bool CheckAnimalCollision(World* world, float x, float y, int width, int height);
+bool IsAnimalInWater(World* world, float x, float y, int width, int height);
+Animal* SpawnAnimal(World* world, AnimalType type, float x, float y);
+void DespawnAnimal(World* world, Animal* animal);
+void EmitAnimalPuff(World* world, const Animal* animal);
 void UpdateAnimals(World* world, float deltaTime);
+void IntegrateAnimalLanes(const AnimalLanes* lanes, float deltaTime);
+bool SetAnimalSimdWidth(int width);
+int GetAnimalSimdWidth(void);
 Color GetAnimalColor(AnimalType type);
 const char* GetAnimalName(AnimalType type);
 
+double NetGetTime(void);
+void NetWriteU8(NetWriter* writer, unsigned int value);
+void NetWriteU16(NetWriter* writer, unsigned int value);
+void NetWriteU32(NetWriter* writer, unsigned int value);
+void NetWriteFloat(NetWriter* writer, float value);
+void NetWriteVarUint(NetWriter* writer, unsigned int value);
+void NetReaderInit(NetReader* reader, const void* data, int size);
+unsigned int NetReadU8(NetReader* reader);
+unsigned int NetReadU16(NetReader* reader);
+unsigned int NetReadU32(NetReader* reader);
+float NetReadFloat(NetReader* reader);
+unsigned int NetReadVarUint(NetReader* reader);
+void NetInitChannel(NetChannel* channel);
+unsigned short NetBeginPacket(NetWriter* writer, NetChannel* channel, NetMessageType type);
+NetMessageType NetPeekType(const void* data, int size);
+bool NetReadHeader(NetReader* reader, NetChannel* channel, NetMessageType* type);
+bool NetIsAcked(const NetChannel* channel, unsigned short sequence);
+bool NetSendPacket(NetLinkSim* link, intptr_t socket, unsigned int host, unsigned short port, NetChannel* channel, const NetWriter* writer);
+NetInput NetQuantizeInput(const InputFrame* input);
+void NetWriteInput(NetWriter* writer, const NetInput* input);
+NetInput NetReadInput(NetReader* reader);
+void NetApplyInput(InputFrame* frame, const NetInput* input);
+void NetInitLinkSim(NetLinkSim* link, double roundTrip, double jitter, float loss, unsigned int seed);
+bool NetLinkSend(NetLinkSim* link, intptr_t socket, uint32_t host, uint16_t port, const void* data, int size);
+int NetLinkReceive(NetLinkSim* link, intptr_t socket, uint32_t* host, uint16_t* port, void* buffer, int capacity);
+
+bool ServerStart(unsigned short port, unsigned int seed);
+void ServerTick(void);
+void ServerStop(void);
+void GetServerStats(ServerStats* stats);
+int RunServer(unsigned short port, unsigned int seed, double duration);
+
+int EncodeBlocks(BlockCodec* codec, const unsigned char* cells, int count, unsigned char* output, int capacity);
+bool DecodeBlocks(BlockCodec* codec, const unsigned char* input, int size, unsigned char* cells, int count);
+
+bool SaveInit(const char* directory);
+bool RequestSave(World* world);
+bool PollSaveResult(World* world, SaveResult* result);
+void WaitForSave(void);
+void SaveShutdown(void);
+bool LoadWorld(World* world, const char* directory);
+void GetSavedRegionPath(char* path, int capacity, const char* directory, int regionX, int regionY);
+bool ApplySavedRegion(World* world, int regionX, int regionY, const void* data, int size);
+void SetRegionLoaded(World* world, int regionX, int regionY);
+bool IsCellLoaded(const World* world, int x, int y);
+bool WriteFileAtomic(const char* path, const void* data, size_t size);
+
+void SetTerrainCacheDirectory(const char* directory);
+void GetTerrainCachePath(char* path, int capacity, const char* directory, unsigned int seed);
+bool WriteTerrainCache(World* world, const char* directory);
+bool LoadTerrainCache(World* world);
+
+bool StartRegionStreaming(const char* directory, bool prefetch);
+void UpdateRegionStreaming(World* world, const Player* player);
+void StopRegionStreaming(void);
+void GetRegionStreamStats(RegionStreamStats* stats);
+
+bool ClientConnect(NetClient* client, World* world, const char* host, unsigned short port);
+bool ClientWaitForAccept(NetClient* client, double timeout);
+void ClientSendInput(NetClient* client, const InputFrame* input);
+void ClientReceive(NetClient* client);
+void ClientSimulateLink(NetClient* client, double roundTrip, double jitter, float loss);
+void ClientDisconnect(NetClient* client);
+
+// Frame profiler. Compiled in for Debug builds, or with --profiler. Zones
+// nest; PROFILE_SCOPE wraps the statement or block that follows it, which
+// must not be left with break or return.
+#if defined(ENABLE_PROFILER)
+void ProfilerBeginFrame(void);
+void ProfilerEndFrame(void);
+void ProfilerBeginZone(const char* name);
+void ProfilerEndZone(void);
+bool ProfilerExportTrace(const char* path);
+void ProfilerUpdateOverlay(void);
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) \
+    for (int PROFILE_CONCAT(profileZone, __LINE__) = (ProfilerBeginZone(name), 1); \
+         PROFILE_CONCAT(profileZone, __LINE__); \
+         PROFILE_CONCAT(profileZone, __LINE__) = (ProfilerEndZone(), 0))
+#define PROFILE_FRAME_BEGIN() ProfilerBeginFrame()
+#define PROFILE_FRAME_END() ProfilerEndFrame()
+#define PROFILE_OVERLAY() ProfilerUpdateOverlay()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FRAME_BEGIN() ((void)0)
+#define PROFILE_FRAME_END() ((void)0)
+#define PROFILE_OVERLAY() ((void)0)
+#endif
+
 #endif
\ No newline at end of file
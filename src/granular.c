@@ -0,0 +1,316 @@
+#include "game.h"
+#include "platform.h"
+#include <string.h>
+
+// Sand falls as a cellular automaton. A step looks only at the dirty
+// rectangle of each tile, where cells changed last step, and a tile never
+// reaches more than one cell past its own edge. Tiles two apart in both
+// directions therefore never touch the same cell, so each step runs in
+// four passes over a checkerboard, and the tiles of a pass go to the
+// workers with nothing shared between them. Workers only store blocks and
+// log what they changed; the main thread commits the logs afterwards, in
+// tile order, which also marks where the next step must look.
+
+// Stepping this many active cells takes about as long as waking one
+// worker and waiting for it: some 13 ns a cell against 6-9 us a worker,
+// measured on the sand pile. Splitting a pass across the caller and n
+// workers only pays once it has more than (n + 1) times this many.
+#define GRANULAR_WAKE_CELLS 640
+#define GRANULAR_TILE_COUNT (GRANULAR_TILE_ROWS * GRANULAR_TILE_COLUMNS)
+
+_Static_assert(GRANULAR_TILE_SIZE == REGION_SIZE, "a tile must be a region, so regions load a tile at a time");
+
+static struct {
+    int threadCount;
+    PlatformThread* threads[GRANULAR_MAX_WORKERS];
+    PlatformMutex* mutex;
+    PlatformCondition* start;
+    PlatformCondition* finished;
+    unsigned int generation;
+    int working;
+    bool quit;
+    // The pass being run; the main thread takes a share as well
+    World* world;
+    GranularTile* batch[GRANULAR_TILE_COUNT];
+    int batchCount;
+} workers;
+
+static bool CanGrainEnter(BlockType block) {
+    return (GetBlockPlaneMask(block) & (1u << BLOCK_PLANE_REPLACEABLE)) != 0;
+}
+
+// Which way a grain tries first when it cannot fall straight, mixed from
+// the cell and the step so piles spread evenly without touching the
+// world's random state from several threads
+static int PickSide(int x, int y, unsigned int step) {
+    unsigned int hash = (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ^ step * 83492791u;
+    hash ^= hash >> 15;
+    hash *= 2246822519u;
+    hash ^= hash >> 13;
+    return (hash & 1) ? 1 : -1;
+}
+
+static void MoveGrain(World* world, GranularTile* tile, int x, int y, int toX, int toY) {
+    BlockType grain = world->blocks[y][x];
+    BlockType displaced = world->blocks[toY][toX];
+    world->blocks[toY][toX] = grain;
+    world->blocks[y][x] = displaced;
+    tile->changes[tile->changeCount++] = (GranularChange){ y * WORLD_WIDTH + x, grain };
+    tile->changes[tile->changeCount++] = (GranularChange){ toY * WORLD_WIDTH + toX, displaced };
+}
+
+// Rows run bottom up, so a grain only ever lands on a row the tile is done
+// with. Candidates come from the granular plane, which still shows the
+// world as the step found it: every grain the tile may move is in it, and
+// grains that have already landed this step are not. Grains stop at the
+// edge of a region whose saved blocks are not in yet.
+static void StepTile(World* world, GranularTile* tile, unsigned int step) {
+    const GranularRect* rect = &tile->active;
+    for (int y = rect->maxY; y >= rect->minY; y--) {
+        if (y + 1 >= WORLD_HEIGHT) continue;
+        
+        for (int word = rect->minX >> 6; word <= rect->maxX >> 6; word++) {
+            uint64_t bits = world->blockPlanes[BLOCK_PLANE_GRANULAR][y][word];
+            if (word == rect->minX >> 6) bits &= ~(uint64_t)0 << (rect->minX & 63);
+            if (word == rect->maxX >> 6 && (rect->maxX & 63) != 63) bits &= ((uint64_t)1 << ((rect->maxX & 63) + 1)) - 1;
+            
+            while (bits != 0) {
+                int x = word * 64 + CountTrailingZeros64(bits);
+                bits &= bits - 1;
+                if (!(GetBlockPlaneMask(world->blocks[y][x]) & (1u << BLOCK_PLANE_GRANULAR))) continue;
+                
+                if (CanGrainEnter(world->blocks[y + 1][x]) && IsCellLoaded(world, x, y + 1)) {
+                    MoveGrain(world, tile, x, y, x, y + 1);
+                    continue;
+                }
+                int side = PickSide(x, y, step);
+                for (int attempt = 0; attempt < 2; attempt++, side = -side) {
+                    int toX = x + side;
+                    if (toX >= 0 && toX < WORLD_WIDTH && CanGrainEnter(world->blocks[y][toX]) &&
+                        CanGrainEnter(world->blocks[y + 1][toX]) && IsCellLoaded(world, toX, y + 1)) {
+                        MoveGrain(world, tile, x, y, toX, y + 1);
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+// Worker 'index' of 'count' takes every count-th tile of the batch
+static void StepBatch(int index, int count) {
+    World* world = workers.world;
+    for (int i = index; i < workers.batchCount; i += count) {
+        StepTile(world, workers.batch[i], world->granular->step);
+    }
+}
+
+static void GranularWorker(void* argument) {
+    int index = (int)(intptr_t)argument;
+    unsigned int seen = 0;
+    for (;;) {
+        PlatformLockMutex(workers.mutex);
+        while (workers.generation == seen && !workers.quit) {
+            PlatformWaitCondition(workers.start, workers.mutex);
+        }
+        if (workers.quit) {
+            PlatformUnlockMutex(workers.mutex);
+            return;
+        }
+        seen = workers.generation;
+        PlatformUnlockMutex(workers.mutex);
+        
+        StepBatch(index, workers.threadCount + 1);
+        
+        PlatformLockMutex(workers.mutex);
+        if (--workers.working == 0) PlatformSignalCondition(workers.finished);
+        PlatformUnlockMutex(workers.mutex);
+    }
+}
+
+// Starts 'count' threads to share large steps with the calling thread.
+// With none, every step runs on the calling thread.
+void StartGranularWorkers(int count) {
+    StopGranularWorkers();
+    if (count > GRANULAR_MAX_WORKERS) count = GRANULAR_MAX_WORKERS;
+    if (count <= 0) return;
+    
+    workers.mutex = PlatformCreateMutex();
+    workers.start = PlatformCreateCondition();
+    workers.finished = PlatformCreateCondition();
+    if (workers.mutex == NULL || workers.start == NULL || workers.finished == NULL) {
+        StopGranularWorkers();
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        workers.threads[i] = PlatformCreateThread(GranularWorker, (void*)(intptr_t)(i + 1));
+        if (workers.threads[i] == NULL) break;
+        workers.threadCount++;
+    }
+}
+
+void StopGranularWorkers(void) {
+    if (workers.mutex != NULL) {
+        PlatformLockMutex(workers.mutex);
+        workers.quit = true;
+        PlatformBroadcastCondition(workers.start);
+        PlatformUnlockMutex(workers.mutex);
+    }
+    for (int i = 0; i < workers.threadCount; i++) {
+        PlatformJoinThread(workers.threads[i]);
+    }
+    PlatformDestroyCondition(workers.start);
+    PlatformDestroyCondition(workers.finished);
+    PlatformDestroyMutex(workers.mutex);
+    memset(&workers, 0, sizeof(workers));
+}
+
+int GetGranularWorkerCount(void) {
+    return workers.threadCount;
+}
+
+static void RunPass(World* world, GranularTile** tiles, int count) {
+    workers.world = world;
+    int cells = 0;
+    for (int i = 0; i < count; i++) {
+        const GranularRect* rect = &tiles[i]->active;
+        cells += (rect->maxX - rect->minX + 1) * (rect->maxY - rect->minY + 1);
+        workers.batch[i] = tiles[i];
+    }
+    workers.batchCount = count;
+    if (workers.threadCount == 0 || count < 2 || cells < (workers.threadCount + 1) * GRANULAR_WAKE_CELLS) {
+        StepBatch(0, 1);
+        return;
+    }
+    
+    PlatformLockMutex(workers.mutex);
+    workers.generation++;
+    workers.working = workers.threadCount;
+    PlatformBroadcastCondition(workers.start);
+    PlatformUnlockMutex(workers.mutex);
+    
+    StepBatch(0, workers.threadCount + 1);
+    
+    PlatformLockMutex(workers.mutex);
+    while (workers.working > 0) {
+        PlatformWaitCondition(workers.finished, workers.mutex);
+    }
+    PlatformUnlockMutex(workers.mutex);
+}
+
+static bool IsRectEmpty(const GranularRect* rect) {
+    return rect->minX > rect->maxX;
+}
+
+static const GranularRect emptyRect = { WORLD_WIDTH, WORLD_HEIGHT, -1, -1 };
+
+void ResetGranular(World* world) {
+    GranularState* state = world->granular;
+    state->step = 0;
+    state->accumulator = 0;
+    state->activeTilesLastStep = 0;
+    state->movedLastStep = 0;
+    state->movedTotal = 0;
+    for (int ty = 0; ty < GRANULAR_TILE_ROWS; ty++) {
+        for (int tx = 0; tx < GRANULAR_TILE_COLUMNS; tx++) {
+            state->tiles[ty][tx].dirty = emptyRect;
+            state->tiles[ty][tx].active = emptyRect;
+            state->tiles[ty][tx].changeCount = 0;
+        }
+    }
+}
+
+// Called for changed cells. A grain can start moving when the cell, or
+// one beside or below it, changes, so the next step looks at the cells
+// and their neighbours, in whichever tiles they fall.
+void MarkGranularDirtyRect(World* world, int x1, int y1, int x2, int y2) {
+    if (world->role == NET_ROLE_CLIENT) return;
+    
+    int minX = x1 > 0 ? x1 - 1 : 0;
+    int minY = y1 > 0 ? y1 - 1 : 0;
+    int maxX = x2 + 1 < WORLD_WIDTH ? x2 + 1 : WORLD_WIDTH - 1;
+    int maxY = y2 + 1 < WORLD_HEIGHT ? y2 + 1 : WORLD_HEIGHT - 1;
+    for (int ty = minY / GRANULAR_TILE_SIZE; ty <= maxY / GRANULAR_TILE_SIZE; ty++) {
+        for (int tx = minX / GRANULAR_TILE_SIZE; tx <= maxX / GRANULAR_TILE_SIZE; tx++) {
+            GranularRect* dirty = &world->granular->tiles[ty][tx].dirty;
+            int tileX = tx * GRANULAR_TILE_SIZE;
+            int tileY = ty * GRANULAR_TILE_SIZE;
+            int clipMinX = minX > tileX ? minX : tileX;
+            int clipMinY = minY > tileY ? minY : tileY;
+            int clipMaxX = maxX < tileX + GRANULAR_TILE_SIZE - 1 ? maxX : tileX + GRANULAR_TILE_SIZE - 1;
+            int clipMaxY = maxY < tileY + GRANULAR_TILE_SIZE - 1 ? maxY : tileY + GRANULAR_TILE_SIZE - 1;
+            if (clipMinX < dirty->minX) dirty->minX = clipMinX;
+            if (clipMinY < dirty->minY) dirty->minY = clipMinY;
+            if (clipMaxX > dirty->maxX) dirty->maxX = clipMaxX;
+            if (clipMaxY > dirty->maxY) dirty->maxY = clipMaxY;
+        }
+    }
+}
+
+void MarkGranularDirty(World* world, int x, int y) {
+    MarkGranularDirtyRect(world, x, y, x, y);
+}
+
+static void RunGranularStep(World* world) {
+    GranularState* state = world->granular;
+    state->step++;
+    
+    GranularTile* passes[4][GRANULAR_TILE_COUNT];
+    int passCounts[4] = { 0 };
+    int activeTiles = 0;
+    for (int ty = 0; ty < GRANULAR_TILE_ROWS; ty++) {
+        for (int tx = 0; tx < GRANULAR_TILE_COLUMNS; tx++) {
+            GranularTile* tile = &state->tiles[ty][tx];
+            tile->changeCount = 0;
+            // A tile is a region. One that is not loaded yet keeps its
+            // dirty cells for once it is.
+            if (!IsCellLoaded(world, tx * GRANULAR_TILE_SIZE, ty * GRANULAR_TILE_SIZE)) {
+                tile->active = emptyRect;
+                continue;
+            }
+            tile->active = tile->dirty;
+            tile->dirty = emptyRect;
+            if (IsRectEmpty(&tile->active)) continue;
+            
+            int pass = (ty & 1) * 2 + (tx & 1);
+            passes[pass][passCounts[pass]++] = tile;
+            activeTiles++;
+        }
+    }
+    
+    for (int pass = 0; pass < 4; pass++) {
+        if (passCounts[pass] > 0) RunPass(world, passes[pass], passCounts[pass]);
+    }
+    
+    int moved = 0;
+    for (int ty = 0; ty < GRANULAR_TILE_ROWS; ty++) {
+        for (int tx = 0; tx < GRANULAR_TILE_COLUMNS; tx++) {
+            GranularTile* tile = &state->tiles[ty][tx];
+            for (int i = 0; i < tile->changeCount; i++) {
+                int cell = tile->changes[i].cell;
+                CommitBlockChange(world, cell % WORLD_WIDTH, cell / WORLD_WIDTH, tile->changes[i].previous);
+            }
+            moved += tile->changeCount / 2;
+        }
+    }
+    
+    state->activeTilesLastStep = activeTiles;
+    state->movedLastStep = moved;
+    state->movedTotal += moved;
+}
+
+// Runs the steps that fall within 'deltaTime', at most
+// GRANULAR_MAX_STEPS_PER_FRAME of them. A step costs what is dirty, so a
+// settled world costs a pass over the tile table.
+void UpdateGranular(World* world, float deltaTime) {
+    GranularState* state = world->granular;
+    state->accumulator += deltaTime;
+    
+    int steps = 0;
+    while (state->accumulator >= 1.0f / GRANULAR_STEP_RATE && steps < GRANULAR_MAX_STEPS_PER_FRAME) {
+        state->accumulator -= 1.0f / GRANULAR_STEP_RATE;
+        RunGranularStep(world);
+        steps++;
+    }
+    if (state->accumulator >= 1.0f / GRANULAR_STEP_RATE) state->accumulator = 0;
+}
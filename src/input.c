@@ -0,0 +1,218 @@
+#include "game.h"
+#include <string.h>
+
+#define REPLAY_MAGIC 0x50525856u
+#define REPLAY_VERSION 2
+
+// Up to three keys per action, zero terminated
+static const int actionKeys[INPUT_ACTION_COUNT][3] = {
+    [INPUT_LEFT]      = { KEY_A, KEY_LEFT },
+    [INPUT_RIGHT]     = { KEY_D, KEY_RIGHT },
+    [INPUT_UP]        = { KEY_SPACE, KEY_W, KEY_UP },
+    [INPUT_DOWN]      = { KEY_S, KEY_DOWN },
+    [INPUT_INVENTORY] = { KEY_E },
+    [INPUT_CRAFTING]  = { KEY_C },
+    [INPUT_SLOT_1]    = { KEY_ONE },
+    [INPUT_SLOT_2]    = { KEY_TWO },
+    [INPUT_SLOT_3]    = { KEY_THREE },
+    [INPUT_SLOT_4]    = { KEY_FOUR },
+    [INPUT_SLOT_5]    = { KEY_FIVE },
+    [INPUT_SLOT_6]    = { KEY_SIX },
+    [INPUT_SLOT_7]    = { KEY_SEVEN },
+    [INPUT_SLOT_8]    = { KEY_EIGHT },
+    [INPUT_SLOT_9]    = { KEY_NINE },
+    [INPUT_MODIFIER]  = { KEY_LEFT_SHIFT, KEY_RIGHT_SHIFT },
+};
+
+bool InputDown(const InputFrame* input, InputAction action) {
+    return (input->down >> action) & 1;
+}
+
+bool InputPressed(const InputFrame* input, InputAction action) {
+    return (input->pressed >> action) & 1;
+}
+
+// Everything the simulation sees goes through here, for live input and
+// replays alike, so both produce the same frame
+void ApplyInputFrame(InputFrame* input, unsigned int down, short mouseX, short mouseY, float wheel, float deltaTime) {
+    input->pressed = down & ~input->down;
+    input->down = down;
+    input->mouse = (Vector2){ mouseX, mouseY };
+    input->wheel = wheel;
+    input->deltaTime = deltaTime;
+    input->time += deltaTime;
+    input->frame++;
+}
+
+void PollInput(World* world) {
+    unsigned int down = 0;
+    
+    for (int action = 0; action < INPUT_ACTION_COUNT; action++) {
+        for (int k = 0; k < 3 && actionKeys[action][k] != 0; k++) {
+            if (IsKeyDown(actionKeys[action][k])) {
+                down |= 1u << action;
+            }
+        }
+    }
+    if (IsMouseButtonDown(MOUSE_LEFT_BUTTON)) down |= 1u << INPUT_PRIMARY;
+    if (IsMouseButtonDown(MOUSE_RIGHT_BUTTON)) down |= 1u << INPUT_SECONDARY;
+    
+    // Whole pixels only, so a recording reproduces exactly what was simulated
+    Vector2 mouse = GetMousePosition();
+    ApplyInputFrame(&world->input, down, (short)mouse.x, (short)mouse.y, GetMouseWheelMove(), GetFrameTime());
+}
+
+static bool WriteReplayHeader(InputRecording* recording) {
+    unsigned int header[4] = { REPLAY_MAGIC, REPLAY_VERSION, recording->seed, recording->frameCount };
+    fseek(recording->file, 0, SEEK_SET);
+    return fwrite(header, sizeof(header), 1, recording->file) == 1 &&
+           fwrite(&recording->finalHash, sizeof(recording->finalHash), 1, recording->file) == 1;
+}
+
+bool BeginInputRecording(InputRecording* recording, const char* path, unsigned int seed) {
+    memset(recording, 0, sizeof(*recording));
+    recording->file = fopen(path, "wb");
+    if (recording->file == NULL) return false;
+    
+    recording->seed = seed;
+    return WriteReplayHeader(recording);
+}
+
+void RecordInputFrame(InputRecording* recording, const InputFrame* input) {
+    if (recording->file == NULL || recording->replaying) return;
+    
+    short mouse[2] = { (short)input->mouse.x, (short)input->mouse.y };
+    fwrite(&input->deltaTime, sizeof(float), 1, recording->file);
+    fwrite(&input->down, sizeof(unsigned int), 1, recording->file);
+    fwrite(mouse, sizeof(mouse), 1, recording->file);
+    fwrite(&input->wheel, sizeof(float), 1, recording->file);
+    recording->frameCount++;
+}
+
+void EndInputRecording(InputRecording* recording, World* world) {
+    if (recording->file == NULL) return;
+    
+    if (!recording->replaying) {
+        recording->finalHash = HashWorldState(world);
+        WriteReplayHeader(recording);
+    }
+    fclose(recording->file);
+    recording->file = NULL;
+}
+
+bool BeginInputReplay(InputRecording* recording, const char* path) {
+    memset(recording, 0, sizeof(*recording));
+    recording->file = fopen(path, "rb");
+    if (recording->file == NULL) return false;
+    
+    unsigned int header[4];
+    if (fread(header, sizeof(header), 1, recording->file) != 1 ||
+        fread(&recording->finalHash, sizeof(recording->finalHash), 1, recording->file) != 1 ||
+        header[0] != REPLAY_MAGIC || header[1] != REPLAY_VERSION) {
+        fclose(recording->file);
+        recording->file = NULL;
+        return false;
+    }
+    
+    recording->seed = header[2];
+    recording->frameCount = header[3];
+    recording->replaying = true;
+    return true;
+}
+
+// Feeds the next recorded frame into the world. Returns false once the
+// recording is exhausted.
+bool ReplayInputFrame(InputRecording* recording, World* world) {
+    if (recording->file == NULL || recording->framesRead >= recording->frameCount) return false;
+    
+    float deltaTime;
+    unsigned int down;
+    short mouse[2];
+    float wheel;
+    if (fread(&deltaTime, sizeof(float), 1, recording->file) != 1 ||
+        fread(&down, sizeof(unsigned int), 1, recording->file) != 1 ||
+        fread(mouse, sizeof(mouse), 1, recording->file) != 1 ||
+        fread(&wheel, sizeof(float), 1, recording->file) != 1) {
+        return false;
+    }
+    
+    ApplyInputFrame(&world->input, down, mouse[0], mouse[1], wheel, deltaTime);
+    recording->framesRead++;
+    return true;
+}
+
+static uint64_t HashBytes(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+static uint64_t HashInt(uint64_t hash, int value) {
+    return HashBytes(hash, &value, sizeof(value));
+}
+
+static uint64_t HashFloat(uint64_t hash, float value) {
+    return HashBytes(hash, &value, sizeof(value));
+}
+
+static uint64_t HashContainer(uint64_t hash, const InventoryContainer* container) {
+    hash = HashInt(hash, container->slotCount);
+    for (int i = 0; i < container->slotCount; i++) {
+        const InventorySlot* slot = &container->slots[i];
+        hash = HashInt(hash, slot->type);
+        hash = HashInt(hash, slot->tool);
+        hash = HashInt(hash, slot->count);
+        hash = HashInt(hash, slot->durability);
+    }
+    return hash;
+}
+
+// FNV-1a over the simulated state: terrain, player, animals and the
+// world's random numbers. Fields are hashed one by one, never as raw
+// structs, so padding and UI-only state (the cursor, drags, open menus)
+// cannot make two equal runs disagree.
+uint64_t HashWorldState(World* world) {
+    uint64_t hash = 14695981039346656037ull;
+    hash = HashBytes(hash, world->blocks, sizeof(world->blocks));
+    
+    const Player* player = &world->player;
+    hash = HashFloat(hash, player->x);
+    hash = HashFloat(hash, player->y);
+    hash = HashFloat(hash, player->velX);
+    hash = HashFloat(hash, player->velY);
+    hash = HashInt(hash, player->onGround);
+    hash = HashInt(hash, player->inWater);
+    hash = HashInt(hash, player->health);
+    hash = HashContainer(hash, &player->hotbar);
+    hash = HashContainer(hash, &player->backpack);
+    hash = HashInt(hash, player->selectedSlot);
+    hash = HashFloat(hash, player->lastJumpTime);
+    hash = HashInt(hash, player->isBreaking);
+    hash = HashFloat(hash, player->breakStartTime);
+    hash = HashFloat(hash, player->breakProgress);
+    hash = HashInt(hash, player->breakingBlockX);
+    hash = HashInt(hash, player->breakingBlockY);
+    
+    // Free pool slots hold the free list, so only live animals count
+    for (int i = 0; i < MAX_ANIMALS; i++) {
+        const Animal* animal = &world->animals[i];
+        if (!animal->alive) continue;
+        hash = HashInt(hash, i);
+        hash = HashInt(hash, animal->type);
+        hash = HashFloat(hash, animal->x);
+        hash = HashFloat(hash, animal->y);
+        hash = HashFloat(hash, animal->velX);
+        hash = HashFloat(hash, animal->velY);
+        hash = HashInt(hash, animal->state);
+        hash = HashFloat(hash, animal->stateTimer);
+        hash = HashFloat(hash, animal->direction);
+        hash = HashInt(hash, animal->onGround);
+        hash = HashInt(hash, animal->inWater);
+    }
+    hash = HashInt(hash, world->animalCount);
+    hash = HashInt(hash, (int)world->rngState);
+    return hash;
+}
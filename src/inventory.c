@@ -0,0 +1,185 @@
+#include "game.h"
+#include <string.h>
+
+static void SetBit(uint64_t* words, int index) {
+    words[index >> 6] |= (uint64_t)1 << (index & 63);
+}
+
+static void ClearBit(uint64_t* words, int index) {
+    words[index >> 6] &= ~((uint64_t)1 << (index & 63));
+}
+
+// Lowest set index, so items keep landing in the first matching slot
+static int FindFirstBit(const uint64_t* words) {
+    for (int w = 0; w < CONTAINER_WORDS; w++) {
+        if (words[w] != 0) return w * 64 + CountTrailingZeros64(words[w]);
+    }
+    return -1;
+}
+
+static bool IsItemStack(const InventorySlot* slot) {
+    return slot->tool == TOOL_NONE && slot->count > 0;
+}
+
+// Takes slot 'index' out of the index before it changes...
+static void UnindexSlot(InventoryContainer* container, int index) {
+    InventorySlot* slot = &container->slots[index];
+    if (slot->tool != TOOL_NONE) return;
+    
+    if (slot->count == 0) {
+        ClearBit(container->freeSlots, index);
+        container->freeCount--;
+        return;
+    }
+    ClearBit(container->stacks[slot->type], index);
+    ClearBit(container->partialStacks[slot->type], index);
+    container->itemCounts[slot->type] -= slot->count;
+}
+
+// ...and files it under its new contents afterwards
+static void IndexSlot(InventoryContainer* container, int index) {
+    InventorySlot* slot = &container->slots[index];
+    if (slot->tool != TOOL_NONE) return;
+    
+    if (slot->count == 0) {
+        *slot = (InventorySlot){ BLOCK_AIR, TOOL_NONE, 0, 0 };
+        SetBit(container->freeSlots, index);
+        container->freeCount++;
+        return;
+    }
+    SetBit(container->stacks[slot->type], index);
+    if (slot->count < MAX_STACK_SIZE) {
+        SetBit(container->partialStacks[slot->type], index);
+    }
+    container->itemCounts[slot->type] += slot->count;
+}
+
+static void AdjustStack(InventoryContainer* container, int index, int delta) {
+    UnindexSlot(container, index);
+    container->slots[index].count += delta;
+    IndexSlot(container, index);
+}
+
+void InitContainer(InventoryContainer* container, int slotCount) {
+    memset(container, 0, sizeof(*container));
+    container->slotCount = slotCount;
+    for (int i = 0; i < slotCount; i++) {
+        IndexSlot(container, i);
+    }
+}
+
+void SetContainerSlot(InventoryContainer* container, int index, InventorySlot slot) {
+    UnindexSlot(container, index);
+    container->slots[index] = slot;
+    IndexSlot(container, index);
+}
+
+void SwapContainerSlots(InventoryContainer* a, int indexA, InventoryContainer* b, int indexB) {
+    if (a == b && indexA == indexB) return;
+    
+    UnindexSlot(a, indexA);
+    UnindexSlot(b, indexB);
+    InventorySlot temp = a->slots[indexA];
+    a->slots[indexA] = b->slots[indexB];
+    b->slots[indexB] = temp;
+    IndexSlot(a, indexA);
+    IndexSlot(b, indexB);
+}
+
+int FindFreeContainerSlot(InventoryContainer* container) {
+    return FindFirstBit(container->freeSlots);
+}
+
+// Tops up partial stacks first, then opens new ones in free slots.
+// Returns how many items did not fit.
+int AddToContainer(InventoryContainer* container, BlockType type, int count) {
+    while (count > 0) {
+        int index = FindFirstBit(container->partialStacks[type]);
+        if (index < 0) break;
+        
+        int room = MAX_STACK_SIZE - container->slots[index].count;
+        int added = count < room ? count : room;
+        AdjustStack(container, index, added);
+        count -= added;
+    }
+    
+    while (count > 0) {
+        int index = FindFirstBit(container->freeSlots);
+        if (index < 0) break;
+        
+        int added = count < MAX_STACK_SIZE ? count : MAX_STACK_SIZE;
+        SetContainerSlot(container, index, (InventorySlot){ type, TOOL_NONE, added, 0 });
+        count -= added;
+    }
+    return count;
+}
+
+// Returns how many items were actually removed
+int RemoveFromContainer(InventoryContainer* container, BlockType type, int count) {
+    int removed = 0;
+    while (removed < count) {
+        int index = FindFirstBit(container->stacks[type]);
+        if (index < 0) break;
+        
+        int taken = count - removed;
+        if (taken > container->slots[index].count) taken = container->slots[index].count;
+        AdjustStack(container, index, -taken);
+        removed += taken;
+    }
+    return removed;
+}
+
+// How many slots RemoveFromContainer would free taking 'count' of 'type',
+// walking the stacks in the same lowest-index-first order
+int CountSlotsEmptiedByRemoving(const InventoryContainer* container, BlockType type, int count) {
+    int emptied = 0;
+    for (int w = 0; w < CONTAINER_WORDS; w++) {
+        uint64_t bits = container->stacks[type][w];
+        while (bits != 0) {
+            int index = w * 64 + CountTrailingZeros64(bits);
+            bits &= bits - 1;
+            
+            if (count < container->slots[index].count) return emptied;
+            count -= container->slots[index].count;
+            emptied++;
+        }
+    }
+    return emptied;
+}
+
+int TakeFromContainerSlot(InventoryContainer* container, int index, int count) {
+    InventorySlot* slot = &container->slots[index];
+    if (!IsItemStack(slot)) return 0;
+    
+    if (count > slot->count) count = slot->count;
+    AdjustStack(container, index, -count);
+    return count;
+}
+
+// Moves up to 'count' items of one type, as many as 'to' has room for.
+// Returns how many moved.
+int MoveBetweenContainers(InventoryContainer* from, InventoryContainer* to, BlockType type, int count) {
+    if (count > from->itemCounts[type]) count = from->itemCounts[type];
+    
+    int leftover = AddToContainer(to, type, count);
+    return RemoveFromContainer(from, type, count - leftover);
+}
+
+// Moves the whole of one slot into another container: items merge into its
+// stacks, a tool takes its first free slot. Returns false if nothing moved.
+bool MoveSlotToContainer(InventoryContainer* from, int index, InventoryContainer* to) {
+    InventorySlot slot = from->slots[index];
+    
+    if (slot.tool != TOOL_NONE) {
+        int freeIndex = FindFreeContainerSlot(to);
+        if (freeIndex < 0) return false;
+        SetContainerSlot(to, freeIndex, slot);
+        SetContainerSlot(from, index, (InventorySlot){ BLOCK_AIR, TOOL_NONE, 0, 0 });
+        return true;
+    }
+    if (slot.count == 0) return false;
+    
+    int leftover = AddToContainer(to, slot.type, slot.count);
+    AdjustStack(from, index, leftover - slot.count);
+    return leftover < slot.count;
+}
@@ -1,52 +1,257 @@
 #include "game.h"
+#include "platform.h"
 #include "resource_dir.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
 
-void InitGame(World* world) {
-    InitPlayer(&world->player);
+// Large enough that it should not live on the stack
+static NetClient client;
+
+int main(int argc, char** argv) {
+    const char* recordPath = NULL;
+    const char* replayPath = NULL;
+    const char* connectAddress = NULL;
+    bool serverMode = false;
+    unsigned short serverPort = NET_DEFAULT_PORT;
+    double serverDuration = 0;
+    double simulatedLatency = 0;
+    double simulatedJitter = 0;
+    float simulatedLoss = 0;
+    bool predict = true;
+    const char* savePath = NULL;
+    double autosaveInterval = 60.0;
+    bool prefetch = true;
+    const char* terrainCache = "terrain";
+    unsigned int seed = (unsigned int)time(NULL);
     
-    world->camera.target = (Vector2){ world->player.x, world->player.y };
-    world->camera.offset = (Vector2){ SCREEN_WIDTH / 2.0f, SCREEN_HEIGHT / 2.0f };
-    world->camera.rotation = 0.0f;
-    world->camera.zoom = 1.0f;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--server") == 0) {
+            serverMode = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                serverPort = (unsigned short)strtoul(argv[++i], NULL, 10);
+            }
+        } else if (strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+            serverDuration = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--connect") == 0 && i + 1 < argc) {
+            connectAddress = argv[++i];
+        } else if (strcmp(argv[i], "--latency") == 0 && i + 1 < argc) {
+            simulatedLatency = strtod(argv[++i], NULL) / 1000.0;
+        } else if (strcmp(argv[i], "--jitter") == 0 && i + 1 < argc) {
+            simulatedJitter = strtod(argv[++i], NULL) / 1000.0;
+        } else if (strcmp(argv[i], "--loss") == 0 && i + 1 < argc) {
+            simulatedLoss = strtof(argv[++i], NULL) / 100.0f;
+        } else if (strcmp(argv[i], "--no-prediction") == 0) {
+            predict = false;
+        } else if (strcmp(argv[i], "--save") == 0 && i + 1 < argc) {
+            savePath = argv[++i];
+        } else if (strcmp(argv[i], "--autosave") == 0 && i + 1 < argc) {
+            autosaveInterval = strtod(argv[++i], NULL);
+        } else if (strcmp(argv[i], "--no-prefetch") == 0) {
+            prefetch = false;
+        } else if (strcmp(argv[i], "--terrain-cache") == 0 && i + 1 < argc) {
+            terrainCache = argv[++i];
+        } else if (strcmp(argv[i], "--no-terrain-cache") == 0) {
+            terrainCache = NULL;
+        }
+    }
+    
+    // Terrain made ahead of time by the pregen tool, used for any seed it has
+    SetTerrainCacheDirectory(terrainCache);
+    
+    if (serverMode) {
+        return RunServer(serverPort, seed, serverDuration);
+    }
+    
+    InputRecording recording = { 0 };
+    if (replayPath != NULL) {
+        if (!BeginInputReplay(&recording, replayPath)) {
+            printf("Could not open replay %s\n", replayPath);
+            return 1;
+        }
+        seed = recording.seed;
+    } else if (recordPath != NULL) {
+        if (!BeginInputRecording(&recording, recordPath, seed)) {
+            printf("Could not create recording %s\n", recordPath);
+            return 1;
+        }
+    }
     
-    GenerateWorld(world);
-    InitAnimals(world);
-}
-
-int main() {
     SetConfigFlags(FLAG_VSYNC_HINT | FLAG_WINDOW_HIGHDPI);
     InitWindow(SCREEN_WIDTH, SCREEN_HEIGHT, "2D Voxel World - Enhanced");
-    SetTargetFPS(60);
+    // Replays run as fast as possible so they can serve as benchmarks
+    SetTargetFPS(recording.replaying ? 0 : 60);
+    
+    // A loaded save would not match what a recording starts from
+    bool saving = savePath != NULL && connectAddress == NULL && recordPath == NULL && replayPath == NULL;
+    if (saving && !SaveInit(savePath)) {
+        printf("Could not open save directory %s\n", savePath);
+        saving = false;
+    }
+    
+    World* world = CreateWorld();
+    if (world == NULL) {
+        printf("Could not allocate the world\n");
+        SaveShutdown();
+        CloseWindow();
+        return 1;
+    }
     
-    World world;
-    InitGame(&world);
+    if (connectAddress != NULL) {
+        // host[:port]
+        char host[256];
+        unsigned short port = NET_DEFAULT_PORT;
+        snprintf(host, sizeof(host), "%s", connectAddress);
+        char* colon = strchr(host, ':');
+        if (colon != NULL) {
+            *colon = '\0';
+            port = (unsigned short)strtoul(colon + 1, NULL, 10);
+        }
+        
+        printf("Connecting to %s:%u\n", host, port);
+        bool opened = ClientConnect(&client, world, host, port);
+        client.predict = predict;
+        ClientSimulateLink(&client, simulatedLatency, simulatedJitter, simulatedLoss);
+        if (!opened || !ClientWaitForAccept(&client, NET_TIMEOUT)) {
+            printf("Could not connect to %s:%u\n", host, port);
+            ClientDisconnect(&client);
+            DestroyWorld(world);
+            CloseWindow();
+            return 1;
+        }
+    } else if (saving && LoadWorld(world, savePath)) {
+        printf("Loaded %s\n", savePath);
+        if (!StartRegionStreaming(savePath, prefetch)) printf("Could not start region streaming\n");
+    } else {
+        InitGame(world, seed);
+    }
+    if (connectAddress == NULL) StartGranularWorkers(PlatformGetCpuCount() - 1);
+    double lastSaveTime = GetTime();
+    
+    double replayStart = GetTime();
     
     while (!WindowShouldClose()) {
-        float deltaTime = GetFrameTime();
+        PROFILE_FRAME_BEGIN();
+        ArenaReset(&world->frameMemory);
+        
+        if (recording.replaying) {
+            if (!ReplayInputFrame(&recording, world)) break;
+        } else {
+            PollInput(world);
+            RecordInputFrame(&recording, &world->input);
+        }
+        float deltaTime = world->input.deltaTime;
+        Player* player = &world->player;
         
-        HandleInventoryInput(&world);
-        HandleExtendedInventory(&world);
-        HandleCrafting(&world);
+        if (world->role == NET_ROLE_CLIENT) {
+            // The server simulates everything from our input; we predict our
+            // own movement and draw what it reports for the rest
+            PROFILE_SCOPE("Network") {
+                ClientSendInput(&client, &world->input);
+                ClientReceive(&client);
+            }
+            if (client.disconnected) {
+                printf("Lost connection to the server\n");
+                break;
+            }
+            PROFILE_SCOPE("Targeting") UpdateBlockTarget(world, player, &world->input);
+        } else {
+            UpdateRegionStreaming(world, player);
+            PROFILE_SCOPE("Input") {
+                HandleInventoryInput(player, &world->input);
+                HandleExtendedInventory(player, &world->input);
+                HandleCrafting(player, &world->input);
+            }
+            
+            if (!player->inventoryOpen && !player->craftingOpen) {
+                PROFILE_SCOPE("Player") UpdatePlayer(world, player, &world->input, deltaTime);
+                PROFILE_SCOPE("Animals") UpdateAnimals(world, deltaTime);
+                PROFILE_SCOPE("Block Updates") UpdateBlockTicks(world, deltaTime);
+                PROFILE_SCOPE("Falling Sand") UpdateGranular(world, deltaTime);
+            }
+            
+            // After everything that moves the player or changes blocks, so
+            // interaction and the highlight drawn below agree on one target
+            PROFILE_SCOPE("Targeting") UpdateBlockTarget(world, player, &world->input);
+            if (!player->inventoryOpen && !player->craftingOpen) {
+                PROFILE_SCOPE("Block Interaction") HandleBlockInteraction(world, player, &world->input, deltaTime);
+            }
+        }
+        world->camera = GetPlayerCamera(player);
+        PROFILE_SCOPE("Particles") UpdateParticles(world, deltaTime);
         
-        if (!world.player.inventoryOpen && !world.player.craftingOpen) {
-            UpdatePlayer(&world, deltaTime);
-            UpdateAnimals(&world, deltaTime);
-            HandleBlockInteraction(&world, deltaTime);
+        if (saving) {
+            // The copy is quick; serializing and writing happen on the save thread
+            PROFILE_SCOPE("Save") {
+                SaveResult result;
+                if (PollSaveResult(world, &result) && !result.ok) printf("Autosave to %s failed\n", savePath);
+                if (GetTime() - lastSaveTime >= autosaveInterval && RequestSave(world)) lastSaveTime = GetTime();
+            }
         }
         
         BeginDrawing();
         ClearBackground(SKYBLUE);
         
-        BeginMode2D(world.camera);
-        DrawWorld(&world);
-        DrawAnimals(&world);
-        DrawPlayer(&world);
-        EndMode2D();
+        PROFILE_SCOPE("World Draw") {
+            BeginMode2D(world->camera);
+            DrawWorld(world);
+            DrawAnimals(world);
+            DrawPlayer(world);
+            DrawParticles(world);
+            EndMode2D();
+        }
+        
+        PROFILE_SCOPE("UI Draw") DrawUI(world);
+        PROFILE_OVERLAY();
         
-        DrawUI(&world);
+        PROFILE_SCOPE("Present") EndDrawing();
+        PROFILE_FRAME_END();
+    }
+    
+    if (recording.replaying) {
+        double elapsed = GetTime() - replayStart;
+        uint64_t hash = HashWorldState(world);
+        printf("Replayed %u/%u frames in %.3f s (%.3f ms/frame)\n", recording.framesRead, recording.frameCount,
+               elapsed, recording.framesRead > 0 ? elapsed * 1000.0 / recording.framesRead : 0.0);
+        printf("Final state %016llx, recorded %016llx: %s\n", (unsigned long long)hash,
+               (unsigned long long)recording.finalHash,
+               (recording.framesRead == recording.frameCount && hash == recording.finalHash) ? "identical" : "DIVERGED");
+    }
+    EndInputRecording(&recording, world);
+    if (saving) {
+        SaveResult result;
+        WaitForSave();
+        PollSaveResult(world, &result);
+        RequestSave(world);
+        WaitForSave();
+        if (PollSaveResult(world, &result)) {
+            printf("Saved %d regions, %u bytes, to %s%s\n", result.regionsWritten, (unsigned int)result.bytesWritten,
+                   savePath, result.ok ? "" : " (failed)");
+        }
+        SaveShutdown();
         
-        EndDrawing();
+        RegionStreamStats stream;
+        GetRegionStreamStats(&stream);
+        if (stream.backend != NULL) {
+            printf("Region streaming (%s): %u read, %u loaded, %u prefetch hits, %u misses, %.2f ms stalled\n",
+                   stream.backend, stream.regionsQueued, stream.regionsLoaded, stream.hits, stream.misses,
+                   stream.stallSeconds * 1000.0);
+        }
+        StopRegionStreaming();
+    }
+    if (connectAddress != NULL) {
+        printf("Prediction corrections: %u, largest %.2f px, round trip %.1f ms\n", client.corrections,
+               client.maxCorrection, client.channel.roundTripTime * 1000.0);
+        ClientDisconnect(&client);
     }
+    StopGranularWorkers();
+    DestroyWorld(world);
     
     CloseWindow();
     return 0;
@@ -0,0 +1,117 @@
+#include "game.h"
+#include <stdlib.h>
+#include <string.h>
+
+bool ArenaInit(MemoryArena* arena, size_t capacity) {
+    memset(arena, 0, sizeof(*arena));
+    arena->base = (unsigned char*)calloc(1, capacity);
+    if (arena->base == NULL) return false;
+    
+    arena->capacity = capacity;
+    return true;
+}
+
+// Carves a child arena out of 'parent'. The child is released with its
+// parent and must not be passed to ArenaFree.
+bool ArenaInitFrom(MemoryArena* arena, MemoryArena* parent, size_t capacity, MemoryTag tag) {
+    memset(arena, 0, sizeof(*arena));
+    arena->base = (unsigned char*)ArenaAlloc(parent, capacity, tag);
+    if (arena->base == NULL) return false;
+    
+    arena->capacity = capacity;
+    return true;
+}
+
+void ArenaFree(MemoryArena* arena) {
+    free(arena->base);
+    memset(arena, 0, sizeof(*arena));
+}
+
+void* ArenaAlloc(MemoryArena* arena, size_t size, MemoryTag tag) {
+    size = MEMORY_ALIGNED_SIZE(size);
+    if (size > arena->capacity - arena->used) {
+        TraceLog(LOG_ERROR, "MEMORY: %s arena out of space (%u of %u bytes used, %u requested)", GetMemoryTagName(tag),
+                 (unsigned int)arena->used, (unsigned int)arena->capacity, (unsigned int)size);
+        return NULL;
+    }
+    
+    void* memory = arena->base + arena->used;
+    arena->used += size;
+    arena->tagBytes[tag] += size;
+    if (arena->used > arena->peak) arena->peak = arena->used;
+    return memory;
+}
+
+size_t ArenaMark(MemoryArena* arena) {
+    return arena->used;
+}
+
+void ArenaRewind(MemoryArena* arena, size_t mark) {
+    arena->used = mark;
+}
+
+// Drops everything at once. The per-tag counters restart too, so for the
+// frame arena they report what each subsystem asked for in one frame.
+void ArenaReset(MemoryArena* arena) {
+    arena->used = 0;
+    memset(arena->tagBytes, 0, sizeof(arena->tagBytes));
+}
+
+bool PoolInit(MemoryPool* pool, MemoryArena* arena, size_t itemSize, int capacity, MemoryTag tag) {
+    memset(pool, 0, sizeof(*pool));
+    pool->items = (unsigned char*)ArenaAlloc(arena, itemSize * capacity, tag);
+    pool->next = (int*)ArenaAlloc(arena, sizeof(int) * capacity, tag);
+    if (pool->items == NULL || pool->next == NULL) return false;
+    
+    pool->itemSize = itemSize;
+    pool->capacity = capacity;
+    PoolReset(pool);
+    return true;
+}
+
+// What PoolInit takes from its arena
+size_t PoolArenaSize(size_t itemSize, int capacity) {
+    return MEMORY_ALIGNED_SIZE(itemSize * capacity) + MEMORY_ALIGNED_SIZE(sizeof(int) * capacity);
+}
+
+// Marks every slot free again, handing them out lowest index first
+void PoolReset(MemoryPool* pool) {
+    for (int i = 0; i < pool->capacity; i++) {
+        pool->next[i] = i + 1 < pool->capacity ? i + 1 : -1;
+    }
+    pool->freeHead = pool->capacity > 0 ? 0 : -1;
+    pool->used = 0;
+}
+
+void* PoolAlloc(MemoryPool* pool) {
+    if (pool->freeHead < 0) return NULL;
+    
+    int index = pool->freeHead;
+    pool->freeHead = pool->next[index];
+    pool->next[index] = -1;
+    pool->used++;
+    return pool->items + (size_t)index * pool->itemSize;
+}
+
+void PoolFree(MemoryPool* pool, void* item) {
+    int index = (int)(((unsigned char*)item - pool->items) / pool->itemSize);
+    pool->next[index] = pool->freeHead;
+    pool->freeHead = index;
+    pool->used--;
+}
+
+const char* GetMemoryTagName(MemoryTag tag) {
+    switch (tag) {
+        case MEMORY_WORLD: return "World";
+        case MEMORY_ENTITIES: return "Entities";
+        case MEMORY_PATHFINDING: return "Pathfinding";
+        case MEMORY_SPAWNING: return "Spawning";
+        case MEMORY_FRAME: return "Frame";
+        case MEMORY_GENERATION: return "Generation";
+        case MEMORY_PHYSICS: return "Physics";
+        case MEMORY_RENDER: return "Render";
+        case MEMORY_SIMULATION: return "Simulation";
+        case MEMORY_EDITING: return "Editing";
+        default: return "Unknown";
+    }
+}
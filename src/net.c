@@ -0,0 +1,338 @@
+#include "game.h"
+#include "platform.h"
+#include <string.h>
+
+#define NET_MAGIC 0x5856u
+#define NET_MAX_DELTA_TIME 0.05f
+
+double NetGetTime(void) {
+    return PlatformGetTicks() / 1000000000.0;
+}
+
+static void WriteBytes(NetWriter* writer, const unsigned char* bytes, int count) {
+    if (writer->size + count > NET_MAX_PACKET) {
+        writer->overflow = true;
+        return;
+    }
+    memcpy(writer->data + writer->size, bytes, count);
+    writer->size += count;
+}
+
+void NetWriteU8(NetWriter* writer, unsigned int value) {
+    unsigned char bytes[1] = { (unsigned char)value };
+    WriteBytes(writer, bytes, 1);
+}
+
+void NetWriteU16(NetWriter* writer, unsigned int value) {
+    unsigned char bytes[2] = { (unsigned char)value, (unsigned char)(value >> 8) };
+    WriteBytes(writer, bytes, 2);
+}
+
+void NetWriteU32(NetWriter* writer, unsigned int value) {
+    unsigned char bytes[4] = { (unsigned char)value, (unsigned char)(value >> 8),
+                               (unsigned char)(value >> 16), (unsigned char)(value >> 24) };
+    WriteBytes(writer, bytes, 4);
+}
+
+void NetWriteFloat(NetWriter* writer, float value) {
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    NetWriteU32(writer, bits);
+}
+
+// Seven bits per byte, high bit set while more follow
+void NetWriteVarUint(NetWriter* writer, unsigned int value) {
+    while (value >= 0x80) {
+        NetWriteU8(writer, (value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    NetWriteU8(writer, value);
+}
+
+void NetReaderInit(NetReader* reader, const void* data, int size) {
+    reader->data = (const unsigned char*)data;
+    reader->size = size;
+    reader->position = 0;
+    reader->error = false;
+}
+
+static const unsigned char* ReadBytes(NetReader* reader, int count) {
+    static const unsigned char zeros[4] = { 0 };
+    if (reader->error || reader->position + count > reader->size) {
+        reader->error = true;
+        return zeros;
+    }
+    const unsigned char* bytes = reader->data + reader->position;
+    reader->position += count;
+    return bytes;
+}
+
+unsigned int NetReadU8(NetReader* reader) {
+    return ReadBytes(reader, 1)[0];
+}
+
+unsigned int NetReadU16(NetReader* reader) {
+    const unsigned char* bytes = ReadBytes(reader, 2);
+    return bytes[0] | (unsigned int)bytes[1] << 8;
+}
+
+unsigned int NetReadU32(NetReader* reader) {
+    const unsigned char* bytes = ReadBytes(reader, 4);
+    return bytes[0] | (unsigned int)bytes[1] << 8 | (unsigned int)bytes[2] << 16 | (unsigned int)bytes[3] << 24;
+}
+
+float NetReadFloat(NetReader* reader) {
+    unsigned int bits = NetReadU32(reader);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+unsigned int NetReadVarUint(NetReader* reader) {
+    unsigned int value = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        unsigned int byte = NetReadU8(reader);
+        value |= (byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) return value;
+    }
+    reader->error = true;
+    return 0;
+}
+
+// True when 'a' is newer than 'b', allowing for wraparound
+static bool SequenceGreater(unsigned short a, unsigned short b) {
+    unsigned short difference = (unsigned short)(a - b);
+    return difference != 0 && difference < 32768;
+}
+
+void NetInitChannel(NetChannel* channel) {
+    memset(channel, 0, sizeof(*channel));
+    channel->localSequence = 1;
+    // Unused slots count as acknowledged so a stray ack cannot match them
+    for (int i = 0; i < NET_SEQUENCE_BUFFER; i++) {
+        channel->sentAcked[i] = true;
+    }
+    channel->lastReceiveTime = NetGetTime();
+}
+
+// Header: magic, type, sequence, newest received sequence and a bitfield
+// of the 32 before it. Returns the sequence the packet goes out under.
+unsigned short NetBeginPacket(NetWriter* writer, NetChannel* channel, NetMessageType type) {
+    unsigned short sequence = channel->localSequence++;
+    int index = sequence % NET_SEQUENCE_BUFFER;
+    channel->sentSequences[index] = sequence;
+    channel->sentTimes[index] = NetGetTime();
+    channel->sentAcked[index] = false;
+    
+    writer->size = 0;
+    writer->overflow = false;
+    NetWriteU16(writer, NET_MAGIC);
+    NetWriteU8(writer, type);
+    NetWriteU16(writer, sequence);
+    NetWriteU16(writer, channel->remoteSequence);
+    NetWriteU32(writer, channel->receivedAny ? channel->receivedBits : 0);
+    return sequence;
+}
+
+// Message type of a packet from an unknown sender, without touching any
+// channel. Zero if it is not one of ours.
+NetMessageType NetPeekType(const void* data, int size) {
+    NetReader reader;
+    NetReaderInit(&reader, data, size);
+    unsigned int magic = NetReadU16(&reader);
+    unsigned int type = NetReadU8(&reader);
+    if (reader.error || magic != NET_MAGIC) return (NetMessageType)0;
+    return (NetMessageType)type;
+}
+
+static void AckSequence(NetChannel* channel, unsigned short sequence, double now) {
+    int index = sequence % NET_SEQUENCE_BUFFER;
+    if (channel->sentSequences[index] != sequence || channel->sentAcked[index]) return;
+    
+    channel->sentAcked[index] = true;
+    double sample = now - channel->sentTimes[index];
+    channel->roundTripTime = channel->roundTripTime == 0 ? sample : channel->roundTripTime * 0.9 + sample * 0.1;
+}
+
+// Parses the header and updates both directions of acknowledgement.
+// Returns false for anything that is not one of our packets.
+bool NetReadHeader(NetReader* reader, NetChannel* channel, NetMessageType* type) {
+    unsigned int magic = NetReadU16(reader);
+    *type = (NetMessageType)NetReadU8(reader);
+    unsigned short sequence = (unsigned short)NetReadU16(reader);
+    unsigned short ack = (unsigned short)NetReadU16(reader);
+    unsigned int ackBits = NetReadU32(reader);
+    if (reader->error || magic != NET_MAGIC) return false;
+    
+    if (!channel->receivedAny) {
+        channel->remoteSequence = sequence;
+        channel->receivedBits = 0;
+        channel->receivedAny = true;
+    } else if (SequenceGreater(sequence, channel->remoteSequence)) {
+        unsigned short shift = (unsigned short)(sequence - channel->remoteSequence);
+        if (shift < 32) {
+            channel->receivedBits = (channel->receivedBits << shift) | (1u << (shift - 1));
+        } else {
+            channel->receivedBits = shift == 32 ? 1u << 31 : 0;
+        }
+        channel->remoteSequence = sequence;
+    } else {
+        unsigned short age = (unsigned short)(channel->remoteSequence - sequence);
+        if (age >= 1 && age <= 32) channel->receivedBits |= 1u << (age - 1);
+    }
+    
+    double now = NetGetTime();
+    AckSequence(channel, ack, now);
+    for (int bit = 0; bit < 32; bit++) {
+        if ((ackBits >> bit) & 1) AckSequence(channel, (unsigned short)(ack - 1 - bit), now);
+    }
+    
+    channel->lastReceiveTime = now;
+    channel->packetsReceived++;
+    channel->bytesReceived += reader->size;
+    return true;
+}
+
+bool NetIsAcked(const NetChannel* channel, unsigned short sequence) {
+    int index = sequence % NET_SEQUENCE_BUFFER;
+    return channel->sentSequences[index] == sequence && channel->sentAcked[index];
+}
+
+// 'link' may be NULL to send straight to the socket
+bool NetSendPacket(NetLinkSim* link, intptr_t socket, unsigned int host, unsigned short port, NetChannel* channel,
+                   const NetWriter* writer) {
+    if (writer->overflow) return false;
+    if (!NetLinkSend(link, socket, host, port, writer->data, writer->size)) return false;
+    
+    channel->packetsSent++;
+    channel->bytesSent += writer->size;
+    return true;
+}
+
+// Rounds an input frame to what goes over the wire. The mouse is already
+// whole pixels; the frame time is clamped and kept in microseconds.
+NetInput NetQuantizeInput(const InputFrame* input) {
+    float deltaTime = input->deltaTime;
+    if (deltaTime < 0) deltaTime = 0;
+    if (deltaTime > NET_MAX_DELTA_TIME) deltaTime = NET_MAX_DELTA_TIME;
+    
+    float wheel = input->wheel;
+    if (wheel < -127) wheel = -127;
+    if (wheel > 127) wheel = 127;
+    
+    NetInput result;
+    result.down = input->down;
+    result.mouseX = (short)input->mouse.x;
+    result.mouseY = (short)input->mouse.y;
+    result.wheel = (signed char)wheel;
+    result.deltaMicros = (unsigned short)(deltaTime * 1000000.0f + 0.5f);
+    return result;
+}
+
+void NetWriteInput(NetWriter* writer, const NetInput* input) {
+    NetWriteVarUint(writer, input->down);
+    NetWriteU16(writer, (unsigned short)input->mouseX);
+    NetWriteU16(writer, (unsigned short)input->mouseY);
+    NetWriteU8(writer, (unsigned char)input->wheel);
+    NetWriteU16(writer, input->deltaMicros);
+}
+
+NetInput NetReadInput(NetReader* reader) {
+    NetInput input;
+    input.down = NetReadVarUint(reader);
+    input.mouseX = (short)NetReadU16(reader);
+    input.mouseY = (short)NetReadU16(reader);
+    input.wheel = (signed char)NetReadU8(reader);
+    input.deltaMicros = (unsigned short)NetReadU16(reader);
+    return input;
+}
+
+void NetApplyInput(InputFrame* frame, const NetInput* input) {
+    ApplyInputFrame(frame, input->down, input->mouseX, input->mouseY, input->wheel, input->deltaMicros / 1000000.0f);
+}
+
+void NetInitLinkSim(NetLinkSim* link, double roundTrip, double jitter, float loss, unsigned int seed) {
+    memset(link, 0, sizeof(*link));
+    link->enabled = roundTrip > 0 || jitter > 0 || loss > 0;
+    link->latency = roundTrip / 2;
+    link->jitter = jitter;
+    link->loss = loss;
+    link->random = seed * 0x9E3779B97F4A7C15ull + 1;
+}
+
+// xorshift64, scaled to [0, 1)
+static double LinkRandom(NetLinkSim* link) {
+    link->random ^= link->random << 13;
+    link->random ^= link->random >> 7;
+    link->random ^= link->random << 17;
+    return (link->random >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Queues a packet for later delivery, or drops it. A full queue drops too,
+// as a congested link would.
+static void DelayPacket(NetLinkSim* link, NetDelayedPacket* queue, int* count, uint32_t host, uint16_t port,
+                        const void* data, int size) {
+    if (LinkRandom(link) < link->loss || *count == NET_SIM_QUEUE || size > NET_MAX_PACKET) return;
+    
+    NetDelayedPacket* packet = &queue[(*count)++];
+    packet->deliverTime = NetGetTime() + link->latency + link->jitter * LinkRandom(link);
+    packet->host = host;
+    packet->port = port;
+    packet->size = size;
+    memcpy(packet->data, data, size);
+}
+
+// Index of the earliest packet that is due, or -1
+static int FindDuePacket(const NetDelayedPacket* queue, int count, double now) {
+    int due = -1;
+    for (int i = 0; i < count; i++) {
+        if (queue[i].deliverTime <= now && (due < 0 || queue[i].deliverTime < queue[due].deliverTime)) due = i;
+    }
+    return due;
+}
+
+static void RemovePacket(NetDelayedPacket* queue, int* count, int index) {
+    (*count)--;
+    if (index != *count) queue[index] = queue[*count];
+}
+
+bool NetLinkSend(NetLinkSim* link, intptr_t socket, uint32_t host, uint16_t port, const void* data, int size) {
+    if (link == NULL || !link->enabled) return PlatformSendTo(socket, host, port, data, size);
+    
+    DelayPacket(link, link->outgoing, &link->outgoingCount, host, port, data, size);
+    return true;
+}
+
+// Sends whatever outgoing packets are due, moves everything waiting on the
+// socket into the incoming queue and hands back the earliest packet that
+// has arrived by now. 0 when there is none.
+int NetLinkReceive(NetLinkSim* link, intptr_t socket, uint32_t* host, uint16_t* port, void* buffer, int capacity) {
+    if (link == NULL || !link->enabled) return PlatformReceiveFrom(socket, host, port, buffer, capacity);
+    
+    double now = NetGetTime();
+    int index;
+    while ((index = FindDuePacket(link->outgoing, link->outgoingCount, now)) >= 0) {
+        NetDelayedPacket* packet = &link->outgoing[index];
+        PlatformSendTo(socket, packet->host, packet->port, packet->data, packet->size);
+        RemovePacket(link->outgoing, &link->outgoingCount, index);
+    }
+    
+    unsigned char data[NET_MAX_PACKET];
+    uint32_t fromHost;
+    uint16_t fromPort;
+    int size;
+    while ((size = PlatformReceiveFrom(socket, &fromHost, &fromPort, data, sizeof(data))) > 0) {
+        DelayPacket(link, link->incoming, &link->incomingCount, fromHost, fromPort, data, size);
+    }
+    
+    index = FindDuePacket(link->incoming, link->incomingCount, now);
+    if (index < 0) return 0;
+    
+    NetDelayedPacket* packet = &link->incoming[index];
+    size = packet->size < capacity ? packet->size : capacity;
+    memcpy(buffer, packet->data, size);
+    *host = packet->host;
+    *port = packet->port;
+    RemovePacket(link->incoming, &link->incomingCount, index);
+    return size;
+}
@@ -0,0 +1,252 @@
+#include "game.h"
+#include <string.h>
+
+// Short-lived visual effects: chips off a broken block, water thrown up
+// when a player jumps in, bubbles while they are under, and a puff where
+// an animal dies. None of it feeds back into the simulation, so particles
+// draw from their own random stream and a server never makes any.
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define PARTICLE_SIMD_WIDTH 8
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define PARTICLE_SIMD_WIDTH 4
+#else
+#define PARTICLE_SIMD_WIDTH 1
+#endif
+
+#define PARTICLE_BUBBLE_INTERVAL 0.15f
+
+typedef struct {
+    float speed;
+    float lift;
+    float gravity;
+    float life;
+    unsigned char size;
+    // Comes to rest on solid blocks
+    bool lands;
+} ParticleParams;
+
+static const ParticleParams particleParams[PARTICLE_KIND_COUNT] = {
+    [PARTICLE_DEBRIS] = { 60.0f,  80.0f,  500.0f, 0.8f, 4, true },
+    [PARTICLE_SPLASH] = { 70.0f, 140.0f,  500.0f, 0.5f, 3, true },
+    [PARTICLE_BUBBLE] = { 10.0f,  20.0f,  -60.0f, 1.5f, 3, false },
+    [PARTICLE_PUFF]   = { 40.0f,  20.0f,  -20.0f, 0.5f, 4, false },
+};
+
+static float ParticleRandom(ParticleSystem* system) {
+    unsigned int state = system->rngState;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    system->rngState = state;
+    return (state >> 8) * (1.0f / 16777216.0f);
+}
+
+void ResetParticles(World* world) {
+    ParticleSystem* system = world->particles;
+    system->count = 0;
+    system->rngState = world->seed | 1;
+    system->drawnLastFrame = 0;
+    system->breakCount = 0;
+    memset(system->bubbleTimer, 0, sizeof(system->bubbleTimer));
+    memset(system->wasInWater, 0, sizeof(system->wasInWater));
+}
+
+// Adds up to 'count' particles spread around (x, y). Returns how many fit.
+int EmitParticles(World* world, ParticleKind kind, float x, float y, int count, Color color) {
+    if (world->role == NET_ROLE_SERVER) return 0;
+    
+    ParticleSystem* system = world->particles;
+    const ParticleParams* params = &particleParams[kind];
+    if (count > MAX_PARTICLES - system->count) count = MAX_PARTICLES - system->count;
+    
+    for (int i = 0; i < count; i++) {
+        int slot = system->count++;
+        system->x[slot] = x + (ParticleRandom(system) - 0.5f) * 6.0f;
+        system->y[slot] = y + (ParticleRandom(system) - 0.5f) * 6.0f;
+        system->velX[slot] = (ParticleRandom(system) * 2.0f - 1.0f) * params->speed;
+        system->velY[slot] = (ParticleRandom(system) * 2.0f - 1.0f) * params->speed * 0.5f - params->lift;
+        system->gravity[slot] = params->gravity;
+        system->life[slot] = params->life * (0.6f + ParticleRandom(system) * 0.4f);
+        system->color[slot] = color;
+        system->kind[slot] = (unsigned char)kind;
+    }
+    return count;
+}
+
+// Chips in the block's colour, from the middle of the cell, for a block a
+// player broke. A server notes the break for its next snapshots instead.
+void EmitBlockParticles(World* world, int x, int y, BlockType block) {
+    ParticleSystem* system = world->particles;
+    if (world->role == NET_ROLE_SERVER) {
+        if (system->breakCount < MAX_BLOCK_BREAKS) system->breaks[system->breakCount++] = (BlockBreak){ x, y, block };
+        return;
+    }
+    
+    Color color = GetBlockColor(block);
+    EmitParticles(world, PARTICLE_DEBRIS, (x + 0.5f) * BLOCK_SIZE, (y + 0.5f) * BLOCK_SIZE, 12, color);
+}
+
+// Splashes on the frame a player goes in, and a steady trickle of bubbles
+// while they stay under
+static void EmitPlayerParticles(World* world, int index, const Player* player, float deltaTime) {
+    ParticleSystem* system = world->particles;
+    if (player->inWater && !system->wasInWater[index]) {
+        EmitParticles(world, PARTICLE_SPLASH, player->x + 8, player->y, 24, (Color){ 160, 200, 255, 220 });
+    }
+    system->wasInWater[index] = player->inWater;
+    
+    if (!player->inWater) {
+        system->bubbleTimer[index] = 0;
+        return;
+    }
+    for (system->bubbleTimer[index] += deltaTime; system->bubbleTimer[index] >= PARTICLE_BUBBLE_INTERVAL;
+         system->bubbleTimer[index] -= PARTICLE_BUBBLE_INTERVAL) {
+        EmitParticles(world, PARTICLE_BUBBLE, player->x + 8, player->y + 8, 1, (Color){ 200, 230, 255, 150 });
+    }
+}
+
+// Looks at where each particle is headed. Falling ones that would end up
+// inside a solid block stop; bubbles that have left the water burst.
+static void CollideParticles(World* world, ParticleSystem* system, float deltaTime) {
+    for (int i = 0; i < system->count; i++) {
+        const ParticleParams* params = &particleParams[system->kind[i]];
+        if (params->lands) {
+            float velY = system->velY[i] + system->gravity[i] * deltaTime;
+            int cellX = (int)((system->x[i] + system->velX[i] * deltaTime) / BLOCK_SIZE);
+            int cellY = (int)((system->y[i] + velY * deltaTime) / BLOCK_SIZE);
+            if (cellX >= 0 && cellX < WORLD_WIDTH && cellY >= 0 && cellY < WORLD_HEIGHT &&
+                TestBlockPlane(world, BLOCK_PLANE_SOLID, cellX, cellY)) {
+                system->velX[i] = 0;
+                system->velY[i] = -system->gravity[i] * deltaTime;
+            }
+        } else if (system->kind[i] == PARTICLE_BUBBLE) {
+            int cellX = (int)(system->x[i] / BLOCK_SIZE);
+            int cellY = (int)(system->y[i] / BLOCK_SIZE);
+            if (cellX < 0 || cellX >= WORLD_WIDTH || cellY < 0 || cellY >= WORLD_HEIGHT ||
+                !TestBlockPlane(world, BLOCK_PLANE_LIQUID, cellX, cellY)) {
+                system->life[i] = 0;
+            }
+        }
+    }
+}
+
+//   velY += gravity * dt, x += velX * dt, y += velY * dt, life -= dt
+static void IntegrateParticles(ParticleSystem* system, float deltaTime) {
+    int i = 0;
+
+#if PARTICLE_SIMD_WIDTH == 8
+    __m256 dt = _mm256_set1_ps(deltaTime);
+    for (; i + 8 <= system->count; i += 8) {
+        __m256 velX = _mm256_loadu_ps(&system->velX[i]);
+        __m256 velY = _mm256_add_ps(_mm256_loadu_ps(&system->velY[i]), _mm256_mul_ps(_mm256_loadu_ps(&system->gravity[i]), dt));
+        _mm256_storeu_ps(&system->velY[i], velY);
+        _mm256_storeu_ps(&system->x[i], _mm256_add_ps(_mm256_loadu_ps(&system->x[i]), _mm256_mul_ps(velX, dt)));
+        _mm256_storeu_ps(&system->y[i], _mm256_add_ps(_mm256_loadu_ps(&system->y[i]), _mm256_mul_ps(velY, dt)));
+        _mm256_storeu_ps(&system->life[i], _mm256_sub_ps(_mm256_loadu_ps(&system->life[i]), dt));
+    }
+#elif PARTICLE_SIMD_WIDTH == 4
+    __m128 dt = _mm_set1_ps(deltaTime);
+    for (; i + 4 <= system->count; i += 4) {
+        __m128 velX = _mm_loadu_ps(&system->velX[i]);
+        __m128 velY = _mm_add_ps(_mm_loadu_ps(&system->velY[i]), _mm_mul_ps(_mm_loadu_ps(&system->gravity[i]), dt));
+        _mm_storeu_ps(&system->velY[i], velY);
+        _mm_storeu_ps(&system->x[i], _mm_add_ps(_mm_loadu_ps(&system->x[i]), _mm_mul_ps(velX, dt)));
+        _mm_storeu_ps(&system->y[i], _mm_add_ps(_mm_loadu_ps(&system->y[i]), _mm_mul_ps(velY, dt)));
+        _mm_storeu_ps(&system->life[i], _mm_sub_ps(_mm_loadu_ps(&system->life[i]), dt));
+    }
+#endif
+
+    // Scalar tail, and all of them when no vector unit is available
+    for (; i < system->count; i++) {
+        system->velY[i] += system->gravity[i] * deltaTime;
+        system->x[i] += system->velX[i] * deltaTime;
+        system->y[i] += system->velY[i] * deltaTime;
+        system->life[i] -= deltaTime;
+    }
+}
+
+// Fills each dead particle's slot with the last live one, keeping the
+// live ones packed
+static void RemoveDeadParticles(ParticleSystem* system) {
+    int i = 0;
+    while (i < system->count) {
+        if (system->life[i] > 0) {
+            i++;
+            continue;
+        }
+        
+        int last = --system->count;
+        system->x[i] = system->x[last];
+        system->y[i] = system->y[last];
+        system->velX[i] = system->velX[last];
+        system->velY[i] = system->velY[last];
+        system->gravity[i] = system->gravity[last];
+        system->life[i] = system->life[last];
+        system->color[i] = system->color[last];
+        system->kind[i] = system->kind[last];
+    }
+}
+
+void UpdateParticles(World* world, float deltaTime) {
+    ParticleSystem* system = world->particles;
+    
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (world->playerActive[i]) EmitPlayerParticles(world, i, &world->players[i], deltaTime);
+    }
+    EmitPlayerParticles(world, MAX_PLAYERS, &world->player, deltaTime);
+    
+    CollideParticles(world, system, deltaTime);
+    IntegrateParticles(system, deltaTime);
+    RemoveDeadParticles(system);
+}
+
+// Lists the particles under the camera from index '*next' on, until the
+// list is full, and leaves '*next' where it stopped. Like
+// BuildWorldDrawList it does not touch the renderer.
+int BuildParticleDrawList(World* world, int* next, ParticleDrawItem* items, int capacity) {
+    const ParticleSystem* system = world->particles;
+    float left = world->camera.target.x - SCREEN_WIDTH / 2 - 8;
+    float right = world->camera.target.x + SCREEN_WIDTH / 2 + 8;
+    float top = world->camera.target.y - SCREEN_HEIGHT / 2 - 8;
+    float bottom = world->camera.target.y + SCREEN_HEIGHT / 2 + 8;
+    
+    int count = 0;
+    int i = *next;
+    for (; i < system->count && count < capacity; i++) {
+        float x = system->x[i];
+        float y = system->y[i];
+        if (x < left || x > right || y < top || y > bottom) continue;
+        
+        // Fades out over the last quarter second
+        Color color = system->color[i];
+        if (system->life[i] < 0.25f) color.a = (unsigned char)(color.a * system->life[i] * 4.0f);
+        items[count++] = (ParticleDrawItem){ (short)x, (short)y, particleParams[system->kind[i]].size, color };
+    }
+    *next = i;
+    return count;
+}
+
+// Everything goes out as plain rectangles, which raylib gathers into one
+// batch since nothing in between changes texture or draw mode
+void DrawParticles(World* world) {
+    size_t scratchMark = ArenaMark(&world->frameMemory);
+    ParticleDrawItem* items = (ParticleDrawItem*)ArenaAlloc(&world->frameMemory, sizeof(ParticleDrawItem) * PARTICLE_DRAW_BATCH, MEMORY_RENDER);
+    if (items == NULL) return;
+    
+    int drawn = 0;
+    int next = 0;
+    while (next < world->particles->count) {
+        int count = BuildParticleDrawList(world, &next, items, PARTICLE_DRAW_BATCH);
+        for (int i = 0; i < count; i++) {
+            int size = items[i].size;
+            DrawRectangle(items[i].x - size / 2, items[i].y - size / 2, size, size, items[i].color);
+        }
+        drawn += count;
+    }
+    world->particles->drawnLastFrame = drawn;
+    
+    ArenaRewind(&world->frameMemory, scratchMark);
+}
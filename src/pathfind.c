@@ -0,0 +1,355 @@
+#include "game.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define FLOW_UNREACHED 0xFFFF
+#define FLOW_CELLS (FLOW_FIELD_WIDTH * FLOW_FIELD_HEIGHT)
+
+static bool IsCellPassable(World* world, int x, int y) {
+    return x >= 0 && x < WORLD_WIDTH && y >= 0 && y < WORLD_HEIGHT &&
+           !TestBlockPlane(world, BLOCK_PLANE_SOLID, x, y);
+}
+
+// A walker can rest in a cell that has ground under it, or float in water
+static bool IsCellStandable(World* world, int x, int y) {
+    if (!IsCellPassable(world, x, y)) return false;
+    if (TestBlockPlane(world, BLOCK_PLANE_LIQUID, x, y)) return true;
+    return y + 1 < WORLD_HEIGHT && TestBlockPlane(world, BLOCK_PLANE_SOLID, x, y + 1);
+}
+
+static bool IsInsideField(const FlowField* field, int x, int y) {
+    return x >= field->minX && x <= field->maxX && y >= field->minY && y <= field->maxY;
+}
+
+static int FieldIndex(const FlowField* field, int x, int y) {
+    return (y - field->minY) * FLOW_FIELD_WIDTH + (x - field->minX);
+}
+
+// Cells whose predecessors are still to be visited, taken in order of
+// distance: the seeds, sorted up front with their distance in the high
+// bits, merged with the cells reached as the search goes. The queue holds
+// each cell at most once, since it only takes a cell whose distance
+// drops and the distances it hands out never go down.
+typedef struct {
+    unsigned int* seeds;
+    int seedHead;
+    int seedCount;
+    int* queue;
+    int head;
+    int tail;
+} FlowFrontier;
+
+// Records that the walker at (x, y) reaches cell 'next' with the given
+// move, if (x, y) has not been reached by a route as short already.
+static void VisitPredecessor(World* world, FlowField* field, FlowFrontier* frontier, int x, int y,
+                             unsigned short distance, FlowMove move, int next) {
+    if (!IsInsideField(field, x, y) || !IsCellStandable(world, x, y)) return;
+    
+    int index = FieldIndex(field, x, y);
+    if (field->distance[index] <= distance) return;
+    
+    field->distance[index] = distance;
+    field->move[index] = (unsigned char)move;
+    field->next[index] = (unsigned short)next;
+    frontier->queue[frontier->tail++] = index;
+}
+
+// Breadth-first search backwards over walk, one-block jump and fall moves,
+// from the frontier's cells outward, so every reached cell stores its
+// first step toward the target.
+static void SearchFlowField(World* world, FlowField* field, FlowFrontier* frontier) {
+    for (;;) {
+        int index;
+        if (frontier->seedHead < frontier->seedCount &&
+            (frontier->head == frontier->tail ||
+             (frontier->seeds[frontier->seedHead] >> 16) <= field->distance[frontier->queue[frontier->head]])) {
+            unsigned int seed = frontier->seeds[frontier->seedHead++];
+            index = (int)(seed & 0xFFFF);
+            // Found a shorter route since, and queued with it
+            if (field->distance[index] != seed >> 16) continue;
+        } else if (frontier->head < frontier->tail) {
+            index = frontier->queue[frontier->head++];
+        } else {
+            return;
+        }
+        
+        int cx = field->minX + index % FLOW_FIELD_WIDTH;
+        int cy = field->minY + index / FLOW_FIELD_WIDTH;
+        unsigned short distance = field->distance[index] + 1;
+        
+        for (int side = -1; side <= 1; side += 2) {
+            int nx = cx + side;
+            FlowMove walk = (side < 0) ? FLOW_RIGHT : FLOW_LEFT;
+            FlowMove jump = (side < 0) ? FLOW_JUMP_RIGHT : FLOW_JUMP_LEFT;
+            
+            VisitPredecessor(world, field, frontier, nx, cy, distance, walk, index);
+            
+            if (IsCellPassable(world, nx, cy)) {
+                VisitPredecessor(world, field, frontier, nx, cy + 1, distance, jump, index);
+            }
+            
+            for (int r = cy - 1; r >= field->minY; r--) {
+                if (!IsCellPassable(world, cx, r) || IsCellStandable(world, cx, r)) break;
+                VisitPredecessor(world, field, frontier, nx, r, distance, walk, index);
+            }
+        }
+    }
+}
+
+// The cell a walker standing at (x, y) lands on after 'move', the forward
+// form of the moves SearchFlowField follows backwards. -1 if the move is
+// not possible or ends outside the field.
+static int FindFlowStep(World* world, const FlowField* field, int x, int y, FlowMove move) {
+    if (!IsCellStandable(world, x, y)) return -1;
+    
+    int side = (move == FLOW_LEFT || move == FLOW_JUMP_LEFT) ? -1 : 1;
+    int nx = x + side;
+    int ny = y;
+    if (move == FLOW_JUMP_LEFT || move == FLOW_JUMP_RIGHT) {
+        if (!IsCellPassable(world, x, y - 1)) return -1;
+        ny = y - 1;
+    } else {
+        while (IsCellPassable(world, nx, ny) && !IsCellStandable(world, nx, ny)) ny++;
+    }
+    if (!IsInsideField(field, nx, ny) || !IsCellStandable(world, nx, ny)) return -1;
+    return FieldIndex(field, nx, ny);
+}
+
+// True if the step from cell 'from' to cell 'to' depends on any cell in
+// the field's dirty rectangle: the cells it passes through, and the ones
+// under them that decide whether they can be stood on.
+static bool StepTouchesDirty(const FlowField* field, int from, int to) {
+    int fromX = from % FLOW_FIELD_WIDTH;
+    int fromY = from / FLOW_FIELD_WIDTH;
+    int toX = to % FLOW_FIELD_WIDTH;
+    int toY = to / FLOW_FIELD_WIDTH;
+    int x1 = field->minX + (fromX < toX ? fromX : toX);
+    int x2 = field->minX + (fromX > toX ? fromX : toX);
+    int y1 = field->minY + (fromY < toY ? fromY : toY);
+    int y2 = field->minY + (fromY > toY ? fromY : toY) + 1;
+    return x1 <= field->dirtyMaxX && x2 >= field->dirtyMinX && y1 <= field->dirtyMaxY && y2 >= field->dirtyMinY;
+}
+
+static int CompareFlowSeeds(const void* a, const void* b) {
+    unsigned int left = *(const unsigned int*)a;
+    unsigned int right = *(const unsigned int*)b;
+    return (left > right) - (left < right);
+}
+
+static void BuildFlowField(World* world, FlowField* field) {
+    field->minX = field->targetX - FLOW_FIELD_RADIUS_X;
+    field->maxX = field->targetX + FLOW_FIELD_RADIUS_X;
+    field->minY = field->targetY - FLOW_FIELD_RADIUS_Y;
+    field->maxY = field->targetY + FLOW_FIELD_RADIUS_Y;
+    field->dirty = false;
+    
+    memset(field->distance, 0xFF, sizeof(field->distance));
+    memset(field->move, FLOW_NONE, sizeof(field->move));
+    
+    int goalY = field->targetY;
+    while (goalY <= field->maxY && IsCellPassable(world, field->targetX, goalY) &&
+           !IsCellStandable(world, field->targetX, goalY)) {
+        goalY++;
+    }
+    if (!IsCellStandable(world, field->targetX, goalY) || !IsInsideField(field, field->targetX, goalY)) {
+        return;
+    }
+    
+    int goal = FieldIndex(field, field->targetX, goalY);
+    field->distance[goal] = 0;
+    field->move[goal] = FLOW_ARRIVED;
+    field->next[goal] = (unsigned short)goal;
+    
+    size_t scratchMark = ArenaMark(&world->frameMemory);
+    int* queue = (int*)ArenaAlloc(&world->frameMemory, sizeof(int) * FLOW_CELLS, MEMORY_PATHFINDING);
+    if (queue == NULL) return;
+    unsigned int seed = (unsigned int)goal;
+    FlowFrontier frontier = { &seed, 0, 1, queue, 0, 0 };
+    SearchFlowField(world, field, &frontier);
+    
+    ArenaRewind(&world->frameMemory, scratchMark);
+}
+
+// Brings a field up to date with the edits in its dirty rectangle without
+// searching all of it again. A cell whose first step depends on an edited
+// cell and no longer lands where it did loses its route, and so does
+// every cell whose route went through it. The search then picks up from
+// the reached cells that a lost cell, or a cell next to the edits, can
+// step onto. Every other route was shortest before and nothing under it
+// changed, so it still is.
+static void RepairFlowField(World* world, FlowField* field) {
+    // Edits in the target's column can move the goal itself
+    if (field->targetX >= field->dirtyMinX && field->targetX <= field->dirtyMaxX &&
+        field->dirtyMaxY >= field->targetY) {
+        BuildFlowField(world, field);
+        return;
+    }
+    field->dirty = false;
+    
+    size_t scratchMark = ArenaMark(&world->frameMemory);
+    unsigned char* flags = (unsigned char*)ArenaAlloc(&world->frameMemory, FLOW_CELLS, MEMORY_PATHFINDING);
+    int* chain = (int*)ArenaAlloc(&world->frameMemory, sizeof(int) * FLOW_CELLS, MEMORY_PATHFINDING);
+    int* lostCells = (int*)ArenaAlloc(&world->frameMemory, sizeof(int) * FLOW_CELLS, MEMORY_PATHFINDING);
+    unsigned int* seeds = (unsigned int*)ArenaAlloc(&world->frameMemory, sizeof(unsigned int) * FLOW_CELLS, MEMORY_PATHFINDING);
+    int* queue = (int*)ArenaAlloc(&world->frameMemory, sizeof(int) * FLOW_CELLS, MEMORY_PATHFINDING);
+    if (flags == NULL || chain == NULL || lostCells == NULL || seeds == NULL || queue == NULL) {
+        ArenaRewind(&world->frameMemory, scratchMark);
+        BuildFlowField(world, field);
+        return;
+    }
+    
+    // Follows each reached cell's steps until one already judged, then
+    // judges the chain back from there: a cell keeps its route only if the
+    // cell it steps onto does and its own step still lands there
+    enum { FLOW_JUDGED = 1, FLOW_LOST = 2, FLOW_SEEDED = 4 };
+    memset(flags, 0, FLOW_CELLS);
+    int lostCount = 0;
+    for (int start = 0; start < FLOW_CELLS; start++) {
+        if (field->distance[start] == FLOW_UNREACHED || (flags[start] & FLOW_JUDGED)) continue;
+        
+        int length = 0;
+        int index = start;
+        while (!(flags[index] & FLOW_JUDGED) && field->distance[index] != 0) {
+            chain[length++] = index;
+            index = field->next[index];
+        }
+        bool lost = (flags[index] & FLOW_LOST) != 0;
+        flags[index] |= FLOW_JUDGED;
+        
+        while (length > 0) {
+            index = chain[--length];
+            int next = field->next[index];
+            if (!lost && StepTouchesDirty(field, index, next)) {
+                int x = field->minX + index % FLOW_FIELD_WIDTH;
+                int y = field->minY + index / FLOW_FIELD_WIDTH;
+                lost = FindFlowStep(world, field, x, y, (FlowMove)field->move[index]) != next;
+            }
+            flags[index] |= FLOW_JUDGED;
+            if (lost) {
+                flags[index] |= FLOW_LOST;
+                field->distance[index] = FLOW_UNREACHED;
+                field->move[index] = FLOW_NONE;
+                lostCells[lostCount++] = index;
+            }
+        }
+    }
+    
+    // Any cell that can now step somewhere new is a lost one or sits in
+    // the columns of the edits, at most a row below them. What it steps
+    // onto, if still reached, searches again from where it stands.
+    int seedCount = 0;
+    int stripX1 = field->dirtyMinX - 1 > field->minX ? field->dirtyMinX - 1 : field->minX;
+    int stripX2 = field->dirtyMaxX + 1 < field->maxX ? field->dirtyMaxX + 1 : field->maxX;
+    int stripY2 = field->dirtyMaxY + 1 < field->maxY ? field->dirtyMaxY + 1 : field->maxY;
+    int stripWidth = stripX2 >= stripX1 ? stripX2 - stripX1 + 1 : 0;
+    int stripCells = stripY2 >= field->minY ? stripWidth * (stripY2 - field->minY + 1) : 0;
+    for (int i = 0; i < stripCells + lostCount; i++) {
+        int x, y;
+        if (i < stripCells) {
+            x = stripX1 + i % stripWidth;
+            y = field->minY + i / stripWidth;
+        } else {
+            x = field->minX + lostCells[i - stripCells] % FLOW_FIELD_WIDTH;
+            y = field->minY + lostCells[i - stripCells] / FLOW_FIELD_WIDTH;
+        }
+        if (!IsCellStandable(world, x, y)) continue;
+        
+        for (FlowMove move = FLOW_LEFT; move <= FLOW_JUMP_RIGHT; move++) {
+            int step = FindFlowStep(world, field, x, y, move);
+            if (step < 0 || field->distance[step] == FLOW_UNREACHED || (flags[step] & FLOW_SEEDED)) continue;
+            flags[step] |= FLOW_SEEDED;
+            seeds[seedCount++] = (unsigned int)field->distance[step] << 16 | (unsigned int)step;
+        }
+    }
+    qsort(seeds, seedCount, sizeof(unsigned int), CompareFlowSeeds);
+    
+    FlowFrontier frontier = { seeds, 0, seedCount, queue, 0, 0 };
+    SearchFlowField(world, field, &frontier);
+    
+    ArenaRewind(&world->frameMemory, scratchMark);
+}
+
+void ResetFlowFields(World* world) {
+    for (int i = 0; i < MAX_FLOW_FIELDS; i++) {
+        world->flowFields[i].active = false;
+    }
+    world->flowFieldStamp = 0;
+}
+
+// Standability depends on the cell below, so edits one row under a
+// field's window still matter to it
+void InvalidateFlowFieldRect(World* world, int x1, int y1, int x2, int y2) {
+    for (int i = 0; i < MAX_FLOW_FIELDS; i++) {
+        FlowField* field = &world->flowFields[i];
+        if (!field->active || x2 < field->minX || x1 > field->maxX || y2 < field->minY || y1 > field->maxY + 1) {
+            continue;
+        }
+        
+        if (!field->dirty) {
+            field->dirty = true;
+            field->dirtyMinX = x1;
+            field->dirtyMinY = y1;
+            field->dirtyMaxX = x2;
+            field->dirtyMaxY = y2;
+        } else {
+            if (x1 < field->dirtyMinX) field->dirtyMinX = x1;
+            if (y1 < field->dirtyMinY) field->dirtyMinY = y1;
+            if (x2 > field->dirtyMaxX) field->dirtyMaxX = x2;
+            if (y2 > field->dirtyMaxY) field->dirtyMaxY = y2;
+        }
+    }
+}
+
+// Only a change of solid or liquid moves a walker's routes
+void InvalidateFlowFields(World* world, int x, int y, BlockType previous) {
+    unsigned int walkPlanes = (1u << BLOCK_PLANE_SOLID) | (1u << BLOCK_PLANE_LIQUID);
+    if (((GetBlockPlaneMask(previous) ^ GetBlockPlaneMask(world->blocks[y][x])) & walkPlanes) == 0) return;
+    InvalidateFlowFieldRect(world, x, y, x, y);
+}
+
+// Returns the field toward the target cell, building it only when no field
+// for that target exists and repairing it after edits. Fields are recycled
+// least recently used.
+FlowField* AcquireFlowField(World* world, int targetX, int targetY) {
+    FlowField* slot = NULL;
+    
+    for (int i = 0; i < MAX_FLOW_FIELDS; i++) {
+        FlowField* field = &world->flowFields[i];
+        if (field->active && field->targetX == targetX && field->targetY == targetY) {
+            slot = field;
+            break;
+        }
+    }
+    
+    if (slot == NULL) {
+        slot = &world->flowFields[0];
+        for (int i = 0; i < MAX_FLOW_FIELDS; i++) {
+            FlowField* field = &world->flowFields[i];
+            if (!field->active) {
+                slot = field;
+                break;
+            }
+            if (field->lastUsed < slot->lastUsed) {
+                slot = field;
+            }
+        }
+        slot->active = true;
+        slot->targetX = targetX;
+        slot->targetY = targetY;
+        BuildFlowField(world, slot);
+    } else if (slot->dirty) {
+        RepairFlowField(world, slot);
+    }
+    
+    slot->lastUsed = ++world->flowFieldStamp;
+    return slot;
+}
+
+FlowMove GetFlowMove(World* world, int targetX, int targetY, int x, int y) {
+    FlowField* field = AcquireFlowField(world, targetX, targetY);
+    
+    if (!IsInsideField(field, x, y)) {
+        return FLOW_NONE;
+    }
+    return (FlowMove)field->move[FieldIndex(field, x, y)];
+}
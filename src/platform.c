@@ -0,0 +1,757 @@
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOGDI
+#define NOUSER
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <io.h>
+#include <intrin.h>
+#else
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#endif
+#include <time.h>
+#include <unistd.h>
+#endif
+
+uint64_t PlatformGetTicks(void) {
+#if defined(_WIN32)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    QueryPerformanceCounter(&counter);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ull +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ull / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+void PlatformSleep(uint64_t nanoseconds) {
+#if defined(_WIN32)
+    Sleep((DWORD)(nanoseconds / 1000000));
+#else
+    struct timespec ts = { (time_t)(nanoseconds / 1000000000ull), (long)(nanoseconds % 1000000000ull) };
+    nanosleep(&ts, NULL);
+#endif
+}
+
+bool PlatformInitNetwork(void) {
+#if defined(_WIN32)
+    WSADATA data;
+    return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+#else
+    return true;
+#endif
+}
+
+void PlatformShutdownNetwork(void) {
+#if defined(_WIN32)
+    WSACleanup();
+#endif
+}
+
+// Port 0 binds an ephemeral port, which is what clients want
+intptr_t PlatformOpenUdpSocket(uint16_t port) {
+#if defined(_WIN32)
+    SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle == INVALID_SOCKET) return -1;
+#else
+    int handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle < 0) return -1;
+#endif
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    
+    bool ok = bind(handle, (struct sockaddr*)&address, sizeof(address)) == 0;
+#if defined(_WIN32)
+    u_long nonBlocking = 1;
+    ok = ok && ioctlsocket(handle, FIONBIO, &nonBlocking) == 0;
+#else
+    ok = ok && fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+    if (!ok) {
+        PlatformCloseSocket((intptr_t)handle);
+        return -1;
+    }
+    return (intptr_t)handle;
+}
+
+void PlatformCloseSocket(intptr_t socket) {
+    if (socket < 0) return;
+#if defined(_WIN32)
+    closesocket((SOCKET)socket);
+#else
+    close((int)socket);
+#endif
+}
+
+bool PlatformResolveHost(const char* name, uint32_t* host) {
+    struct addrinfo hints;
+    struct addrinfo* result = NULL;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    
+    if (getaddrinfo(name, NULL, &hints, &result) != 0 || result == NULL) return false;
+    
+    *host = ntohl(((struct sockaddr_in*)result->ai_addr)->sin_addr.s_addr);
+    freeaddrinfo(result);
+    return true;
+}
+
+bool PlatformSendTo(intptr_t socket, uint32_t host, uint16_t port, const void* data, int size) {
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(host);
+    address.sin_port = htons(port);
+
+#if defined(_WIN32)
+    return sendto((SOCKET)socket, (const char*)data, size, 0, (struct sockaddr*)&address, sizeof(address)) == size;
+#else
+    return sendto((int)socket, data, (size_t)size, 0, (struct sockaddr*)&address, sizeof(address)) == size;
+#endif
+}
+
+// Errors are reported as "nothing waiting" too. On Windows a port
+// unreachable reply from an earlier send surfaces here as one.
+int PlatformReceiveFrom(intptr_t socket, uint32_t* host, uint16_t* port, void* buffer, int capacity) {
+    struct sockaddr_in address;
+#if defined(_WIN32)
+    int addressSize = sizeof(address);
+    int size = recvfrom((SOCKET)socket, (char*)buffer, capacity, 0, (struct sockaddr*)&address, &addressSize);
+#else
+    socklen_t addressSize = sizeof(address);
+    int size = (int)recvfrom((int)socket, buffer, (size_t)capacity, 0, (struct sockaddr*)&address, &addressSize);
+#endif
+    if (size <= 0) return 0;
+    
+    *host = ntohl(address.sin_addr.s_addr);
+    *port = ntohs(address.sin_port);
+    return size;
+}
+
+struct PlatformThread {
+    PlatformThreadFunction function;
+    void* argument;
+#if defined(_WIN32)
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+};
+
+struct PlatformMutex {
+#if defined(_WIN32)
+    SRWLOCK lock;
+#else
+    pthread_mutex_t lock;
+#endif
+};
+
+struct PlatformCondition {
+#if defined(_WIN32)
+    CONDITION_VARIABLE variable;
+#else
+    pthread_cond_t variable;
+#endif
+};
+
+#if defined(_WIN32)
+static DWORD WINAPI ThreadEntry(LPVOID parameter) {
+    PlatformThread* thread = (PlatformThread*)parameter;
+    thread->function(thread->argument);
+    return 0;
+}
+#else
+static void* ThreadEntry(void* parameter) {
+    PlatformThread* thread = (PlatformThread*)parameter;
+    thread->function(thread->argument);
+    return NULL;
+}
+#endif
+
+PlatformThread* PlatformCreateThread(PlatformThreadFunction function, void* argument) {
+    PlatformThread* thread = (PlatformThread*)malloc(sizeof(PlatformThread));
+    if (thread == NULL) return NULL;
+    
+    thread->function = function;
+    thread->argument = argument;
+#if defined(_WIN32)
+    thread->handle = CreateThread(NULL, 0, ThreadEntry, thread, 0, NULL);
+    bool ok = thread->handle != NULL;
+#else
+    bool ok = pthread_create(&thread->handle, NULL, ThreadEntry, thread) == 0;
+#endif
+    if (!ok) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void PlatformJoinThread(PlatformThread* thread) {
+    if (thread == NULL) return;
+#if defined(_WIN32)
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, NULL);
+#endif
+    free(thread);
+}
+
+PlatformMutex* PlatformCreateMutex(void) {
+    PlatformMutex* mutex = (PlatformMutex*)malloc(sizeof(PlatformMutex));
+    if (mutex == NULL) return NULL;
+#if defined(_WIN32)
+    InitializeSRWLock(&mutex->lock);
+#else
+    pthread_mutex_init(&mutex->lock, NULL);
+#endif
+    return mutex;
+}
+
+void PlatformDestroyMutex(PlatformMutex* mutex) {
+    if (mutex == NULL) return;
+#if !defined(_WIN32)
+    pthread_mutex_destroy(&mutex->lock);
+#endif
+    free(mutex);
+}
+
+void PlatformLockMutex(PlatformMutex* mutex) {
+#if defined(_WIN32)
+    AcquireSRWLockExclusive(&mutex->lock);
+#else
+    pthread_mutex_lock(&mutex->lock);
+#endif
+}
+
+void PlatformUnlockMutex(PlatformMutex* mutex) {
+#if defined(_WIN32)
+    ReleaseSRWLockExclusive(&mutex->lock);
+#else
+    pthread_mutex_unlock(&mutex->lock);
+#endif
+}
+
+PlatformCondition* PlatformCreateCondition(void) {
+    PlatformCondition* condition = (PlatformCondition*)malloc(sizeof(PlatformCondition));
+    if (condition == NULL) return NULL;
+#if defined(_WIN32)
+    InitializeConditionVariable(&condition->variable);
+#else
+    pthread_cond_init(&condition->variable, NULL);
+#endif
+    return condition;
+}
+
+void PlatformDestroyCondition(PlatformCondition* condition) {
+    if (condition == NULL) return;
+#if !defined(_WIN32)
+    pthread_cond_destroy(&condition->variable);
+#endif
+    free(condition);
+}
+
+// May wake spuriously; callers wait in a loop on their own condition
+void PlatformWaitCondition(PlatformCondition* condition, PlatformMutex* mutex) {
+#if defined(_WIN32)
+    SleepConditionVariableSRW(&condition->variable, &mutex->lock, INFINITE, 0);
+#else
+    pthread_cond_wait(&condition->variable, &mutex->lock);
+#endif
+}
+
+void PlatformSignalCondition(PlatformCondition* condition) {
+#if defined(_WIN32)
+    WakeConditionVariable(&condition->variable);
+#else
+    pthread_cond_signal(&condition->variable);
+#endif
+}
+
+void PlatformBroadcastCondition(PlatformCondition* condition) {
+#if defined(_WIN32)
+    WakeAllConditionVariable(&condition->variable);
+#else
+    pthread_cond_broadcast(&condition->variable);
+#endif
+}
+
+int PlatformGetCpuCount(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
+bool PlatformHasAvx2(void) {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    // OSXSAVE and AVX, then the OS must be saving the YMM registers
+    if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0) return false;
+    if ((_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#else
+    return false;
+#endif
+}
+
+// True if the directory exists afterwards, whether or not it was created
+bool PlatformMakeDirectory(const char* path) {
+#if defined(_WIN32)
+    return CreateDirectoryA(path, NULL) || GetLastError() == ERROR_ALREADY_EXISTS;
+#else
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+#endif
+}
+
+bool PlatformMakeTempDirectory(const char* prefix, char* path, int capacity) {
+#if defined(_WIN32)
+    char base[MAX_PATH + 1];
+    DWORD length = GetTempPathA(sizeof(base), base);
+    if (length == 0 || length > MAX_PATH) return false;
+    for (unsigned int attempt = 0; attempt < 100; attempt++) {
+        snprintf(path, capacity, "%s%s_%lu_%u", base, prefix, GetCurrentProcessId(), attempt);
+        if (CreateDirectoryA(path, NULL)) return true;
+        if (GetLastError() != ERROR_ALREADY_EXISTS) return false;
+    }
+    return false;
+#else
+    const char* base = getenv("TMPDIR");
+    if (base == NULL || base[0] == '\0') base = "/tmp";
+    if (snprintf(path, capacity, "%s/%s_XXXXXX", base, prefix) >= capacity) return false;
+    return mkdtemp(path) != NULL;
+#endif
+}
+
+bool PlatformRemoveDirectory(const char* path) {
+    char file[1024];
+#if defined(_WIN32)
+    WIN32_FIND_DATAA entry;
+    snprintf(file, sizeof(file), "%s\\*", path);
+    HANDLE find = FindFirstFileA(file, &entry);
+    if (find != INVALID_HANDLE_VALUE) {
+        do {
+            if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) continue;
+            snprintf(file, sizeof(file), "%s\\%s", path, entry.cFileName);
+            DeleteFileA(file);
+        } while (FindNextFileA(find, &entry));
+        FindClose(find);
+    }
+    return RemoveDirectoryA(path) != 0;
+#else
+    DIR* directory = opendir(path);
+    if (directory != NULL) {
+        struct dirent* entry;
+        while ((entry = readdir(directory)) != NULL) {
+            if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) continue;
+            snprintf(file, sizeof(file), "%s/%s", path, entry->d_name);
+            unlink(file);
+        }
+        closedir(directory);
+    }
+    return rmdir(path) == 0;
+#endif
+}
+
+// Pushes everything written so far through to the disk
+bool PlatformSyncFile(FILE* file) {
+    if (fflush(file) != 0) return false;
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+bool PlatformReplaceFile(const char* source, const char* destination) {
+#if defined(_WIN32)
+    return MoveFileExA(source, destination, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(source, destination) == 0;
+#endif
+}
+
+const void* PlatformMapFile(const char* path, size_t* size) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return NULL;
+    
+    LARGE_INTEGER length;
+    void* data = NULL;
+    if (GetFileSizeEx(file, &length) && length.QuadPart > 0) {
+        // The view keeps the mapping alive once both handles are closed
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL) {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+    if (data == NULL) return NULL;
+    *size = (size_t)length.QuadPart;
+    return data;
+#else
+    int file = open(path, O_RDONLY);
+    if (file < 0) return NULL;
+    
+    struct stat info;
+    void* data = MAP_FAILED;
+    if (fstat(file, &info) == 0 && info.st_size > 0) {
+        data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    }
+    close(file);
+    if (data == MAP_FAILED) return NULL;
+    *size = (size_t)info.st_size;
+    return data;
+#endif
+}
+
+void PlatformUnmapFile(const void* data, size_t size) {
+#if defined(_WIN32)
+    (void)size;
+    UnmapViewOfFile(data);
+#else
+    munmap((void*)data, size);
+#endif
+}
+
+// One queued read. The thread pool fills 'size' itself; io_uring reports
+// it in the completion.
+typedef struct {
+    bool used;
+    bool done;
+    char path[512];
+    void* buffer;
+    int capacity;
+    intptr_t tag;
+    int size;
+    bool claimed;
+    int descriptor;
+} FileRead;
+
+struct PlatformFileReader {
+    FileRead reads[PLATFORM_MAX_FILE_READS];
+    bool useRing;
+#if defined(__linux__)
+    int ring;
+    unsigned int* submitHead;
+    unsigned int* submitTail;
+    unsigned int* submitMask;
+    unsigned int* submitArray;
+    struct io_uring_sqe* entries;
+    unsigned int* completeHead;
+    unsigned int* completeTail;
+    unsigned int* completeMask;
+    struct io_uring_cqe* completions;
+    void* submitMemory;
+    size_t submitMemorySize;
+    void* completeMemory;
+    size_t completeMemorySize;
+    size_t entriesSize;
+#endif
+    PlatformMutex* mutex;
+    PlatformCondition* wake;
+    PlatformThread* threads[8];
+    int threadCount;
+    bool quit;
+};
+
+#if defined(__linux__)
+// The raw system calls; there is no liburing dependency
+static bool OpenRing(PlatformFileReader* reader) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int ring = (int)syscall(__NR_io_uring_setup, PLATFORM_MAX_FILE_READS, &params);
+    if (ring < 0) return false;
+    
+    reader->ring = ring;
+    reader->submitMemorySize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    reader->completeMemorySize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (reader->completeMemorySize > reader->submitMemorySize) reader->submitMemorySize = reader->completeMemorySize;
+        reader->completeMemorySize = reader->submitMemorySize;
+    }
+    
+    reader->submitMemory = mmap(NULL, reader->submitMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                                ring, IORING_OFF_SQ_RING);
+    if (reader->submitMemory == MAP_FAILED) {
+        close(ring);
+        return false;
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        reader->completeMemory = reader->submitMemory;
+    } else {
+        reader->completeMemory = mmap(NULL, reader->completeMemorySize, PROT_READ | PROT_WRITE,
+                                      MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_CQ_RING);
+    }
+    reader->entriesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+    reader->entries = (struct io_uring_sqe*)mmap(NULL, reader->entriesSize, PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, ring, IORING_OFF_SQES);
+    if (reader->completeMemory == MAP_FAILED || reader->entries == MAP_FAILED) {
+        if (reader->completeMemory != MAP_FAILED && reader->completeMemory != reader->submitMemory) {
+            munmap(reader->completeMemory, reader->completeMemorySize);
+        }
+        munmap(reader->submitMemory, reader->submitMemorySize);
+        close(ring);
+        return false;
+    }
+    
+    unsigned char* submit = (unsigned char*)reader->submitMemory;
+    reader->submitHead = (unsigned int*)(submit + params.sq_off.head);
+    reader->submitTail = (unsigned int*)(submit + params.sq_off.tail);
+    reader->submitMask = (unsigned int*)(submit + params.sq_off.ring_mask);
+    reader->submitArray = (unsigned int*)(submit + params.sq_off.array);
+    unsigned char* complete = (unsigned char*)reader->completeMemory;
+    reader->completeHead = (unsigned int*)(complete + params.cq_off.head);
+    reader->completeTail = (unsigned int*)(complete + params.cq_off.tail);
+    reader->completeMask = (unsigned int*)(complete + params.cq_off.ring_mask);
+    reader->completions = (struct io_uring_cqe*)(complete + params.cq_off.cqes);
+    return true;
+}
+
+static void CloseRing(PlatformFileReader* reader) {
+    munmap(reader->entries, reader->entriesSize);
+    if (reader->completeMemory != reader->submitMemory) munmap(reader->completeMemory, reader->completeMemorySize);
+    munmap(reader->submitMemory, reader->submitMemorySize);
+    close(reader->ring);
+}
+
+// Hands the kernel whatever it has not taken yet. An interrupted call just
+// leaves entries for the next one.
+static void FlushRing(PlatformFileReader* reader) {
+    unsigned int pending = *reader->submitTail - __atomic_load_n(reader->submitHead, __ATOMIC_ACQUIRE);
+    if (pending > 0) syscall(__NR_io_uring_enter, reader->ring, pending, 0, 0, NULL, 0);
+}
+
+// Opening is synchronous; only the read itself goes through the ring
+static void SubmitRingRead(PlatformFileReader* reader, int index) {
+    FileRead* read = &reader->reads[index];
+    read->descriptor = open(read->path, O_RDONLY);
+    if (read->descriptor < 0) {
+        read->size = -1;
+        read->done = true;
+        return;
+    }
+    
+    unsigned int tail = *reader->submitTail;
+    unsigned int slot = tail & *reader->submitMask;
+    struct io_uring_sqe* entry = &reader->entries[slot];
+    memset(entry, 0, sizeof(*entry));
+    entry->opcode = IORING_OP_READ;
+    entry->fd = read->descriptor;
+    entry->addr = (uint64_t)(uintptr_t)read->buffer;
+    entry->len = (unsigned int)read->capacity;
+    entry->off = 0;
+    entry->user_data = (uint64_t)index;
+    reader->submitArray[slot] = slot;
+    __atomic_store_n(reader->submitTail, tail + 1, __ATOMIC_RELEASE);
+    FlushRing(reader);
+}
+
+static void ReapRing(PlatformFileReader* reader) {
+    FlushRing(reader);
+    
+    unsigned int head = *reader->completeHead;
+    unsigned int tail = __atomic_load_n(reader->completeTail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe* completion = &reader->completions[head & *reader->completeMask];
+        FileRead* read = &reader->reads[completion->user_data];
+        // A file that fills the buffer exactly may have been cut short
+        read->size = (completion->res < 0 || completion->res >= read->capacity) ? -1 : completion->res;
+        read->done = true;
+        close(read->descriptor);
+        head++;
+    }
+    __atomic_store_n(reader->completeHead, head, __ATOMIC_RELEASE);
+}
+#endif
+
+static void ReadFileInto(FileRead* read) {
+    FILE* file = fopen(read->path, "rb");
+    if (file == NULL) {
+        read->size = -1;
+        return;
+    }
+    int size = (int)fread(read->buffer, 1, read->capacity, file);
+    read->size = size < read->capacity ? size : -1;
+    fclose(file);
+}
+
+static void FileReaderThread(void* argument) {
+    PlatformFileReader* reader = (PlatformFileReader*)argument;
+    PlatformLockMutex(reader->mutex);
+    for (;;) {
+        int index = -1;
+        for (int i = 0; i < PLATFORM_MAX_FILE_READS && index < 0; i++) {
+            if (reader->reads[i].used && !reader->reads[i].claimed) index = i;
+        }
+        if (index < 0) {
+            if (reader->quit) break;
+            PlatformWaitCondition(reader->wake, reader->mutex);
+            continue;
+        }
+        
+        FileRead* read = &reader->reads[index];
+        read->claimed = true;
+        PlatformUnlockMutex(reader->mutex);
+        ReadFileInto(read);
+        PlatformLockMutex(reader->mutex);
+        read->done = true;
+    }
+    PlatformUnlockMutex(reader->mutex);
+}
+
+PlatformFileReader* PlatformCreateFileReader(int threadCount) {
+    PlatformFileReader* reader = (PlatformFileReader*)calloc(1, sizeof(PlatformFileReader));
+    if (reader == NULL) return NULL;
+
+#if defined(__linux__)
+    reader->useRing = OpenRing(reader);
+#endif
+    reader->mutex = PlatformCreateMutex();
+    reader->wake = PlatformCreateCondition();
+    if (reader->mutex == NULL || reader->wake == NULL) {
+        PlatformDestroyFileReader(reader);
+        return NULL;
+    }
+    if (reader->useRing) return reader;
+    
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > 8) threadCount = 8;
+    for (int i = 0; i < threadCount; i++) {
+        reader->threads[i] = PlatformCreateThread(FileReaderThread, reader);
+        if (reader->threads[i] == NULL) break;
+        reader->threadCount++;
+    }
+    if (reader->threadCount == 0) {
+        PlatformDestroyFileReader(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+// Waits for reads still in flight, since they write into caller buffers
+void PlatformDestroyFileReader(PlatformFileReader* reader) {
+    if (reader == NULL) return;
+
+#if defined(__linux__)
+    if (reader->useRing) {
+        for (;;) {
+            bool waiting = false;
+            for (int i = 0; i < PLATFORM_MAX_FILE_READS; i++) {
+                waiting = waiting || (reader->reads[i].used && !reader->reads[i].done);
+            }
+            if (!waiting) break;
+            syscall(__NR_io_uring_enter, reader->ring, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+            ReapRing(reader);
+        }
+        CloseRing(reader);
+    }
+#endif
+    if (reader->threadCount > 0) {
+        // Threads check 'quit' before they wait, so only those already
+        // waiting need waking, one signal each
+        PlatformLockMutex(reader->mutex);
+        reader->quit = true;
+        for (int i = 0; i < reader->threadCount; i++) {
+            PlatformSignalCondition(reader->wake);
+        }
+        PlatformUnlockMutex(reader->mutex);
+        for (int i = 0; i < reader->threadCount; i++) {
+            PlatformJoinThread(reader->threads[i]);
+        }
+    }
+    PlatformDestroyCondition(reader->wake);
+    PlatformDestroyMutex(reader->mutex);
+    free(reader);
+}
+
+const char* PlatformGetFileReaderBackend(const PlatformFileReader* reader) {
+    return reader->useRing ? "io_uring" : "threads";
+}
+
+bool PlatformQueueFileRead(PlatformFileReader* reader, const char* path, void* buffer, int capacity, intptr_t tag) {
+    PlatformLockMutex(reader->mutex);
+    int index = -1;
+    for (int i = 0; i < PLATFORM_MAX_FILE_READS && index < 0; i++) {
+        if (!reader->reads[i].used) index = i;
+    }
+    if (index < 0) {
+        PlatformUnlockMutex(reader->mutex);
+        return false;
+    }
+    
+    FileRead* read = &reader->reads[index];
+    memset(read, 0, sizeof(*read));
+    snprintf(read->path, sizeof(read->path), "%s", path);
+    read->buffer = buffer;
+    read->capacity = capacity;
+    read->tag = tag;
+    read->used = true;
+    
+#if defined(__linux__)
+    if (reader->useRing) SubmitRingRead(reader, index);
+#endif
+    if (!reader->useRing) PlatformSignalCondition(reader->wake);
+    PlatformUnlockMutex(reader->mutex);
+    return true;
+}
+
+bool PlatformPollFileRead(PlatformFileReader* reader, intptr_t* tag, int* size) {
+    PlatformLockMutex(reader->mutex);
+#if defined(__linux__)
+    if (reader->useRing) ReapRing(reader);
+#endif
+    bool found = false;
+    for (int i = 0; i < PLATFORM_MAX_FILE_READS && !found; i++) {
+        FileRead* read = &reader->reads[i];
+        if (!read->used || !read->done) continue;
+        
+        *tag = read->tag;
+        *size = read->size;
+        read->used = false;
+        found = true;
+    }
+    PlatformUnlockMutex(reader->mutex);
+    return found;
+}
@@ -0,0 +1,80 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+// OS services the game needs beyond raylib. Kept out of game.h because the
+// Windows headers behind it clash with raylib's names.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Monotonic clock in nanoseconds since an arbitrary start point
+uint64_t PlatformGetTicks(void);
+void PlatformSleep(uint64_t nanoseconds);
+
+// Non-blocking IPv4 UDP. Hosts and ports are in host byte order; a socket
+// is -1 when it could not be opened.
+bool PlatformInitNetwork(void);
+void PlatformShutdownNetwork(void);
+intptr_t PlatformOpenUdpSocket(uint16_t port);
+void PlatformCloseSocket(intptr_t socket);
+bool PlatformResolveHost(const char* name, uint32_t* host);
+bool PlatformSendTo(intptr_t socket, uint32_t host, uint16_t port, const void* data, int size);
+// Returns the datagram size, or 0 when nothing is waiting
+int PlatformReceiveFrom(intptr_t socket, uint32_t* host, uint16_t* port, void* buffer, int capacity);
+
+// Threads and blocking synchronization. Handles are opaque; the Create
+// functions return NULL on failure.
+typedef struct PlatformThread PlatformThread;
+typedef struct PlatformMutex PlatformMutex;
+typedef struct PlatformCondition PlatformCondition;
+typedef void (*PlatformThreadFunction)(void* argument);
+
+PlatformThread* PlatformCreateThread(PlatformThreadFunction function, void* argument);
+// Waits for the thread to return and frees the handle
+void PlatformJoinThread(PlatformThread* thread);
+PlatformMutex* PlatformCreateMutex(void);
+void PlatformDestroyMutex(PlatformMutex* mutex);
+void PlatformLockMutex(PlatformMutex* mutex);
+void PlatformUnlockMutex(PlatformMutex* mutex);
+PlatformCondition* PlatformCreateCondition(void);
+void PlatformDestroyCondition(PlatformCondition* condition);
+void PlatformWaitCondition(PlatformCondition* condition, PlatformMutex* mutex);
+void PlatformSignalCondition(PlatformCondition* condition);
+void PlatformBroadcastCondition(PlatformCondition* condition);
+// Logical processors available to the process, at least one
+int PlatformGetCpuCount(void);
+// True if the processor has AVX2 and the OS saves its registers
+bool PlatformHasAvx2(void);
+
+// Files. PlatformReplaceFile renames over an existing file in one step, so
+// readers see the old contents or the new, never a mix.
+bool PlatformMakeDirectory(const char* path);
+// Makes a new, empty directory in the system's temporary directory, named
+// after 'prefix', and writes its path out. False if none could be made.
+bool PlatformMakeTempDirectory(const char* prefix, char* path, int capacity);
+// Deletes the files directly inside a directory, then the directory
+bool PlatformRemoveDirectory(const char* path);
+bool PlatformSyncFile(FILE* file);
+bool PlatformReplaceFile(const char* source, const char* destination);
+// Read-only view of a whole file, or NULL if it cannot be opened or is
+// empty. Pages come in from the file as they are touched.
+const void* PlatformMapFile(const char* path, size_t* size);
+void PlatformUnmapFile(const void* data, size_t size);
+
+// Asynchronous whole-file reads into caller-owned buffers: io_uring where
+// the kernel offers it, otherwise a small pool of reader threads. Reads
+// complete in any order and come back with the tag they were queued with.
+#define PLATFORM_MAX_FILE_READS 64
+
+typedef struct PlatformFileReader PlatformFileReader;
+
+PlatformFileReader* PlatformCreateFileReader(int threadCount);
+void PlatformDestroyFileReader(PlatformFileReader* reader);
+const char* PlatformGetFileReaderBackend(const PlatformFileReader* reader);
+// False when PLATFORM_MAX_FILE_READS reads are already in flight
+bool PlatformQueueFileRead(PlatformFileReader* reader, const char* path, void* buffer, int capacity, intptr_t tag);
+// One finished read, if any. 'size' is -1 when the file could not be read.
+bool PlatformPollFileRead(PlatformFileReader* reader, intptr_t* tag, int* size);
+
+#endif
@@ -9,25 +9,12 @@ bool CheckCollision(World* world, int x, int y) {
         return true;
     }
     
-    return IsBlockSolid(world->blocks[blockY][blockX]);
+    return TestBlockPlane(world, BLOCK_PLANE_SOLID, blockX, blockY);
 }
 
 bool IsInWater(World* world, int x, int y, int width, int height) {
-    int blockX1 = x / BLOCK_SIZE;
-    int blockY1 = y / BLOCK_SIZE;
-    int blockX2 = (x + width - 1) / BLOCK_SIZE;
-    int blockY2 = (y + height - 1) / BLOCK_SIZE;
-    
-    for (int bx = blockX1; bx <= blockX2; bx++) {
-        for (int by = blockY1; by <= blockY2; by++) {
-            if (bx >= 0 && bx < WORLD_WIDTH && by >= 0 && by < WORLD_HEIGHT) {
-                if (world->blocks[by][bx] == BLOCK_WATER) {
-                    return true;
-                }
-            }
-        }
-    }
-    return false;
+    return AnyBlockPlaneInRect(world, BLOCK_PLANE_LIQUID, x / BLOCK_SIZE, y / BLOCK_SIZE,
+                               (x + width - 1) / BLOCK_SIZE, (y + height - 1) / BLOCK_SIZE);
 }
 
 void InitPlayer(Player* player) {
@@ -52,55 +39,31 @@ void InitPlayer(Player* player) {
     player->breakingBlockY = -1;
     player->craftingOpen = false;
     
-    for (int i = 0; i < INVENTORY_SIZE; i++) {
-        player->inventory[i].type = BLOCK_AIR;
-        player->inventory[i].tool = TOOL_NONE;
-        player->inventory[i].count = 0;
-        player->inventory[i].durability = 0;
-    }
-    
-    for (int i = 0; i < EXTENDED_INVENTORY_SIZE; i++) {
-        player->extendedInventory[i].type = BLOCK_AIR;
-        player->extendedInventory[i].tool = TOOL_NONE;
-        player->extendedInventory[i].count = 0;
-        player->extendedInventory[i].durability = 0;
-    }
+    InitContainer(&player->hotbar, INVENTORY_SIZE);
+    InitContainer(&player->backpack, EXTENDED_INVENTORY_SIZE);
     
-    player->inventory[0].type = BLOCK_DIRT;
-    player->inventory[0].count = 64;
-    player->inventory[1].type = BLOCK_STONE;
-    player->inventory[1].count = 32;
-    player->inventory[2].type = BLOCK_WOOD;
-    player->inventory[2].count = 16;
-    player->inventory[3].type = BLOCK_SAND;
-    player->inventory[3].count = 24;
+    SetContainerSlot(&player->hotbar, 0, (InventorySlot){ BLOCK_DIRT, TOOL_NONE, 64, 0 });
+    SetContainerSlot(&player->hotbar, 1, (InventorySlot){ BLOCK_STONE, TOOL_NONE, 32, 0 });
+    SetContainerSlot(&player->hotbar, 2, (InventorySlot){ BLOCK_WOOD, TOOL_NONE, 16, 0 });
+    SetContainerSlot(&player->hotbar, 3, (InventorySlot){ BLOCK_SAND, TOOL_NONE, 24, 0 });
+    SetContainerSlot(&player->hotbar, 4, (InventorySlot){ BLOCK_AIR, TOOL_WOODEN_PICKAXE, 1, GetToolDurability(TOOL_WOODEN_PICKAXE) });
     
-    player->extendedInventory[0].type = BLOCK_COAL_ORE;
-    player->extendedInventory[0].count = 5;
-    player->extendedInventory[1].type = BLOCK_IRON_ORE;
-    player->extendedInventory[1].count = 3;
-    player->extendedInventory[2].type = BLOCK_GOLD_ORE;
-    player->extendedInventory[2].count = 2;
-    
-    player->inventory[4].type = BLOCK_AIR;
-    player->inventory[4].tool = TOOL_WOODEN_PICKAXE;
-    player->inventory[4].count = 1;
-    player->inventory[4].durability = GetToolDurability(TOOL_WOODEN_PICKAXE);
+    SetContainerSlot(&player->backpack, 0, (InventorySlot){ BLOCK_COAL_ORE, TOOL_NONE, 5, 0 });
+    SetContainerSlot(&player->backpack, 1, (InventorySlot){ BLOCK_IRON_ORE, TOOL_NONE, 3, 0 });
+    SetContainerSlot(&player->backpack, 2, (InventorySlot){ BLOCK_GOLD_ORE, TOOL_NONE, 2, 0 });
 }
 
-void UpdatePlayer(World* world, float deltaTime) {
-    Player* player = &world->player;
-    
+void UpdatePlayer(World* world, Player* player, const InputFrame* input, float deltaTime) {
     player->inWater = IsInWater(world, player->x, player->y, 16, 32);
     
     float speed = player->inWater ? 150.0f : 250.0f;
     float jumpForce = player->inWater ? 200.0f : 450.0f;
     float gravity = player->inWater ? 200.0f : 900.0f;
-    float currentTime = GetTime();
+    float currentTime = input->time;
     
-    if (IsKeyDown(KEY_A) || IsKeyDown(KEY_LEFT)) {
+    if (InputDown(input, INPUT_LEFT)) {
         player->velX = -speed;
-    } else if (IsKeyDown(KEY_D) || IsKeyDown(KEY_RIGHT)) {
+    } else if (InputDown(input, INPUT_RIGHT)) {
         player->velX = speed;
     } else {
         float friction = player->inWater ? 0.7f : 0.85f;
@@ -108,15 +71,15 @@ void UpdatePlayer(World* world, float deltaTime) {
     }
     
     if (player->inWater) {
-        if (IsKeyDown(KEY_SPACE) || IsKeyDown(KEY_W) || IsKeyDown(KEY_UP)) {
+        if (InputDown(input, INPUT_UP)) {
             player->velY = -jumpForce;
-        } else if (IsKeyDown(KEY_S) || IsKeyDown(KEY_DOWN)) {
+        } else if (InputDown(input, INPUT_DOWN)) {
             player->velY = jumpForce;
         } else {
             player->velY *= 0.8f;
         }
     } else {
-        if ((IsKeyDown(KEY_SPACE) || IsKeyDown(KEY_W) || IsKeyDown(KEY_UP)) && 
+        if (InputDown(input, INPUT_UP) && 
             player->onGround && (currentTime - player->lastJumpTime) > 0.2f) {
             player->velY = -jumpForce;
             player->onGround = false;
@@ -133,112 +96,92 @@ void UpdatePlayer(World* world, float deltaTime) {
         if (player->velY < -200.0f) player->velY = -200.0f;
     }
     
-    int newX = player->x + (int)(player->velX * deltaTime);
-    int newY = player->y + (int)(player->velY * deltaTime);
+    BoxMoveResult move = MoveBox(world, &player->x, &player->y, 16, 32,
+                                 player->velX * deltaTime, player->velY * deltaTime);
     
-    if (!CheckCollision(world, newX, player->y) && 
-        !CheckCollision(world, newX + 15, player->y) &&
-        !CheckCollision(world, newX, player->y + 31) &&
-        !CheckCollision(world, newX + 15, player->y + 31)) {
-        player->x = newX;
-    } else {
+    if (move.hitX) {
         player->velX = 0;
     }
     
-    if (!CheckCollision(world, player->x, newY) && 
-        !CheckCollision(world, player->x + 15, newY) &&
-        !CheckCollision(world, player->x, newY + 31) &&
-        !CheckCollision(world, player->x + 15, newY + 31)) {
-        player->y = newY;
-        if (!player->inWater) {
-            player->onGround = false;
-        }
-    } else {
+    if (move.hitY) {
         if (player->velY > 0 && !player->inWater) {
             player->onGround = true;
         }
         player->velY = 0;
+    } else if (!player->inWater) {
+        player->onGround = false;
     }
-    
-    world->camera.target = (Vector2){ player->x + 8, player->y + 16 };
 }
 
-void AddToInventory(Player* player, BlockType blockType) {
-    // Try to add to existing stack in hotbar first
-    for (int i = 0; i < INVENTORY_SIZE; i++) {
-        if (player->inventory[i].type == blockType && player->inventory[i].tool == TOOL_NONE && 
-            player->inventory[i].count > 0 && player->inventory[i].count < 64) {
-            player->inventory[i].count++;
-            return;
-        }
-    }
-    
-    // Try to find empty slot in hotbar
-    for (int i = 0; i < INVENTORY_SIZE; i++) {
-        if (player->inventory[i].type == BLOCK_AIR || player->inventory[i].count == 0) {
-            // Clear the slot completely to ensure no old tool data remains
-            player->inventory[i].type = blockType;
-            player->inventory[i].tool = TOOL_NONE;
-            player->inventory[i].count = 1;
-            player->inventory[i].durability = 0;
-            return;
-        }
-    }
+Camera2D GetPlayerCamera(const Player* player) {
+    Camera2D camera = { 0 };
+    camera.target = (Vector2){ player->x + 8, player->y + 16 };
+    camera.offset = (Vector2){ SCREEN_WIDTH / 2.0f, SCREEN_HEIGHT / 2.0f };
+    camera.zoom = 1.0f;
+    return camera;
+}
+
+// One frame of a player's own input, in the order the game loop runs it
+void StepPlayer(World* world, Player* player, const InputFrame* input) {
+    HandleInventoryInput(player, input);
+    HandleExtendedInventory(player, input);
+    HandleCrafting(player, input);
     
-    // Try to add to existing stack in extended inventory
-    for (int i = 0; i < EXTENDED_INVENTORY_SIZE; i++) {
-        if (player->extendedInventory[i].type == blockType && player->extendedInventory[i].tool == TOOL_NONE && 
-            player->extendedInventory[i].count > 0 && player->extendedInventory[i].count < 64) {
-            player->extendedInventory[i].count++;
-            return;
-        }
+    if (!player->inventoryOpen && !player->craftingOpen) {
+        UpdatePlayer(world, player, input, input->deltaTime);
+        UpdateBlockTarget(world, player, input);
+        HandleBlockInteraction(world, player, input, input->deltaTime);
     }
+}
+
+// The player animals react to: the local one, or on a server the closest
+// connected one. NULL on a server nobody is connected to.
+Player* GetNearestPlayer(World* world, float x, float y) {
+    if (world->role != NET_ROLE_SERVER) return &world->player;
     
-    // Try to find empty slot in extended inventory
-    for (int i = 0; i < EXTENDED_INVENTORY_SIZE; i++) {
-        if (player->extendedInventory[i].type == BLOCK_AIR || player->extendedInventory[i].count == 0) {
-            // Clear the slot completely to ensure no old tool data remains
-            player->extendedInventory[i].type = blockType;
-            player->extendedInventory[i].tool = TOOL_NONE;
-            player->extendedInventory[i].count = 1;
-            player->extendedInventory[i].durability = 0;
-            return;
+    Player* nearest = NULL;
+    float nearestDistance = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (!world->playerActive[i]) continue;
+        
+        float dx = world->players[i].x - x;
+        float dy = world->players[i].y - y;
+        float distance = dx * dx + dy * dy;
+        if (nearest == NULL || distance < nearestDistance) {
+            nearest = &world->players[i];
+            nearestDistance = distance;
         }
     }
+    return nearest;
 }
 
-bool RemoveFromInventory(Player* player, BlockType blockType) {
-    for (int i = 0; i < INVENTORY_SIZE; i++) {
-        if (player->inventory[i].type == blockType && player->inventory[i].count > 0) {
-            player->inventory[i].count--;
-            if (player->inventory[i].count == 0) {
-                player->inventory[i].type = BLOCK_AIR;
-            }
-            return true;
-        }
-    }
-    return false;
+int GetItemCount(Player* player, BlockType blockType) {
+    return player->hotbar.itemCounts[blockType] + player->backpack.itemCounts[blockType];
 }
 
-void HandleInventoryInput(World* world) {
-    Player* player = &world->player;
-    
-    if (IsKeyPressed(KEY_E)) {
+// Hotbar first, then the backpack. Returns how many items did not fit.
+int AddToInventory(Player* player, BlockType blockType, int count) {
+    count = AddToContainer(&player->hotbar, blockType, count);
+    return AddToContainer(&player->backpack, blockType, count);
+}
+
+// Returns how many items were removed
+int RemoveFromInventory(Player* player, BlockType blockType, int count) {
+    int removed = RemoveFromContainer(&player->hotbar, blockType, count);
+    return removed + RemoveFromContainer(&player->backpack, blockType, count - removed);
+}
+
+void HandleInventoryInput(Player* player, const InputFrame* input) {
+    if (InputPressed(input, INPUT_INVENTORY)) {
         player->inventoryOpen = !player->inventoryOpen;
     }
     
     if (!player->inventoryOpen) {
-        if (IsKeyPressed(KEY_ONE)) player->selectedSlot = 0;
-        if (IsKeyPressed(KEY_TWO)) player->selectedSlot = 1;
-        if (IsKeyPressed(KEY_THREE)) player->selectedSlot = 2;
-        if (IsKeyPressed(KEY_FOUR)) player->selectedSlot = 3;
-        if (IsKeyPressed(KEY_FIVE)) player->selectedSlot = 4;
-        if (IsKeyPressed(KEY_SIX)) player->selectedSlot = 5;
-        if (IsKeyPressed(KEY_SEVEN)) player->selectedSlot = 6;
-        if (IsKeyPressed(KEY_EIGHT)) player->selectedSlot = 7;
-        if (IsKeyPressed(KEY_NINE)) player->selectedSlot = 8;
+        for (int i = 0; i < INVENTORY_SIZE; i++) {
+            if (InputPressed(input, (InputAction)(INPUT_SLOT_1 + i))) player->selectedSlot = i;
+        }
         
-        float mouseWheel = GetMouseWheelMove();
+        float mouseWheel = input->wheel;
         if (mouseWheel != 0) {
             player->selectedSlot -= (int)mouseWheel;
             if (player->selectedSlot < 0) player->selectedSlot = INVENTORY_SIZE - 1;
@@ -247,20 +190,16 @@ void HandleInventoryInput(World* world) {
     }
 }
 
-void SwapInventorySlots(InventorySlot* slot1, InventorySlot* slot2) {
-    InventorySlot temp = *slot1;
-    *slot1 = *slot2;
-    *slot2 = temp;
+static InventoryContainer* GetDragSource(Player* player) {
+    return player->dragFromExtended ? &player->backpack : &player->hotbar;
 }
 
-void HandleExtendedInventory(World* world) {
-    Player* player = &world->player;
-    
+void HandleExtendedInventory(Player* player, const InputFrame* input) {
     if (!player->inventoryOpen) return;
     
-    Vector2 mousePos = GetMousePosition();
+    Vector2 mousePos = input->mouse;
     
-    if (IsMouseButtonPressed(MOUSE_LEFT_BUTTON)) {
+    if (InputPressed(input, INPUT_PRIMARY)) {
         int slotSize = 50;
         int startX = SCREEN_WIDTH / 2 - 225;
         int startY = SCREEN_HEIGHT / 2 - 135;
@@ -268,12 +207,11 @@ void HandleExtendedInventory(World* world) {
         for (int i = 0; i < INVENTORY_SIZE; i++) {
             Rectangle slotRect = {startX + (i % 9) * slotSize, startY + 180, slotSize, slotSize};
             if (CheckCollisionPointRec(mousePos, slotRect)) {
-                if (player->isDragging) {
-                    if (player->dragFromExtended) {
-                        SwapInventorySlots(&player->extendedInventory[player->draggedSlot], &player->inventory[i]);
-                    } else {
-                        SwapInventorySlots(&player->inventory[player->draggedSlot], &player->inventory[i]);
-                    }
+                // Shift-click sends the whole slot to the other container
+                if (!player->isDragging && InputDown(input, INPUT_MODIFIER)) {
+                    MoveSlotToContainer(&player->hotbar, i, &player->backpack);
+                } else if (player->isDragging) {
+                    SwapContainerSlots(GetDragSource(player), player->draggedSlot, &player->hotbar, i);
                     player->isDragging = false;
                     player->draggedSlot = -1;
                 } else {
@@ -290,12 +228,10 @@ void HandleExtendedInventory(World* world) {
             int col = i % 9;
             Rectangle slotRect = {startX + col * slotSize, startY + row * slotSize, slotSize, slotSize};
             if (CheckCollisionPointRec(mousePos, slotRect)) {
-                if (player->isDragging) {
-                    if (player->dragFromExtended) {
-                        SwapInventorySlots(&player->extendedInventory[player->draggedSlot], &player->extendedInventory[i]);
-                    } else {
-                        SwapInventorySlots(&player->inventory[player->draggedSlot], &player->extendedInventory[i]);
-                    }
+                if (!player->isDragging && InputDown(input, INPUT_MODIFIER)) {
+                    MoveSlotToContainer(&player->backpack, i, &player->hotbar);
+                } else if (player->isDragging) {
+                    SwapContainerSlots(GetDragSource(player), player->draggedSlot, &player->backpack, i);
                     player->isDragging = false;
                     player->draggedSlot = -1;
                 } else {
@@ -312,75 +248,154 @@ void HandleExtendedInventory(World* world) {
     }
 }
 
-void HandleBlockInteraction(World* world, float deltaTime) {
-    Player* player = &world->player;
-    float currentTime = GetTime();
+// Walks the grid cells the ray from the eye to the cursor crosses, in
+// order, so a block behind a wall can no longer be reached through it
+void UpdateBlockTarget(World* world, Player* player, const InputFrame* input) {
+    BlockTarget* target = &player->target;
+    Vector2 cursor = GetScreenToWorld2D(input->mouse, GetPlayerCamera(player));
+    *target = (BlockTarget){ 0 };
+    target->cursor = cursor;
     
-    Vector2 mousePos = GetScreenToWorld2D(GetMousePosition(), world->camera);
-    int blockX = (int)(mousePos.x / BLOCK_SIZE);
-    int blockY = (int)(mousePos.y / BLOCK_SIZE);
+    float eyeX = player->x + 8;
+    float eyeY = player->y + 16;
+    float rayX = cursor.x - eyeX;
+    float rayY = cursor.y - eyeY;
+    float length = sqrtf(rayX * rayX + rayY * rayY);
+    float limit = length < MAX_REACH_DISTANCE ? length : MAX_REACH_DISTANCE;
+    if (length > 0) {
+        rayX /= length;
+        rayY /= length;
+    }
+    
+    int cursorX = (int)floorf(cursor.x / BLOCK_SIZE);
+    int cursorY = (int)floorf(cursor.y / BLOCK_SIZE);
+    int cellX = (int)floorf(eyeX / BLOCK_SIZE);
+    int cellY = (int)floorf(eyeY / BLOCK_SIZE);
+    int stepX = rayX > 0 ? 1 : -1;
+    int stepY = rayY > 0 ? 1 : -1;
+    // Distance along the ray to the next vertical and horizontal grid
+    // line, and between successive ones
+    float nextX = rayX != 0 ? ((cellX + (stepX > 0)) * BLOCK_SIZE - eyeX) / rayX : INFINITY;
+    float nextY = rayY != 0 ? ((cellY + (stepY > 0)) * BLOCK_SIZE - eyeY) / rayY : INFINITY;
+    float deltaX = rayX != 0 ? BLOCK_SIZE / fabsf(rayX) : INFINITY;
+    float deltaY = rayY != 0 ? BLOCK_SIZE / fabsf(rayY) : INFINITY;
+    int faceX = 0;
+    int faceY = 0;
     
-    if (blockX >= 0 && blockX < WORLD_WIDTH && blockY >= 0 && blockY < WORLD_HEIGHT) {
-        float distX = mousePos.x - (player->x + 8);
-        float distY = mousePos.y - (player->y + 16);
-        float distance = sqrt(distX * distX + distY * distY);
+    for (;;) {
+        if (cellX < 0 || cellX >= WORLD_WIDTH || cellY < 0 || cellY >= WORLD_HEIGHT) return;
         
-        if (distance < MAX_REACH_DISTANCE) {
-            if (IsMouseButtonDown(MOUSE_LEFT_BUTTON)) {
-                if (world->blocks[blockY][blockX] != BLOCK_AIR) {
-                    ToolType currentTool = player->inventory[player->selectedSlot].tool;
-                    float breakTime = GetBreakTime(world->blocks[blockY][blockX], currentTool);
-                    
-                    if (!player->isBreaking || player->breakingBlockX != blockX || player->breakingBlockY != blockY) {
-                        player->isBreaking = true;
-                        player->breakStartTime = currentTime;
-                        player->breakProgress = 0;
-                        player->breakingBlockX = blockX;
-                        player->breakingBlockY = blockY;
-                    }
-                    
-                    player->breakProgress = (currentTime - player->breakStartTime) / breakTime;
-                    
-                    if (player->breakProgress >= 1.0f) {
-                        AddToInventory(player, world->blocks[blockY][blockX]);
-                        world->blocks[blockY][blockX] = BLOCK_AIR;
-                        
-                        if (currentTool != TOOL_NONE) {
-                            player->inventory[player->selectedSlot].durability--;
-                            if (player->inventory[player->selectedSlot].durability <= 0) {
-                                player->inventory[player->selectedSlot].tool = TOOL_NONE;
-                                player->inventory[player->selectedSlot].count = 0;
-                                player->inventory[player->selectedSlot].type = BLOCK_AIR;
-                            }
-                        }
-                        
-                        player->isBreaking = false;
-                        player->breakProgress = 0;
-                    }
-                }
-            } else {
-                player->isBreaking = false;
+        if (TestBlockPlane(world, BLOCK_PLANE_SOLID, cellX, cellY)) {
+            target->valid = true;
+            target->hitSolid = true;
+            target->blockX = cellX;
+            target->blockY = cellY;
+            target->faceX = faceX;
+            target->faceY = faceY;
+            target->placeX = cellX + faceX;
+            target->placeY = cellY + faceY;
+            return;
+        }
+        
+        // The cursor's own cell, reached with nothing in the way
+        if (cellX == cursorX && cellY == cursorY) {
+            if (length >= MAX_REACH_DISTANCE) return;
+            target->valid = true;
+            target->blockX = cellX;
+            target->blockY = cellY;
+            target->placeX = cellX;
+            target->placeY = cellY;
+            return;
+        }
+        
+        float travelled;
+        if (nextX < nextY) {
+            travelled = nextX;
+            nextX += deltaX;
+            cellX += stepX;
+            faceX = -stepX;
+            faceY = 0;
+        } else {
+            travelled = nextY;
+            nextY += deltaY;
+            cellY += stepY;
+            faceX = 0;
+            faceY = -stepY;
+        }
+        if (travelled > limit) break;
+    }
+    
+    // Rounding can end the walk a hair short of the cursor's cell when the
+    // ray runs exactly through a grid corner
+    if (length < MAX_REACH_DISTANCE && cursorX >= 0 && cursorX < WORLD_WIDTH && cursorY >= 0 && cursorY < WORLD_HEIGHT &&
+        !TestBlockPlane(world, BLOCK_PLANE_SOLID, cursorX, cursorY)) {
+        target->valid = true;
+        target->blockX = cursorX;
+        target->blockY = cursorY;
+        target->placeX = cursorX;
+        target->placeY = cursorY;
+    }
+}
+
+// Acts on what UpdateBlockTarget found this frame: breaking the target
+// block, or placing into the cell in front of it
+void HandleBlockInteraction(World* world, Player* player, const InputFrame* input, float deltaTime) {
+    float currentTime = input->time;
+    const BlockTarget* target = &player->target;
+    
+    if (!target->valid) {
+        player->isBreaking = false;
+        player->breakProgress = 0;
+        return;
+    }
+    
+    int blockX = target->blockX;
+    int blockY = target->blockY;
+    if (InputDown(input, INPUT_PRIMARY)) {
+        if (world->blocks[blockY][blockX] != BLOCK_AIR) {
+            InventorySlot* heldSlot = &player->hotbar.slots[player->selectedSlot];
+            ToolType currentTool = heldSlot->tool;
+            float breakTime = GetBreakTime(world->blocks[blockY][blockX], currentTool);
+            
+            if (!player->isBreaking || player->breakingBlockX != blockX || player->breakingBlockY != blockY) {
+                player->isBreaking = true;
+                player->breakStartTime = currentTime;
                 player->breakProgress = 0;
+                player->breakingBlockX = blockX;
+                player->breakingBlockY = blockY;
             }
             
-            if (IsMouseButtonPressed(MOUSE_RIGHT_BUTTON)) {
-                if (world->blocks[blockY][blockX] == BLOCK_AIR) {
-                    InventorySlot* selectedSlot = &player->inventory[player->selectedSlot];
-                    if (selectedSlot->type != BLOCK_AIR && selectedSlot->tool == TOOL_NONE && selectedSlot->count > 0) {
-                        world->blocks[blockY][blockX] = selectedSlot->type;
-                        selectedSlot->count--;
-                        if (selectedSlot->count == 0) {
-                            selectedSlot->type = BLOCK_AIR;
-                        }
+            player->breakProgress = (currentTime - player->breakStartTime) / breakTime;
+            
+            if (player->breakProgress >= 1.0f) {
+                AddToInventory(player, world->blocks[blockY][blockX], 1);
+                EmitBlockParticles(world, blockX, blockY, world->blocks[blockY][blockX]);
+                SetBlock(world, blockX, blockY, BLOCK_AIR);
+                
+                if (currentTool != TOOL_NONE) {
+                    // Durability is not indexed, so it can change in place
+                    heldSlot->durability--;
+                    if (heldSlot->durability <= 0) {
+                        SetContainerSlot(&player->hotbar, player->selectedSlot, (InventorySlot){ BLOCK_AIR, TOOL_NONE, 0, 0 });
                     }
                 }
+                
+                player->isBreaking = false;
+                player->breakProgress = 0;
             }
-        } else {
-            player->isBreaking = false;
-            player->breakProgress = 0;
         }
     } else {
         player->isBreaking = false;
         player->breakProgress = 0;
     }
+    
+    int placeX = target->placeX;
+    int placeY = target->placeY;
+    if (InputPressed(input, INPUT_SECONDARY) && placeX >= 0 && placeX < WORLD_WIDTH && placeY >= 0 &&
+        placeY < WORLD_HEIGHT && world->blocks[placeY][placeX] == BLOCK_AIR) {
+        BlockType placed = player->hotbar.slots[player->selectedSlot].type;
+        if (placed != BLOCK_AIR && TakeFromContainerSlot(&player->hotbar, player->selectedSlot, 1) > 0) {
+            SetBlock(world, placeX, placeY, placed);
+        }
+    }
 }
\ No newline at end of file
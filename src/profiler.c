@@ -0,0 +1,159 @@
+#include "game.h"
+
+#if defined(ENABLE_PROFILER)
+
+#include "platform.h"
+#include <math.h>
+
+#define PROFILER_MAX_ZONES 64
+#define PROFILER_HISTORY 240
+#define PROFILER_MAX_DEPTH 16
+#define PROFILER_TRACE_PATH "profile_trace.json"
+
+typedef struct {
+    const char* name;
+    uint64_t start;
+    uint64_t end;
+    int depth;
+} ProfilerZone;
+
+typedef struct {
+    uint64_t start;
+    uint64_t end;
+    int zoneCount;
+    ProfilerZone zones[PROFILER_MAX_ZONES];
+} ProfilerFrame;
+
+// Ring of the most recent frames; the one at 'current' is being recorded
+static struct {
+    ProfilerFrame frames[PROFILER_HISTORY];
+    int current;
+    int completed;
+    int stack[PROFILER_MAX_DEPTH];
+    int depth;
+    bool recording;
+    bool overlayVisible;
+} profiler;
+
+void ProfilerBeginFrame(void) {
+    ProfilerFrame* frame = &profiler.frames[profiler.current];
+    frame->start = PlatformGetTicks();
+    frame->end = frame->start;
+    frame->zoneCount = 0;
+    profiler.depth = 0;
+    profiler.recording = true;
+}
+
+void ProfilerEndFrame(void) {
+    if (!profiler.recording) return;
+    
+    profiler.frames[profiler.current].end = PlatformGetTicks();
+    profiler.current = (profiler.current + 1) % PROFILER_HISTORY;
+    if (profiler.completed < PROFILER_HISTORY) profiler.completed++;
+    profiler.recording = false;
+}
+
+void ProfilerBeginZone(const char* name) {
+    if (!profiler.recording || profiler.depth >= PROFILER_MAX_DEPTH) {
+        profiler.depth++;
+        return;
+    }
+    
+    ProfilerFrame* frame = &profiler.frames[profiler.current];
+    int index = -1;
+    if (frame->zoneCount < PROFILER_MAX_ZONES) {
+        index = frame->zoneCount++;
+        frame->zones[index].name = name;
+        frame->zones[index].depth = profiler.depth;
+        frame->zones[index].start = PlatformGetTicks();
+        frame->zones[index].end = frame->zones[index].start;
+    }
+    profiler.stack[profiler.depth++] = index;
+}
+
+void ProfilerEndZone(void) {
+    if (profiler.depth == 0) return;
+    
+    profiler.depth--;
+    if (!profiler.recording || profiler.depth >= PROFILER_MAX_DEPTH) return;
+    
+    int index = profiler.stack[profiler.depth];
+    if (index >= 0) {
+        profiler.frames[profiler.current].zones[index].end = PlatformGetTicks();
+    }
+}
+
+static const ProfilerFrame* GetCompletedFrame(int age) {
+    int index = (profiler.current - 1 - age + PROFILER_HISTORY * 2) % PROFILER_HISTORY;
+    return &profiler.frames[index];
+}
+
+// Writes the stored frames as Chrome trace events (chrome://tracing, Perfetto)
+bool ProfilerExportTrace(const char* path) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) return false;
+    
+    uint64_t origin = GetCompletedFrame(profiler.completed - 1)->start;
+    bool first = true;
+    
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (int age = profiler.completed - 1; age >= 0; age--) {
+        const ProfilerFrame* frame = GetCompletedFrame(age);
+        
+        fprintf(file, "%s{\"name\":\"Frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",\n", (frame->start - origin) / 1000.0, (frame->end - frame->start) / 1000.0);
+        first = false;
+        
+        for (int i = 0; i < frame->zoneCount; i++) {
+            const ProfilerZone* zone = &frame->zones[i];
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                    zone->name, (zone->start - origin) / 1000.0, (zone->end - zone->start) / 1000.0);
+        }
+    }
+    fprintf(file, "\n],\"displayTimeUnit\":\"ms\"}\n");
+    
+    fclose(file);
+    return true;
+}
+
+// F3 toggles the overlay, F4 exports the recorded frames as a trace
+void ProfilerUpdateOverlay(void) {
+    if (IsKeyPressed(KEY_F3)) {
+        profiler.overlayVisible = !profiler.overlayVisible;
+    }
+    if (IsKeyPressed(KEY_F4) && profiler.completed > 0) {
+        ProfilerExportTrace(PROFILER_TRACE_PATH);
+    }
+    
+    if (!profiler.overlayVisible || profiler.completed == 0) return;
+    
+    int panelX = 10;
+    int panelY = 130;
+    int graphWidth = PROFILER_HISTORY;
+    int graphHeight = 60;
+    const ProfilerFrame* last = GetCompletedFrame(0);
+    
+    DrawRectangle(panelX - 5, panelY - 5, graphWidth + 10, 30 + last->zoneCount * 14 + graphHeight + 10, (Color){0, 0, 0, 170});
+    DrawText(TextFormat("Frame %.2f ms", (last->end - last->start) / 1000000.0), panelX, panelY, 14, WHITE);
+    
+    for (int i = 0; i < last->zoneCount; i++) {
+        const ProfilerZone* zone = &last->zones[i];
+        DrawText(TextFormat("%s %.3f ms", zone->name, (zone->end - zone->start) / 1000000.0),
+                 panelX + 10 + zone->depth * 12, panelY + 18 + i * 14, 12, LIGHTGRAY);
+    }
+    
+    // Frame-time graph, newest on the right, scaled so 33 ms fills it
+    int graphY = panelY + 25 + last->zoneCount * 14;
+    float budgetY = graphY + graphHeight - graphHeight * (16.67f / 33.3f);
+    DrawRectangleLines(panelX, graphY, graphWidth, graphHeight, GRAY);
+    for (int age = 0; age < profiler.completed; age++) {
+        const ProfilerFrame* frame = GetCompletedFrame(age);
+        float ms = (frame->end - frame->start) / 1000000.0f;
+        int barHeight = (int)(graphHeight * fminf(ms / 33.3f, 1.0f));
+        Color barColor = (ms > 16.67f) ? RED : GREEN;
+        DrawLine(panelX + graphWidth - 1 - age, graphY + graphHeight, panelX + graphWidth - 1 - age, graphY + graphHeight - barHeight, barColor);
+    }
+    DrawLine(panelX, (int)budgetY, panelX + graphWidth, (int)budgetY, YELLOW);
+}
+
+#endif
@@ -0,0 +1,418 @@
+#include "game.h"
+#include "platform.h"
+#include <string.h>
+
+#define SAVE_WORLD_MAGIC 0x44575856u
+#define SAVE_REGION_MAGIC 0x47525856u
+#define SAVE_VERSION 2
+#define SAVE_PATH_MAX 512
+#define SAVE_REGION_COUNT (WORLD_REGION_ROWS * WORLD_REGION_COLUMNS)
+#define SAVE_REGION_CELLS (REGION_SIZE * REGION_SIZE)
+#define SAVE_INVENTORY_SLOTS (INVENTORY_SIZE + EXTENDED_INVENTORY_SIZE)
+
+// Everything one save writes, copied out of the world on the main thread
+// so the save thread never looks at live state. Only regions edited
+// since the last save are included.
+typedef struct {
+    unsigned int seed;
+    int regionCount;
+    unsigned short regions[SAVE_REGION_COUNT];
+    unsigned char blocks[SAVE_REGION_COUNT][SAVE_REGION_CELLS];
+    float playerX, playerY, playerVelX, playerVelY;
+    int health;
+    int selectedSlot;
+    InventorySlot inventory[SAVE_INVENTORY_SLOTS];
+    int animalCount;
+    Animal animals[MAX_ANIMALS];
+} SaveJob;
+
+// The job belongs to the main thread until 'pending' is set and to the
+// save thread until it is cleared again
+static struct {
+    // Leaves room in a path for the file names below
+    char directory[SAVE_PATH_MAX - 32];
+    PlatformThread* thread;
+    PlatformMutex* mutex;
+    PlatformCondition* wake;
+    PlatformCondition* done;
+    bool running;
+    bool quit;
+    bool pending;
+    bool finished;
+    SaveJob job;
+    SaveResult result;
+    BlockCodec codec;
+} saver;
+
+// ApplySavedRegion runs on the main thread, apart from the saver
+static BlockCodec loadCodec;
+
+static void GetWorldPath(char* path, const char* directory) {
+    snprintf(path, SAVE_PATH_MAX, "%s/world.dat", directory);
+}
+
+// Written to a temporary file first and renamed over the old one, so a
+// crash mid-save leaves the previous save intact
+bool WriteFileAtomic(const char* path, const void* data, size_t size) {
+    char temporary[SAVE_PATH_MAX + 4];
+    snprintf(temporary, sizeof(temporary), "%s.tmp", path);
+    
+    FILE* file = fopen(temporary, "wb");
+    if (file == NULL) return false;
+    
+    bool ok = fwrite(data, 1, size, file) == size && PlatformSyncFile(file);
+    ok = fclose(file) == 0 && ok;
+    return ok && PlatformReplaceFile(temporary, path);
+}
+
+static bool WriteRegion(const SaveJob* job, int index, size_t* bytesWritten) {
+    int region = job->regions[index];
+    NetWriter writer = { .size = 0 };
+    NetWriteU32(&writer, SAVE_REGION_MAGIC);
+    NetWriteU16(&writer, SAVE_VERSION);
+    int sizePosition = writer.size;
+    NetWriteU16(&writer, 0);
+    int encodedSize = EncodeBlocks(&saver.codec, job->blocks[index], SAVE_REGION_CELLS, writer.data + writer.size,
+                                   NET_MAX_PACKET - writer.size);
+    if (encodedSize < 0) return false;
+    writer.data[sizePosition] = (unsigned char)encodedSize;
+    writer.data[sizePosition + 1] = (unsigned char)(encodedSize >> 8);
+    writer.size += encodedSize;
+    
+    char path[SAVE_PATH_MAX];
+    GetSavedRegionPath(path, sizeof(path), saver.directory, region % WORLD_REGION_COLUMNS, region / WORLD_REGION_COLUMNS);
+    if (!WriteFileAtomic(path, writer.data, writer.size)) return false;
+    *bytesWritten += writer.size;
+    return true;
+}
+
+static bool WriteWorld(const SaveJob* job, size_t* bytesWritten) {
+    NetWriter writer = { .size = 0 };
+    NetWriteU32(&writer, SAVE_WORLD_MAGIC);
+    NetWriteU16(&writer, SAVE_VERSION);
+    NetWriteU32(&writer, job->seed);
+    
+    NetWriteFloat(&writer, job->playerX);
+    NetWriteFloat(&writer, job->playerY);
+    NetWriteFloat(&writer, job->playerVelX);
+    NetWriteFloat(&writer, job->playerVelY);
+    NetWriteU16(&writer, job->health);
+    NetWriteU8(&writer, job->selectedSlot);
+    for (int i = 0; i < SAVE_INVENTORY_SLOTS; i++) {
+        NetWriteU8(&writer, job->inventory[i].type);
+        NetWriteU8(&writer, job->inventory[i].tool);
+        NetWriteU8(&writer, job->inventory[i].count);
+        NetWriteU16(&writer, job->inventory[i].durability);
+    }
+    
+    NetWriteU8(&writer, job->animalCount);
+    for (int i = 0; i < job->animalCount; i++) {
+        const Animal* animal = &job->animals[i];
+        NetWriteU8(&writer, animal->type);
+        NetWriteFloat(&writer, animal->x);
+        NetWriteFloat(&writer, animal->y);
+        NetWriteU8(&writer, animal->direction > 0);
+    }
+    if (writer.overflow) return false;
+    
+    char path[SAVE_PATH_MAX];
+    GetWorldPath(path, saver.directory);
+    if (!WriteFileAtomic(path, writer.data, writer.size)) return false;
+    *bytesWritten += writer.size;
+    return true;
+}
+
+// Regions go first and the world file last, so a save interrupted part
+// way still loads: the regions it did write are simply newer
+static void WriteJob(const SaveJob* job, SaveResult* result) {
+    uint64_t start = PlatformGetTicks();
+    result->ok = true;
+    result->regionsWritten = 0;
+    result->bytesWritten = 0;
+    
+    for (int i = 0; i < job->regionCount && result->ok; i++) {
+        result->ok = WriteRegion(job, i, &result->bytesWritten);
+        if (result->ok) result->regionsWritten++;
+    }
+    result->ok = result->ok && WriteWorld(job, &result->bytesWritten);
+    result->writeSeconds = (PlatformGetTicks() - start) / 1000000000.0;
+}
+
+static void SaveThread(void* argument) {
+    (void)argument;
+    PlatformLockMutex(saver.mutex);
+    for (;;) {
+        while (!saver.pending && !saver.quit) {
+            PlatformWaitCondition(saver.wake, saver.mutex);
+        }
+        if (!saver.pending) break;
+        
+        PlatformUnlockMutex(saver.mutex);
+        WriteJob(&saver.job, &saver.result);
+        PlatformLockMutex(saver.mutex);
+        
+        saver.pending = false;
+        saver.finished = true;
+        PlatformSignalCondition(saver.done);
+    }
+    PlatformUnlockMutex(saver.mutex);
+}
+
+// Starts the save thread, writing into 'directory', which is created if
+// it does not exist yet
+bool SaveInit(const char* directory) {
+    if (saver.running) return true;
+    if (!PlatformMakeDirectory(directory)) return false;
+    
+    snprintf(saver.directory, sizeof(saver.directory), "%s", directory);
+    saver.quit = false;
+    saver.pending = false;
+    saver.finished = false;
+    saver.mutex = PlatformCreateMutex();
+    saver.wake = PlatformCreateCondition();
+    saver.done = PlatformCreateCondition();
+    if (saver.mutex != NULL && saver.wake != NULL && saver.done != NULL) {
+        saver.thread = PlatformCreateThread(SaveThread, NULL);
+    }
+    if (saver.thread == NULL) {
+        PlatformDestroyCondition(saver.done);
+        PlatformDestroyCondition(saver.wake);
+        PlatformDestroyMutex(saver.mutex);
+        return false;
+    }
+    saver.running = true;
+    return true;
+}
+
+static void CopyWorldToJob(World* world, SaveJob* job) {
+    job->seed = world->seed;
+    job->regionCount = 0;
+    for (int regionY = 0; regionY < WORLD_REGION_ROWS; regionY++) {
+        for (int regionX = 0; regionX < WORLD_REGION_COLUMNS; regionX++) {
+            // A region whose file has not been applied yet holds generated
+            // terrain, which must not go over the edits on disk
+            if (!world->unsavedRegions[regionY][regionX] || world->unloadedRegions[regionY][regionX]) continue;
+            world->unsavedRegions[regionY][regionX] = false;
+            
+            // Cells past the edge of the world are stored as air
+            int index = job->regionCount++;
+            job->regions[index] = (unsigned short)(regionY * WORLD_REGION_COLUMNS + regionX);
+            memset(job->blocks[index], BLOCK_AIR, SAVE_REGION_CELLS);
+            for (int y = 0; y < REGION_SIZE && regionY * REGION_SIZE + y < WORLD_HEIGHT; y++) {
+                const BlockType* row = &world->blocks[regionY * REGION_SIZE + y][regionX * REGION_SIZE];
+                for (int x = 0; x < REGION_SIZE && regionX * REGION_SIZE + x < WORLD_WIDTH; x++) {
+                    job->blocks[index][y * REGION_SIZE + x] = (unsigned char)row[x];
+                }
+            }
+        }
+    }
+    
+    Player* player = &world->player;
+    job->playerX = player->x;
+    job->playerY = player->y;
+    job->playerVelX = player->velX;
+    job->playerVelY = player->velY;
+    job->health = player->health;
+    job->selectedSlot = player->selectedSlot;
+    memcpy(job->inventory, player->hotbar.slots, sizeof(InventorySlot) * INVENTORY_SIZE);
+    memcpy(job->inventory + INVENTORY_SIZE, player->backpack.slots, sizeof(InventorySlot) * EXTENDED_INVENTORY_SIZE);
+    
+    job->animalCount = 0;
+    for (int i = 0; i < MAX_ANIMALS; i++) {
+        if (world->animals[i].alive) job->animals[job->animalCount++] = world->animals[i];
+    }
+}
+
+// Hands a copy of what changed to the save thread and returns at once.
+// False while the previous save is still being written or its result has
+// not been collected; the world keeps its unsaved marks until a later try.
+bool RequestSave(World* world) {
+    if (!saver.running) return false;
+    
+    PlatformLockMutex(saver.mutex);
+    bool busy = saver.pending || saver.finished;
+    PlatformUnlockMutex(saver.mutex);
+    if (busy) return false;
+    
+    uint64_t start = PlatformGetTicks();
+    CopyWorldToJob(world, &saver.job);
+    saver.result.copySeconds = (PlatformGetTicks() - start) / 1000000000.0;
+    
+    PlatformLockMutex(saver.mutex);
+    saver.pending = true;
+    PlatformSignalCondition(saver.wake);
+    PlatformUnlockMutex(saver.mutex);
+    return true;
+}
+
+// True once per finished save. A failed save marks its regions unsaved
+// again so the next one retries them.
+bool PollSaveResult(World* world, SaveResult* result) {
+    if (!saver.running) return false;
+    
+    PlatformLockMutex(saver.mutex);
+    bool finished = saver.finished;
+    saver.finished = false;
+    PlatformUnlockMutex(saver.mutex);
+    if (!finished) return false;
+    
+    *result = saver.result;
+    if (!result->ok) {
+        for (int i = result->regionsWritten; i < saver.job.regionCount; i++) {
+            int region = saver.job.regions[i];
+            world->unsavedRegions[region / WORLD_REGION_COLUMNS][region % WORLD_REGION_COLUMNS] = true;
+        }
+    }
+    return true;
+}
+
+void WaitForSave(void) {
+    if (!saver.running) return;
+    
+    PlatformLockMutex(saver.mutex);
+    while (saver.pending) {
+        PlatformWaitCondition(saver.done, saver.mutex);
+    }
+    PlatformUnlockMutex(saver.mutex);
+}
+
+// Lets a save in progress finish, then stops the thread
+void SaveShutdown(void) {
+    if (!saver.running) return;
+    
+    PlatformLockMutex(saver.mutex);
+    saver.quit = true;
+    PlatformSignalCondition(saver.wake);
+    PlatformUnlockMutex(saver.mutex);
+    
+    PlatformJoinThread(saver.thread);
+    PlatformDestroyCondition(saver.done);
+    PlatformDestroyCondition(saver.wake);
+    PlatformDestroyMutex(saver.mutex);
+    saver.thread = NULL;
+    saver.running = false;
+}
+
+// Whole file into 'buffer'; -1 if it is missing or does not fit
+static int ReadWholeFile(const char* path, unsigned char* buffer, int capacity) {
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) return -1;
+    
+    int size = (int)fread(buffer, 1, capacity, file);
+    bool truncated = size == capacity && fgetc(file) != EOF;
+    fclose(file);
+    return truncated ? -1 : size;
+}
+
+void GetSavedRegionPath(char* path, int capacity, const char* directory, int regionX, int regionY) {
+    snprintf(path, capacity, "%s/region_%d_%d.dat", directory, regionX, regionY);
+}
+
+// Lays one region file's contents over the world. Cells that differ from
+// what the seed generates go through SetBlock, so they count as edits for
+// replication like any other; the region itself is already on disk.
+bool ApplySavedRegion(World* world, int regionX, int regionY, const void* data, int size) {
+    NetReader reader;
+    NetReaderInit(&reader, data, size);
+    unsigned int magic = NetReadU32(&reader);
+    unsigned int version = NetReadU16(&reader);
+    int encodedSize = NetReadU16(&reader);
+    unsigned char blocks[SAVE_REGION_CELLS];
+    if (reader.error || magic != SAVE_REGION_MAGIC || version != SAVE_VERSION) return false;
+    if (encodedSize > size - reader.position) return false;
+    if (!DecodeBlocks(&loadCodec, reader.data + reader.position, encodedSize, blocks, SAVE_REGION_CELLS)) return false;
+    
+    bool wasUnsaved = world->unsavedRegions[regionY][regionX];
+    for (int y = 0; y < REGION_SIZE && regionY * REGION_SIZE + y < WORLD_HEIGHT; y++) {
+        for (int x = 0; x < REGION_SIZE && regionX * REGION_SIZE + x < WORLD_WIDTH; x++) {
+            int worldX = regionX * REGION_SIZE + x;
+            int worldY = regionY * REGION_SIZE + y;
+            BlockType block = (BlockType)blocks[y * REGION_SIZE + x];
+            if (block < BLOCK_COUNT && world->blocks[worldY][worldX] != block) SetBlock(world, worldX, worldY, block);
+        }
+    }
+    world->unsavedRegions[regionY][regionX] = wasUnsaved;
+    return true;
+}
+
+// Called once a region's file has been applied, or could not be, after
+// which the region simulates and saves like any other. Grains held at its
+// edge while it was out get another look.
+void SetRegionLoaded(World* world, int regionX, int regionY) {
+    world->unloadedRegions[regionY][regionX] = false;
+    int x = regionX * REGION_SIZE;
+    int y = regionY * REGION_SIZE;
+    MarkGranularDirtyRect(world, x, y, x + REGION_SIZE - 1 < WORLD_WIDTH ? x + REGION_SIZE - 1 : WORLD_WIDTH - 1,
+                          y + REGION_SIZE - 1 < WORLD_HEIGHT ? y + REGION_SIZE - 1 : WORLD_HEIGHT - 1);
+}
+
+bool IsCellLoaded(const World* world, int x, int y) {
+    return !world->unloadedRegions[y / REGION_SIZE][x / REGION_SIZE];
+}
+
+// Regenerates the world from the saved seed and restores the player and
+// animals. Edited regions are streamed in afterwards (see stream.c), and
+// stay unloaded until then. False, leaving the world untouched, when
+// there is no usable save.
+bool LoadWorld(World* world, const char* directory) {
+    char path[SAVE_PATH_MAX];
+    GetWorldPath(path, directory);
+    unsigned char buffer[NET_MAX_PACKET];
+    int size = ReadWholeFile(path, buffer, sizeof(buffer));
+    if (size < 0) return false;
+    
+    NetReader reader;
+    NetReaderInit(&reader, buffer, size);
+    unsigned int magic = NetReadU32(&reader);
+    unsigned int version = NetReadU16(&reader);
+    unsigned int seed = NetReadU32(&reader);
+    if (reader.error || magic != SAVE_WORLD_MAGIC || version != SAVE_VERSION) return false;
+    
+    InitGame(world, seed);
+    for (int regionY = 0; regionY < WORLD_REGION_ROWS; regionY++) {
+        for (int regionX = 0; regionX < WORLD_REGION_COLUMNS; regionX++) {
+            GetSavedRegionPath(path, sizeof(path), directory, regionX, regionY);
+            FILE* file = fopen(path, "rb");
+            world->unloadedRegions[regionY][regionX] = file != NULL;
+            if (file != NULL) fclose(file);
+        }
+    }
+    
+    Player* player = &world->player;
+    player->x = NetReadFloat(&reader);
+    player->y = NetReadFloat(&reader);
+    player->velX = NetReadFloat(&reader);
+    player->velY = NetReadFloat(&reader);
+    player->health = NetReadU16(&reader);
+    player->selectedSlot = NetReadU8(&reader) % INVENTORY_SIZE;
+    for (int i = 0; i < SAVE_INVENTORY_SLOTS; i++) {
+        InventorySlot slot;
+        slot.type = (BlockType)NetReadU8(&reader);
+        slot.tool = (ToolType)NetReadU8(&reader);
+        slot.count = NetReadU8(&reader);
+        slot.durability = NetReadU16(&reader);
+        if (reader.error || slot.type >= BLOCK_COUNT || slot.tool >= TOOL_COUNT) break;
+        
+        if (i < INVENTORY_SIZE) {
+            SetContainerSlot(&player->hotbar, i, slot);
+        } else {
+            SetContainerSlot(&player->backpack, i - INVENTORY_SIZE, slot);
+        }
+    }
+    
+    for (int i = 0; i < MAX_ANIMALS; i++) {
+        if (world->animals[i].alive) DespawnAnimal(world, &world->animals[i]);
+    }
+    int animalCount = NetReadU8(&reader);
+    for (int i = 0; i < animalCount; i++) {
+        AnimalType type = (AnimalType)NetReadU8(&reader);
+        float x = NetReadFloat(&reader);
+        float y = NetReadFloat(&reader);
+        bool facingRight = NetReadU8(&reader) != 0;
+        if (reader.error || type >= ANIMAL_COUNT) break;
+        
+        Animal* animal = SpawnAnimal(world, type, x, y);
+        if (animal != NULL) animal->direction = facingRight ? 1.0f : -1.0f;
+    }
+    return true;
+}
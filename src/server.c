@@ -0,0 +1,688 @@
+#include "game.h"
+#include "platform.h"
+#include <string.h>
+
+#define SERVER_BLOCK_PACKETS 32
+#define SERVER_BLOCK_PACKETS_PER_TICK 4
+#define SERVER_MAX_BLOCKS_PER_PACKET 256
+// A region with this many cells owed goes out whole and compressed,
+// which for edited terrain is smaller than listing the cells
+#define SERVER_REGION_PACKET_CELLS 32
+#define SERVER_SNAPSHOT_INTERVAL 2
+#define SERVER_INVENTORY_SLOTS (INVENTORY_SIZE + EXTENDED_INVENTORY_SIZE)
+// Regions are taken on inside a client's view and let go only once they
+// are half a region further out, so walking along an edge does not thrash
+#define SERVER_VIEW_HYSTERESIS (REGION_SIZE / 2)
+// Seconds of input a client may bank while its packets are held up, so
+// the frames of a late burst still play out at full length
+#define SERVER_INPUT_SLACK 0.25
+
+// Region masks are runs of bits within one row word
+_Static_assert(64 % REGION_SIZE == 0, "REGION_SIZE must divide 64");
+
+_Static_assert(REGION_SIZE * REGION_SIZE <= SERVER_MAX_BLOCKS_PER_PACKET, "a region must fit one packet's cell list");
+
+// The cells one BLOCKS or REGION packet carried, kept until the client acknowledges
+// it. A lost packet is not resent as is: its cells are marked dirty again
+// so whatever they hold by then goes out.
+typedef struct {
+    bool pending;
+    unsigned short sequence;
+    double sentTime;
+    int count;
+    unsigned short cells[SERVER_MAX_BLOCKS_PER_PACKET];
+} SentBlockPacket;
+
+typedef struct {
+    bool connected;
+    unsigned int host;
+    unsigned short port;
+    NetChannel channel;
+    InputFrame input;
+    unsigned int lastInputSequence;
+    // Time the client's frames may still take, which grows with the server's
+    // own ticks and not with what the client reports
+    double inputBudget;
+    unsigned int blockSequence;
+    // Regions the client holds, as a per-row mask of their cells, and the
+    // cells within them it has not been sent yet
+    uint64_t heldCells[WORLD_REGION_ROWS][WORLD_ROW_WORDS];
+    uint64_t dirtyCells[WORLD_HEIGHT][WORLD_ROW_WORDS];
+    SentBlockPacket blockPackets[SERVER_BLOCK_PACKETS];
+    int nextBlockPacket;
+    // The inventory rides along in snapshots until one carrying its
+    // current contents has been acknowledged
+    InventorySlot ackedInventory[SERVER_INVENTORY_SLOTS];
+    InventorySlot sentInventory[SERVER_INVENTORY_SLOTS];
+    unsigned short inventorySequence;
+    bool inventoryPending;
+} ServerClient;
+
+static struct {
+    World* world;
+    intptr_t socket;
+    ServerClient clients[MAX_PLAYERS];
+    unsigned int tick;
+    ServerStats stats;
+    // What PrintServerStats last reported, to print the difference
+    ServerStats printedStats;
+    double printedTime;
+    uint64_t intervalMaxTickNanos;
+    BlockCodec codec;
+} server;
+
+static bool SendToClient(ServerClient* client, const NetWriter* writer) {
+    if (!NetSendPacket(NULL, server.socket, client->host, client->port, &client->channel, writer)) return false;
+    
+    server.stats.bytesSent += writer->size;
+    server.stats.packetsSent++;
+    return true;
+}
+
+static int FindClient(unsigned int host, unsigned short port) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ServerClient* client = &server.clients[i];
+        if (client->connected && client->host == host && client->port == port) return i;
+    }
+    return -1;
+}
+
+static void GetInventorySlots(const Player* player, InventorySlot* slots) {
+    memcpy(slots, player->hotbar.slots, sizeof(InventorySlot) * INVENTORY_SIZE);
+    memcpy(slots + INVENTORY_SIZE, player->backpack.slots, sizeof(InventorySlot) * EXTENDED_INVENTORY_SIZE);
+}
+
+// New players start fresh; the regions around them are handed over by
+// UpdateInterest on the next tick
+static int AddClient(unsigned int host, unsigned short port) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ServerClient* client = &server.clients[i];
+        if (client->connected) continue;
+        
+        memset(client, 0, sizeof(*client));
+        client->connected = true;
+        client->host = host;
+        client->port = port;
+        NetInitChannel(&client->channel);
+        
+        InitPlayer(&server.world->players[i]);
+        server.world->playerActive[i] = true;
+        
+        printf("Client %d connected from %u.%u.%u.%u:%u\n", i, host >> 24, (host >> 16) & 0xFF,
+               (host >> 8) & 0xFF, host & 0xFF, port);
+        return i;
+    }
+    return -1;
+}
+
+static void RemoveClient(int id) {
+    server.clients[id].connected = false;
+    server.world->playerActive[id] = false;
+    printf("Client %d disconnected\n", id);
+}
+
+static void SendAccept(int id) {
+    ServerClient* client = &server.clients[id];
+    NetWriter writer;
+    NetBeginPacket(&writer, &client->channel, NET_MESSAGE_ACCEPT);
+    NetWriteU8(&writer, id);
+    NetWriteU32(&writer, server.world->seed);
+    SendToClient(client, &writer);
+}
+
+static void SendReject(unsigned int host, unsigned short port) {
+    NetChannel channel;
+    NetInitChannel(&channel);
+    NetWriter writer;
+    NetBeginPacket(&writer, &channel, NET_MESSAGE_REJECT);
+    NetSendPacket(NULL, server.socket, host, port, &channel, &writer);
+}
+
+// Each INPUT packet repeats the newest few frames, so a lost packet costs
+// nothing as long as a later one arrives. Frames run in order, each with
+// the frame time the client measured, as far as the client's budget goes:
+// a client cannot move or mine faster by claiming longer or more frames.
+static void ReadClientInput(int id, NetReader* reader) {
+    ServerClient* client = &server.clients[id];
+    unsigned int newest = NetReadU32(reader);
+    int count = NetReadU8(reader);
+    if (count > NET_INPUT_REDUNDANCY) return;
+    
+    NetInput inputs[NET_INPUT_REDUNDANCY];
+    for (int i = 0; i < count; i++) {
+        inputs[i] = NetReadInput(reader);
+    }
+    if (reader->error) return;
+    
+    for (int i = 0; i < count; i++) {
+        unsigned int sequence = newest - (unsigned int)(count - 1 - i);
+        if (sequence <= client->lastInputSequence) continue;
+        
+        unsigned int budgetMicros = (unsigned int)(client->inputBudget * 1000000.0);
+        if (inputs[i].deltaMicros > budgetMicros) inputs[i].deltaMicros = (unsigned short)budgetMicros;
+        client->inputBudget -= inputs[i].deltaMicros / 1000000.0;
+        NetApplyInput(&client->input, &inputs[i]);
+        StepPlayer(server.world, &server.world->players[id], &client->input);
+        client->lastInputSequence = sequence;
+    }
+}
+
+static void ServerReceive(void) {
+    unsigned char buffer[NET_MAX_PACKET];
+    uint32_t host;
+    uint16_t port;
+    int size;
+    
+    while ((size = PlatformReceiveFrom(server.socket, &host, &port, buffer, sizeof(buffer))) > 0) {
+        server.stats.bytesReceived += size;
+        
+        int id = FindClient(host, port);
+        if (id < 0) {
+            if (NetPeekType(buffer, size) != NET_MESSAGE_CONNECT) continue;
+            id = AddClient(host, port);
+            if (id < 0) {
+                SendReject(host, port);
+                continue;
+            }
+        }
+        
+        NetReader reader;
+        NetMessageType type;
+        NetReaderInit(&reader, buffer, size);
+        if (!NetReadHeader(&reader, &server.clients[id].channel, &type)) continue;
+        
+        switch (type) {
+            // Repeated connects mean our accept was lost
+            case NET_MESSAGE_CONNECT: SendAccept(id); break;
+            case NET_MESSAGE_INPUT: ReadClientInput(id, &reader); break;
+            case NET_MESSAGE_DISCONNECT: RemoveClient(id); break;
+            default: break;
+        }
+    }
+}
+
+static uint64_t GetRegionMask(int regionX, int* word) {
+    int x = regionX * REGION_SIZE;
+    *word = x >> 6;
+    return (((uint64_t)1 << REGION_SIZE) - 1) << (x & 63);
+}
+
+static bool IsRegionHeld(const ServerClient* client, int regionX, int regionY) {
+    int word;
+    uint64_t mask = GetRegionMask(regionX, &word);
+    return (client->heldCells[regionY][word] & mask) != 0;
+}
+
+// Taking on a region owes the client every cell in it that differs from
+// generation, which it can reproduce from the seed. Letting go of one
+// drops whatever was still queued for it.
+static void SetRegionHeld(ServerClient* client, int regionX, int regionY, bool held) {
+    int word;
+    uint64_t mask = GetRegionMask(regionX, &word);
+    World* world = server.world;
+    
+    if (held) {
+        client->heldCells[regionY][word] |= mask;
+    } else {
+        client->heldCells[regionY][word] &= ~mask;
+    }
+    
+    int endY = (regionY + 1) * REGION_SIZE;
+    if (endY > WORLD_HEIGHT) endY = WORLD_HEIGHT;
+    for (int y = regionY * REGION_SIZE; y < endY; y++) {
+        if (held) {
+            client->dirtyCells[y][word] |= world->modifiedCells[y][word] & mask;
+        } else {
+            client->dirtyCells[y][word] &= ~mask;
+        }
+    }
+}
+
+typedef struct {
+    int minX, minY, maxX, maxY;
+} CellRect;
+
+static CellRect GetViewRect(const Player* player, int margin) {
+    int cellX = (int)(player->x + 8) / BLOCK_SIZE;
+    int cellY = (int)(player->y + 16) / BLOCK_SIZE;
+    return (CellRect){ cellX - NET_VIEW_CELLS_X - margin, cellY - NET_VIEW_CELLS_Y - margin,
+                       cellX + NET_VIEW_CELLS_X + margin, cellY + NET_VIEW_CELLS_Y + margin };
+}
+
+static bool RegionOverlaps(int regionX, int regionY, CellRect rect) {
+    return regionX * REGION_SIZE <= rect.maxX && (regionX + 1) * REGION_SIZE > rect.minX &&
+           regionY * REGION_SIZE <= rect.maxY && (regionY + 1) * REGION_SIZE > rect.minY;
+}
+
+static bool IsInView(CellRect view, float x, float y) {
+    int cellX = (int)x / BLOCK_SIZE;
+    int cellY = (int)y / BLOCK_SIZE;
+    return cellX >= view.minX && cellX <= view.maxX && cellY >= view.minY && cellY <= view.maxY;
+}
+
+static void UpdateInterest(int id) {
+    ServerClient* client = &server.clients[id];
+    const Player* player = &server.world->players[id];
+    CellRect enter = GetViewRect(player, 0);
+    CellRect leave = GetViewRect(player, SERVER_VIEW_HYSTERESIS);
+    
+    for (int regionY = 0; regionY < WORLD_REGION_ROWS; regionY++) {
+        for (int regionX = 0; regionX < WORLD_REGION_COLUMNS; regionX++) {
+            bool held = IsRegionHeld(client, regionX, regionY);
+            if (!held && RegionOverlaps(regionX, regionY, enter)) {
+                SetRegionHeld(client, regionX, regionY, true);
+            } else if (held && !RegionOverlaps(regionX, regionY, leave)) {
+                SetRegionHeld(client, regionX, regionY, false);
+            }
+        }
+    }
+}
+
+// Cells of a lost batch go back in the queue, unless their region has
+// been let go in the meantime
+static void MarkCellsDirty(ServerClient* client, const SentBlockPacket* packet) {
+    for (int i = 0; i < packet->count; i++) {
+        int x = packet->cells[i] % WORLD_WIDTH;
+        int y = packet->cells[i] / WORLD_WIDTH;
+        uint64_t bit = (uint64_t)1 << (x & 63);
+        client->dirtyCells[y][x >> 6] |= bit & client->heldCells[y / REGION_SIZE][x >> 6];
+    }
+}
+
+static void RequeueLostBlocks(ServerClient* client, double now) {
+    double timeout = 0.1 + client->channel.roundTripTime * 2.0;
+    
+    for (int i = 0; i < SERVER_BLOCK_PACKETS; i++) {
+        SentBlockPacket* packet = &client->blockPackets[i];
+        if (!packet->pending) continue;
+        
+        if (NetIsAcked(&client->channel, packet->sequence)) {
+            packet->pending = false;
+        } else if (now - packet->sentTime > timeout) {
+            MarkCellsDirty(client, packet);
+            packet->pending = false;
+        }
+    }
+}
+
+// Takes up to one packet's worth of dirty cells, in row-major order
+static int CollectDirtyCells(ServerClient* client, unsigned short* cells) {
+    int count = 0;
+    for (int y = 0; y < WORLD_HEIGHT; y++) {
+        for (int w = 0; w < WORLD_ROW_WORDS; w++) {
+            while (client->dirtyCells[y][w] != 0) {
+                if (count == SERVER_MAX_BLOCKS_PER_PACKET) return count;
+                
+                uint64_t bits = client->dirtyCells[y][w];
+                int x = w * 64 + CountTrailingZeros64(bits);
+                client->dirtyCells[y][w] = bits & (bits - 1);
+                cells[count++] = (unsigned short)(y * WORLD_WIDTH + x);
+            }
+        }
+    }
+    return count;
+}
+
+// Every owed cell of the first held region owing at least
+// SERVER_REGION_PACKET_CELLS, in row-major order; none if there is no
+// such region
+static int CollectDirtyRegion(ServerClient* client, unsigned short* cells, int* regionX, int* regionY) {
+    for (int ry = 0; ry < WORLD_REGION_ROWS; ry++) {
+        int endY = (ry + 1) * REGION_SIZE;
+        if (endY > WORLD_HEIGHT) endY = WORLD_HEIGHT;
+        
+        for (int rx = 0; rx < WORLD_REGION_COLUMNS; rx++) {
+            int word;
+            uint64_t mask = GetRegionMask(rx, &word);
+            int owed = 0;
+            for (int y = ry * REGION_SIZE; y < endY; y++) {
+                owed += CountBits64(client->dirtyCells[y][word] & mask);
+            }
+            if (owed < SERVER_REGION_PACKET_CELLS) continue;
+            
+            int count = 0;
+            for (int y = ry * REGION_SIZE; y < endY; y++) {
+                uint64_t bits = client->dirtyCells[y][word] & mask;
+                client->dirtyCells[y][word] &= ~mask;
+                for (; bits != 0; bits &= bits - 1) {
+                    cells[count++] = (unsigned short)(y * WORLD_WIDTH + word * 64 + CountTrailingZeros64(bits));
+                }
+            }
+            *regionX = rx;
+            *regionY = ry;
+            return count;
+        }
+    }
+    return 0;
+}
+
+// REGION: a batch number, the region's coordinates, then all of its cells
+// through the block codec, those past the edge of the world as air
+static void WriteRegion(NetWriter* writer, ServerClient* client, int regionX, int regionY) {
+    unsigned char blocks[REGION_SIZE * REGION_SIZE];
+    memset(blocks, BLOCK_AIR, sizeof(blocks));
+    for (int y = 0; y < REGION_SIZE && regionY * REGION_SIZE + y < WORLD_HEIGHT; y++) {
+        const BlockType* row = &server.world->blocks[regionY * REGION_SIZE + y][regionX * REGION_SIZE];
+        for (int x = 0; x < REGION_SIZE && regionX * REGION_SIZE + x < WORLD_WIDTH; x++) {
+            blocks[y * REGION_SIZE + x] = (unsigned char)row[x];
+        }
+    }
+    
+    NetWriteU32(writer, ++client->blockSequence);
+    NetWriteU8(writer, regionX);
+    NetWriteU8(writer, regionY);
+    int sizePosition = writer->size;
+    NetWriteU16(writer, 0);
+    int encodedSize = EncodeBlocks(&server.codec, blocks, sizeof(blocks), writer->data + writer->size,
+                                   NET_MAX_PACKET - writer->size);
+    if (encodedSize < 0 || writer->overflow) {
+        writer->overflow = true;
+        return;
+    }
+    writer->data[sizePosition] = (unsigned char)encodedSize;
+    writer->data[sizePosition + 1] = (unsigned char)(encodedSize >> 8);
+    writer->size += encodedSize;
+}
+
+// BLOCKS: a per-client batch number, then each cell as the varint gap from
+// the previous cell index followed by its block ID
+static void WriteBlocks(NetWriter* writer, ServerClient* client, const SentBlockPacket* packet) {
+    NetWriteU32(writer, ++client->blockSequence);
+    NetWriteVarUint(writer, packet->count);
+    
+    unsigned int previous = 0;
+    for (int i = 0; i < packet->count; i++) {
+        unsigned int cell = packet->cells[i];
+        NetWriteVarUint(writer, cell - previous);
+        NetWriteU8(writer, server.world->blocks[cell / WORLD_WIDTH][cell % WORLD_WIDTH]);
+        previous = cell;
+    }
+}
+
+// Regions owing many cells go first, one per packet, then the rest as
+// cell lists
+static void SendBlocks(ServerClient* client, double now) {
+    for (int p = 0; p < SERVER_BLOCK_PACKETS_PER_TICK; p++) {
+        SentBlockPacket* packet = &client->blockPackets[client->nextBlockPacket];
+        if (packet->pending) {
+            MarkCellsDirty(client, packet);
+            packet->pending = false;
+        }
+        
+        NetWriter writer;
+        int regionX, regionY;
+        packet->count = CollectDirtyRegion(client, packet->cells, &regionX, &regionY);
+        if (packet->count > 0) {
+            packet->sequence = NetBeginPacket(&writer, &client->channel, NET_MESSAGE_REGION);
+            WriteRegion(&writer, client, regionX, regionY);
+        } else {
+            packet->count = CollectDirtyCells(client, packet->cells);
+            if (packet->count == 0) return;
+            
+            packet->sequence = NetBeginPacket(&writer, &client->channel, NET_MESSAGE_BLOCKS);
+            WriteBlocks(&writer, client, packet);
+        }
+        
+        if (SendToClient(client, &writer)) server.stats.blockBytesSent += writer.size;
+        packet->pending = true;
+        packet->sentTime = now;
+        client->nextBlockPacket = (client->nextBlockPacket + 1) % SERVER_BLOCK_PACKETS;
+    }
+}
+
+// Quarter-pixel fixed point, enough for anything drawn but not simulated
+static unsigned int QuantizePosition(float value) {
+    float scaled = value * 4.0f + 0.5f;
+    if (scaled < 0) return 0;
+    if (scaled > 65535) return 65535;
+    return (unsigned int)scaled;
+}
+
+static void WriteOwnPlayer(NetWriter* writer, ServerClient* client, const Player* player, unsigned short sequence) {
+    NetWriteFloat(writer, player->x);
+    NetWriteFloat(writer, player->y);
+    NetWriteFloat(writer, player->velX);
+    NetWriteFloat(writer, player->velY);
+    NetWriteFloat(writer, player->lastJumpTime);
+    NetWriteU8(writer, player->onGround | player->inWater << 1 | player->inventoryOpen << 2 | player->craftingOpen << 3 |
+                       player->isDragging << 4 | player->dragFromExtended << 5 | player->isBreaking << 6);
+    NetWriteU8(writer, player->selectedSlot);
+    NetWriteU8(writer, player->draggedSlot + 1);
+    NetWriteU8(writer, player->health);
+    NetWriteU16(writer, player->breakingBlockX + 1);
+    NetWriteU16(writer, player->breakingBlockY + 1);
+    NetWriteU8(writer, (unsigned int)(player->breakProgress * 255.0f));
+    
+    if (client->inventoryPending && NetIsAcked(&client->channel, client->inventorySequence)) {
+        memcpy(client->ackedInventory, client->sentInventory, sizeof(client->ackedInventory));
+        client->inventoryPending = false;
+    }
+    
+    InventorySlot slots[SERVER_INVENTORY_SLOTS];
+    GetInventorySlots(player, slots);
+    bool changed = memcmp(slots, client->ackedInventory, sizeof(slots)) != 0;
+    NetWriteU8(writer, changed);
+    if (!changed) return;
+    
+    for (int i = 0; i < SERVER_INVENTORY_SLOTS; i++) {
+        NetWriteU8(writer, slots[i].type);
+        NetWriteU8(writer, slots[i].tool);
+        NetWriteU8(writer, slots[i].count);
+        NetWriteU16(writer, slots[i].durability);
+    }
+    // A resend supersedes the earlier copy, so only the newest is tracked
+    memcpy(client->sentInventory, slots, sizeof(slots));
+    client->inventorySequence = sequence;
+    client->inventoryPending = true;
+}
+
+// SNAPSHOT: the client's own player in full, then the other players and
+// animals within its view, quantized, and the blocks players broke there
+// since the last one. Counts are patched in once the lists are written.
+static void SendSnapshot(int id) {
+    ServerClient* client = &server.clients[id];
+    World* world = server.world;
+    CellRect view = GetViewRect(&world->players[id], 0);
+    NetWriter writer;
+    unsigned short sequence = NetBeginPacket(&writer, &client->channel, NET_MESSAGE_SNAPSHOT);
+    NetWriteU32(&writer, server.tick);
+    NetWriteU32(&writer, client->lastInputSequence);
+    WriteOwnPlayer(&writer, client, &world->players[id], sequence);
+    
+    int countPosition = writer.size;
+    int count = 0;
+    NetWriteU8(&writer, 0);
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (i == id || !world->playerActive[i]) continue;
+        if (!IsInView(view, world->players[i].x + 8, world->players[i].y + 16)) continue;
+        
+        NetWriteU8(&writer, i);
+        NetWriteU16(&writer, QuantizePosition(world->players[i].x));
+        NetWriteU16(&writer, QuantizePosition(world->players[i].y));
+        NetWriteU8(&writer, world->players[i].inWater);
+        count++;
+    }
+    if (!writer.overflow) writer.data[countPosition] = (unsigned char)count;
+    
+    countPosition = writer.size;
+    count = 0;
+    NetWriteU8(&writer, 0);
+    for (int i = 0; i < MAX_ANIMALS; i++) {
+        Animal* animal = &world->animals[i];
+        if (!animal->alive || !IsInView(view, animal->x, animal->y)) continue;
+        
+        NetWriteU8(&writer, i);
+        NetWriteU8(&writer, animal->type);
+        NetWriteU16(&writer, QuantizePosition(animal->x));
+        NetWriteU16(&writer, QuantizePosition(animal->y));
+        NetWriteU8(&writer, (animal->direction > 0) | animal->inWater << 1);
+        count++;
+    }
+    if (!writer.overflow) writer.data[countPosition] = (unsigned char)count;
+    
+    countPosition = writer.size;
+    count = 0;
+    NetWriteU8(&writer, 0);
+    for (int i = 0; i < world->particles->breakCount; i++) {
+        const BlockBreak* broken = &world->particles->breaks[i];
+        if (!IsInView(view, broken->x * BLOCK_SIZE, broken->y * BLOCK_SIZE)) continue;
+        
+        NetWriteU16(&writer, broken->x);
+        NetWriteU16(&writer, broken->y);
+        NetWriteU8(&writer, broken->block);
+        count++;
+    }
+    if (!writer.overflow) writer.data[countPosition] = (unsigned char)count;
+    
+    if (SendToClient(client, &writer)) server.stats.snapshotBytesSent += writer.size;
+}
+
+bool ServerStart(unsigned short port, unsigned int seed) {
+    memset(&server, 0, sizeof(server));
+    if (!PlatformInitNetwork()) return false;
+    
+    server.socket = PlatformOpenUdpSocket(port);
+    server.world = server.socket >= 0 ? CreateWorld() : NULL;
+    if (server.world == NULL) {
+        PlatformCloseSocket(server.socket);
+        PlatformShutdownNetwork();
+        return false;
+    }
+    
+    server.world->role = NET_ROLE_SERVER;
+    InitGame(server.world, seed);
+    server.tick = 1;
+    server.printedTime = NetGetTime();
+    return true;
+}
+
+void GetServerStats(ServerStats* stats) {
+    *stats = server.stats;
+    stats->clients = 0;
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        if (server.clients[i].connected) stats->clients++;
+    }
+}
+
+static void PrintServerStats(double now) {
+    ServerStats stats;
+    GetServerStats(&stats);
+    const ServerStats* last = &server.printedStats;
+    double elapsed = now - server.printedTime;
+    unsigned int ticks = stats.ticks - last->ticks;
+    
+    printf("[server] clients %d | tick avg %.3f ms, max %.3f ms | out %.1f KB/s, %.0f packets/s | in %.1f KB/s\n",
+           stats.clients, ticks > 0 ? (stats.tickNanos - last->tickNanos) / 1000000.0 / ticks : 0.0,
+           server.intervalMaxTickNanos / 1000000.0, (stats.bytesSent - last->bytesSent) / 1024.0 / elapsed,
+           (stats.packetsSent - last->packetsSent) / elapsed, (stats.bytesReceived - last->bytesReceived) / 1024.0 / elapsed);
+    fflush(stdout);
+    
+    server.printedStats = stats;
+    server.printedTime = now;
+    server.intervalMaxTickNanos = 0;
+}
+
+// One fixed step: take in input, simulate, then bring every client up to
+// date with the cells that changed and a snapshot every other tick
+void ServerTick(void) {
+    uint64_t tickStart = PlatformGetTicks();
+    World* world = server.world;
+    ArenaReset(&world->frameMemory);
+    
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ServerClient* client = &server.clients[i];
+        client->inputBudget += 1.0 / NET_TICK_RATE;
+        if (client->inputBudget > SERVER_INPUT_SLACK) client->inputBudget = SERVER_INPUT_SLACK;
+    }
+    ServerReceive();
+    UpdateAnimals(world, 1.0f / NET_TICK_RATE);
+    UpdateBlockTicks(world, 1.0f / NET_TICK_RATE);
+    UpdateGranular(world, 1.0f / NET_TICK_RATE);
+    
+    double now = NetGetTime();
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ServerClient* client = &server.clients[i];
+        if (!client->connected) continue;
+        
+        if (now - client->channel.lastReceiveTime > NET_TIMEOUT) {
+            RemoveClient(i);
+            continue;
+        }
+        UpdateInterest(i);
+        for (int y = 0; y < WORLD_HEIGHT; y++) {
+            for (int w = 0; w < WORLD_ROW_WORDS; w++) {
+                client->dirtyCells[y][w] |= world->changedCells[y][w] & client->heldCells[y / REGION_SIZE][w];
+            }
+        }
+    }
+    memset(world->changedCells, 0, sizeof(world->changedCells));
+    
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ServerClient* client = &server.clients[i];
+        if (!client->connected) continue;
+        
+        RequeueLostBlocks(client, now);
+        SendBlocks(client, now);
+        if (server.tick % SERVER_SNAPSHOT_INTERVAL == 0) SendSnapshot(i);
+    }
+    if (server.tick % SERVER_SNAPSHOT_INTERVAL == 0) world->particles->breakCount = 0;
+    server.tick++;
+    
+    uint64_t tickNanos = PlatformGetTicks() - tickStart;
+    server.stats.ticks++;
+    server.stats.tickNanos += tickNanos;
+    if (tickNanos > server.stats.maxTickNanos) server.stats.maxTickNanos = tickNanos;
+    if (tickNanos > server.intervalMaxTickNanos) server.intervalMaxTickNanos = tickNanos;
+}
+
+void ServerStop(void) {
+    for (int i = 0; i < MAX_PLAYERS; i++) {
+        ServerClient* client = &server.clients[i];
+        if (!client->connected) continue;
+        
+        NetWriter writer;
+        NetBeginPacket(&writer, &client->channel, NET_MESSAGE_DISCONNECT);
+        SendToClient(client, &writer);
+    }
+    
+    DestroyWorld(server.world);
+    PlatformCloseSocket(server.socket);
+    PlatformShutdownNetwork();
+    memset(&server, 0, sizeof(server));
+}
+
+// Headless main loop at NET_TICK_RATE, printing statistics once a second.
+// Runs until killed, or for 'duration' seconds when that is positive.
+int RunServer(unsigned short port, unsigned int seed, double duration) {
+    if (!ServerStart(port, seed)) {
+        printf("Could not start a server on port %u\n", port);
+        return 1;
+    }
+    printf("Server listening on port %u, seed %u\n", port, seed);
+    StartGranularWorkers(PlatformGetCpuCount() - 1);
+    
+    uint64_t tickLength = 1000000000ull / NET_TICK_RATE;
+    uint64_t nextTick = PlatformGetTicks();
+    double startTime = NetGetTime();
+    
+    while (duration <= 0 || NetGetTime() - startTime < duration) {
+        ServerTick();
+        
+        double now = NetGetTime();
+        if (now - server.printedTime >= 1.0) PrintServerStats(now);
+        
+        // Sleep off the rest of the tick; after a long one, start afresh
+        // rather than running a burst of ticks to catch up
+        nextTick += tickLength;
+        uint64_t ticks = PlatformGetTicks();
+        if (ticks < nextTick) {
+            PlatformSleep(nextTick - ticks);
+        } else {
+            nextTick = ticks;
+        }
+    }
+    
+    StopGranularWorkers();
+    ServerStop();
+    return 0;
+}
@@ -0,0 +1,101 @@
+#include "game.h"
+
+static void AddCell(CellSet* set, int cell) {
+    if (set->slot[cell] >= 0) return;
+    set->slot[cell] = set->count;
+    set->cells[set->count++] = cell;
+}
+
+// Swap-with-last removal keeps the set dense for uniform sampling
+static void RemoveCell(CellSet* set, int cell) {
+    int slot = set->slot[cell];
+    if (slot < 0) return;
+    int last = set->cells[--set->count];
+    set->cells[slot] = last;
+    set->slot[last] = slot;
+    set->slot[cell] = -1;
+}
+
+static void ClearCellSet(CellSet* set) {
+    set->count = 0;
+    for (int i = 0; i < WORLD_WIDTH * WORLD_HEIGHT; i++) {
+        set->slot[i] = -1;
+    }
+}
+
+// A column offers a land spawn on its topmost ground block, as long as
+// there is open air (not water) above it
+static void UpdateSurfaceColumn(World* world, int x) {
+    CellSet* set = &world->spawnSets[SPAWN_SURFACE];
+    int previous = world->surfaceRow[x];
+    
+    int row = 0;
+    while (row < WORLD_HEIGHT && TestBlockPlane(world, BLOCK_PLANE_REPLACEABLE, x, row)) {
+        row++;
+    }
+    world->surfaceRow[x] = row;
+    
+    if (previous > 0 && previous < WORLD_HEIGHT) {
+        RemoveCell(set, (previous - 1) * WORLD_WIDTH + x);
+    }
+    if (row > 0 && row < WORLD_HEIGHT && world->blocks[row - 1][x] == BLOCK_AIR) {
+        AddCell(set, (row - 1) * WORLD_WIDTH + x);
+    }
+}
+
+void RebuildSpawnSets(World* world) {
+    ClearCellSet(&world->spawnSets[SPAWN_WATER]);
+    ClearCellSet(&world->spawnSets[SPAWN_SURFACE]);
+    
+    // Straight from the liquid plane, a word at a time
+    for (int y = 0; y < WORLD_HEIGHT; y++) {
+        for (int word = 0; word < WORLD_ROW_WORDS; word++) {
+            for (uint64_t bits = world->blockPlanes[BLOCK_PLANE_LIQUID][y][word]; bits != 0; bits &= bits - 1) {
+                AddCell(&world->spawnSets[SPAWN_WATER], y * WORLD_WIDTH + word * 64 + CountTrailingZeros64(bits));
+            }
+        }
+    }
+    
+    for (int x = 0; x < WORLD_WIDTH; x++) {
+        world->surfaceRow[x] = 0;
+        UpdateSurfaceColumn(world, x);
+    }
+}
+
+void UpdateSpawnSets(World* world, int x, int y) {
+    if (TestBlockPlane(world, BLOCK_PLANE_LIQUID, x, y)) {
+        AddCell(&world->spawnSets[SPAWN_WATER], y * WORLD_WIDTH + x);
+    } else {
+        RemoveCell(&world->spawnSets[SPAWN_WATER], y * WORLD_WIDTH + x);
+    }
+    
+    UpdateSurfaceColumn(world, x);
+}
+
+// UpdateSpawnSets for a rectangle, looking at each column once
+void UpdateSpawnSetRect(World* world, int x1, int y1, int x2, int y2) {
+    CellSet* water = &world->spawnSets[SPAWN_WATER];
+    for (int y = y1; y <= y2; y++) {
+        for (int x = x1; x <= x2; x++) {
+            if (TestBlockPlane(world, BLOCK_PLANE_LIQUID, x, y)) {
+                AddCell(water, y * WORLD_WIDTH + x);
+            } else {
+                RemoveCell(water, y * WORLD_WIDTH + x);
+            }
+        }
+    }
+    
+    for (int x = x1; x <= x2; x++) {
+        UpdateSurfaceColumn(world, x);
+    }
+}
+
+bool PickSpawnCell(World* world, SpawnSetType type, int* x, int* y) {
+    CellSet* set = &world->spawnSets[type];
+    if (set->count == 0) return false;
+    
+    int cell = set->cells[WorldRandom(world, 0, set->count - 1)];
+    *x = cell % WORLD_WIDTH;
+    *y = cell / WORLD_WIDTH;
+    return true;
+}
@@ -0,0 +1,169 @@
+#include "game.h"
+#include "platform.h"
+#include <math.h>
+#include <string.h>
+
+#define STREAM_READER_THREADS 2
+#define STREAM_LOOKAHEAD 1.0f
+#define STREAM_VIEW_MARGIN 2
+
+typedef enum {
+    REGION_WAITING = 0,
+    REGION_QUEUED,
+    REGION_RESIDENT
+} RegionState;
+
+// Saved regions come off disk after LoadWorld. Each frame the regions the
+// camera covers must be resident; the planner queues reads for where the
+// camera will be, from the player's velocity, so those are usually
+// already in when they are needed.
+static struct {
+    bool active;
+    bool prefetch;
+    char directory[512];
+    PlatformFileReader* reader;
+    RegionState state[WORLD_REGION_ROWS][WORLD_REGION_COLUMNS];
+    // Set once a region has been needed, so each counts as one hit or miss
+    bool needed[WORLD_REGION_ROWS][WORLD_REGION_COLUMNS];
+    unsigned char buffers[WORLD_REGION_ROWS][WORLD_REGION_COLUMNS][SAVE_MAX_FILE_SIZE];
+    RegionStreamStats stats;
+} stream;
+
+typedef struct {
+    int minX, minY, maxX, maxY;
+} RegionRect;
+
+// Regions a screen centred on (x, y) touches, grown by 'margin' cells
+static RegionRect GetScreenRegions(float x, float y, int margin) {
+    int halfWidth = SCREEN_WIDTH / BLOCK_SIZE / 2 + margin;
+    int halfHeight = SCREEN_HEIGHT / BLOCK_SIZE / 2 + margin;
+    int cellX = (int)floorf(x / BLOCK_SIZE);
+    int cellY = (int)floorf(y / BLOCK_SIZE);
+    
+    RegionRect rect;
+    rect.minX = (cellX - halfWidth) / REGION_SIZE;
+    rect.minY = (cellY - halfHeight) / REGION_SIZE;
+    rect.maxX = (cellX + halfWidth) / REGION_SIZE;
+    rect.maxY = (cellY + halfHeight) / REGION_SIZE;
+    if (rect.minX < 0) rect.minX = 0;
+    if (rect.minY < 0) rect.minY = 0;
+    if (rect.maxX >= WORLD_REGION_COLUMNS) rect.maxX = WORLD_REGION_COLUMNS - 1;
+    if (rect.maxY >= WORLD_REGION_ROWS) rect.maxY = WORLD_REGION_ROWS - 1;
+    return rect;
+}
+
+static bool QueueRegion(int regionX, int regionY) {
+    char path[512];
+    GetSavedRegionPath(path, sizeof(path), stream.directory, regionX, regionY);
+    if (!PlatformQueueFileRead(stream.reader, path, stream.buffers[regionY][regionX], SAVE_MAX_FILE_SIZE,
+                               regionY * WORLD_REGION_COLUMNS + regionX)) {
+        return false;
+    }
+    stream.state[regionY][regionX] = REGION_QUEUED;
+    stream.stats.regionsQueued++;
+    return true;
+}
+
+// A region with no file was never edited, and the generated terrain
+// already in the world is what it holds. One whose file is damaged keeps
+// the generated terrain as well, since nothing better is coming.
+static void ApplyCompletedReads(World* world) {
+    intptr_t tag;
+    int size;
+    while (PlatformPollFileRead(stream.reader, &tag, &size)) {
+        int regionX = (int)tag % WORLD_REGION_COLUMNS;
+        int regionY = (int)tag / WORLD_REGION_COLUMNS;
+        if (size >= 0 && ApplySavedRegion(world, regionX, regionY, stream.buffers[regionY][regionX], size)) {
+            stream.stats.regionsLoaded++;
+        }
+        stream.state[regionY][regionX] = REGION_RESIDENT;
+        SetRegionLoaded(world, regionX, regionY);
+    }
+}
+
+// Starts streaming saved regions from 'directory' into a world LoadWorld
+// has just set up. With 'prefetch' off, regions are read only once they
+// are on screen, which is what the counters are measured against.
+bool StartRegionStreaming(const char* directory, bool prefetch) {
+    stream.reader = PlatformCreateFileReader(STREAM_READER_THREADS);
+    if (stream.reader == NULL) return false;
+    
+    snprintf(stream.directory, sizeof(stream.directory), "%s", directory);
+    memset(stream.state, 0, sizeof(stream.state));
+    memset(stream.needed, 0, sizeof(stream.needed));
+    memset(&stream.stats, 0, sizeof(stream.stats));
+    stream.stats.backend = PlatformGetFileReaderBackend(stream.reader);
+    stream.prefetch = prefetch;
+    stream.active = true;
+    return true;
+}
+
+// Call once per frame before anything reads the blocks around the player.
+// Anything on screen that has not arrived yet is waited for, and counted
+// as a stall.
+void UpdateRegionStreaming(World* world, const Player* player) {
+    if (!stream.active) return;
+    
+    PROFILE_SCOPE("Region Streaming") {
+        ApplyCompletedReads(world);
+        
+        float centerX = player->x + 8;
+        float centerY = player->y + 16;
+        if (stream.prefetch) {
+            // Nearest first: what is on screen now, then along the path
+            float steps[] = { 0.0f, 0.25f, 0.5f, 1.0f };
+            for (int s = 0; s < (int)(sizeof(steps) / sizeof(steps[0])); s++) {
+                float ahead = steps[s] * STREAM_LOOKAHEAD;
+                RegionRect rect = GetScreenRegions(centerX + player->velX * ahead, centerY + player->velY * ahead,
+                                                   STREAM_VIEW_MARGIN);
+                for (int y = rect.minY; y <= rect.maxY; y++) {
+                    for (int x = rect.minX; x <= rect.maxX; x++) {
+                        if (stream.state[y][x] == REGION_WAITING) QueueRegion(x, y);
+                    }
+                }
+            }
+        }
+        
+        RegionRect view = GetScreenRegions(centerX, centerY, 0);
+        for (int y = view.minY; y <= view.maxY; y++) {
+            for (int x = view.minX; x <= view.maxX; x++) {
+                if (!stream.needed[y][x]) {
+                    stream.needed[y][x] = true;
+                    if (stream.state[y][x] == REGION_RESIDENT) {
+                        stream.stats.hits++;
+                    } else {
+                        stream.stats.misses++;
+                    }
+                }
+                if (stream.state[y][x] == REGION_RESIDENT) continue;
+                
+                uint64_t start = PlatformGetTicks();
+                while (stream.state[y][x] == REGION_WAITING && !QueueRegion(x, y)) {
+                    ApplyCompletedReads(world);
+                }
+                while (stream.state[y][x] != REGION_RESIDENT) {
+                    ApplyCompletedReads(world);
+                    if (stream.state[y][x] != REGION_RESIDENT) PlatformSleep(50000);
+                }
+                double stall = (PlatformGetTicks() - start) / 1000000000.0;
+                stream.stats.stallSeconds += stall;
+                if (stall > stream.stats.maxStallSeconds) stream.stats.maxStallSeconds = stall;
+            }
+        }
+    }
+}
+
+// Waits for reads in flight and drops whatever was never loaded. Those
+// regions are still on disk, and stay unloaded in the world so a save
+// leaves their files alone; only a later load would bring them back.
+void StopRegionStreaming(void) {
+    if (!stream.active) return;
+    
+    PlatformDestroyFileReader(stream.reader);
+    stream.reader = NULL;
+    stream.active = false;
+}
+
+void GetRegionStreamStats(RegionStreamStats* stats) {
+    *stats = stream.stats;
+}
@@ -0,0 +1,100 @@
+#include "game.h"
+#include "platform.h"
+#include <string.h>
+
+// Generated terrain kept on disk, one file per seed, so starting a game
+// maps a file instead of running GenerateWorld. A file holds a header and
+// then the cells, a byte each in rows, exactly as generation left them,
+// together with the random state it finished on so what follows (animal
+// placement, the simulation) goes the same way as after a fresh run.
+// Files are named after the generator version and world size as well as
+// the seed, so a change to either is simply a miss.
+
+#define TERRAIN_CACHE_MAGIC 0x4e525254u
+#define TERRAIN_CACHE_HEADER_SIZE 20
+#define TERRAIN_CACHE_CELLS (WORLD_WIDTH * WORLD_HEIGHT)
+#define TERRAIN_PATH_MAX 512
+
+static char cacheDirectory[TERRAIN_PATH_MAX - 64];
+
+// Where InitGame looks for cached terrain; NULL turns the cache off
+void SetTerrainCacheDirectory(const char* directory) {
+    snprintf(cacheDirectory, sizeof(cacheDirectory), "%s", directory != NULL ? directory : "");
+}
+
+void GetTerrainCachePath(char* path, int capacity, const char* directory, unsigned int seed) {
+    snprintf(path, capacity, "%s/terrain_v%d_%dx%d_%u.dat", directory, TERRAIN_GENERATOR_VERSION, WORLD_WIDTH,
+             WORLD_HEIGHT, seed);
+}
+
+// Stores what GenerateWorld just produced. Call it straight after, before
+// anything else draws on the world's random numbers.
+bool WriteTerrainCache(World* world, const char* directory) {
+    if (!PlatformMakeDirectory(directory)) return false;
+    
+    size_t scratchMark = ArenaMark(&world->frameMemory);
+    unsigned char* data = (unsigned char*)ArenaAlloc(&world->frameMemory, TERRAIN_CACHE_HEADER_SIZE + TERRAIN_CACHE_CELLS,
+                                                     MEMORY_GENERATION);
+    if (data == NULL) return false;
+    
+    NetWriter header = { .size = 0 };
+    NetWriteU32(&header, TERRAIN_CACHE_MAGIC);
+    NetWriteU32(&header, TERRAIN_GENERATOR_VERSION);
+    NetWriteU32(&header, world->seed);
+    NetWriteU16(&header, WORLD_WIDTH);
+    NetWriteU16(&header, WORLD_HEIGHT);
+    NetWriteU32(&header, world->rngState);
+    memcpy(data, header.data, TERRAIN_CACHE_HEADER_SIZE);
+    
+    unsigned char* cells = data + TERRAIN_CACHE_HEADER_SIZE;
+    for (int y = 0; y < WORLD_HEIGHT; y++) {
+        for (int x = 0; x < WORLD_WIDTH; x++) {
+            cells[y * WORLD_WIDTH + x] = (unsigned char)world->blocks[y][x];
+        }
+    }
+    
+    char path[TERRAIN_PATH_MAX];
+    GetTerrainCachePath(path, sizeof(path), directory, world->seed);
+    bool ok = WriteFileAtomic(path, data, TERRAIN_CACHE_HEADER_SIZE + TERRAIN_CACHE_CELLS);
+    ArenaRewind(&world->frameMemory, scratchMark);
+    return ok;
+}
+
+// Stands in for GenerateWorld when the cache has this seed. False, with
+// the blocks in an unknown state, when it does not or the file is bad.
+bool LoadTerrainCache(World* world) {
+    if (cacheDirectory[0] == '\0') return false;
+    
+    char path[TERRAIN_PATH_MAX];
+    GetTerrainCachePath(path, sizeof(path), cacheDirectory, world->seed);
+    size_t size;
+    const unsigned char* data = (const unsigned char*)PlatformMapFile(path, &size);
+    if (data == NULL) return false;
+    
+    NetReader header;
+    NetReaderInit(&header, data, size < TERRAIN_CACHE_HEADER_SIZE ? (int)size : TERRAIN_CACHE_HEADER_SIZE);
+    bool ok = NetReadU32(&header) == TERRAIN_CACHE_MAGIC;
+    ok = NetReadU32(&header) == TERRAIN_GENERATOR_VERSION && ok;
+    ok = NetReadU32(&header) == world->seed && ok;
+    ok = NetReadU16(&header) == WORLD_WIDTH && ok;
+    ok = NetReadU16(&header) == WORLD_HEIGHT && ok;
+    unsigned int rngState = NetReadU32(&header);
+    ok = ok && !header.error && size == TERRAIN_CACHE_HEADER_SIZE + TERRAIN_CACHE_CELLS;
+    
+    const unsigned char* cells = data + TERRAIN_CACHE_HEADER_SIZE;
+    for (int y = 0; y < WORLD_HEIGHT && ok; y++) {
+        const unsigned char* row = cells + y * WORLD_WIDTH;
+        for (int x = 0; x < WORLD_WIDTH; x++) {
+            if (row[x] >= BLOCK_COUNT) ok = false;
+            world->blocks[y][x] = (BlockType)row[x];
+        }
+    }
+    PlatformUnmapFile(data, size);
+    if (!ok) return false;
+    
+    world->rngState = rngState;
+    RebuildBlockPlanes(world);
+    ResetFlowFields(world);
+    RebuildSpawnSets(world);
+    return true;
+}
@@ -0,0 +1,373 @@
+#include "game.h"
+#include <string.h>
+
+// Leaves stay while wood is this close, or while they rest on ground
+// through no more than this many leaves
+#define LEAF_SUPPORT_RANGE 4
+
+#define WHEEL_SPAN(level) (1u << (BLOCK_WHEEL_BITS * ((level) + 1)))
+
+typedef void (*RandomTickHandler)(World* world, int x, int y);
+
+static void RandomTickGrass(World* world, int x, int y);
+static void RandomTickLeaves(World* world, int x, int y);
+
+// What a block does when a random tick lands on it. Blocks without an
+// entry are never counted, so regions of stone and air cost nothing.
+static const RandomTickHandler randomTickHandlers[BLOCK_COUNT] = {
+    [BLOCK_GRASS]  = RandomTickGrass,
+    [BLOCK_LEAVES] = RandomTickLeaves,
+};
+
+static bool HasRandomTick(BlockType block) {
+    return randomTickHandlers[block] != NULL;
+}
+
+void ResetBlockUpdates(World* world) {
+    BlockUpdateQueue* queue = world->blockUpdates;
+    queue->tick = 0;
+    queue->accumulator = 0;
+    queue->pending = 0;
+    queue->processedLastTick = 0;
+    queue->maxProcessedPerTick = 0;
+    queue->processedTotal = 0;
+    for (int i = 0; i < BLOCK_WHEEL_LEVELS * BLOCK_WHEEL_SLOTS; i++) {
+        queue->heads[i] = -1;
+    }
+    for (int i = 0; i < WORLD_WIDTH * WORLD_HEIGHT; i++) {
+        queue->bucket[i] = -1;
+    }
+    
+    queue->randomState = world->seed * 2654435761u | 1;
+    queue->randomRegionsLastTick = 0;
+    queue->randomTicksTotal = 0;
+    memset(queue->randomTickable, 0, sizeof(queue->randomTickable));
+    for (int y = 0; y < WORLD_HEIGHT; y++) {
+        for (int x = 0; x < WORLD_WIDTH; x++) {
+            if (HasRandomTick(world->blocks[y][x])) queue->randomTickable[y / REGION_SIZE][x / REGION_SIZE]++;
+        }
+    }
+}
+
+// The lowest level whose span covers the wait picks the slot
+static void LinkCell(BlockUpdateQueue* queue, int cell) {
+    unsigned int wait = queue->due[cell] - queue->tick;
+    int level = 0;
+    while (wait >= WHEEL_SPAN(level)) level++;
+    
+    int slot = (queue->due[cell] >> (BLOCK_WHEEL_BITS * level)) & (BLOCK_WHEEL_SLOTS - 1);
+    int bucket = level * BLOCK_WHEEL_SLOTS + slot;
+    queue->bucket[cell] = (short)bucket;
+    queue->previous[cell] = -1;
+    queue->next[cell] = queue->heads[bucket];
+    if (queue->heads[bucket] >= 0) queue->previous[queue->heads[bucket]] = cell;
+    queue->heads[bucket] = cell;
+}
+
+static void UnlinkCell(BlockUpdateQueue* queue, int cell) {
+    int bucket = queue->bucket[cell];
+    if (queue->previous[cell] >= 0) {
+        queue->next[queue->previous[cell]] = queue->next[cell];
+    } else {
+        queue->heads[bucket] = queue->next[cell];
+    }
+    if (queue->next[cell] >= 0) queue->previous[queue->next[cell]] = queue->previous[cell];
+    queue->bucket[cell] = -1;
+}
+
+// Queues the cell to be looked at 'delay' ticks from now, at least one and
+// less than the top level spans. A cell already queued for sooner keeps
+// that time.
+void ScheduleBlockUpdate(World* world, int x, int y, int delay) {
+    if (x < 0 || x >= WORLD_WIDTH || y < 0 || y >= WORLD_HEIGHT) return;
+    
+    BlockUpdateQueue* queue = world->blockUpdates;
+    int cell = y * WORLD_WIDTH + x;
+    if (delay < 1) delay = 1;
+    if ((unsigned int)delay >= WHEEL_SPAN(BLOCK_WHEEL_LEVELS - 1)) delay = WHEEL_SPAN(BLOCK_WHEEL_LEVELS - 1) - 1;
+    unsigned int due = queue->tick + (unsigned int)delay;
+    if (queue->bucket[cell] >= 0) {
+        if (queue->due[cell] - queue->tick <= due - queue->tick) return;
+        UnlinkCell(queue, cell);
+        queue->pending--;
+    }
+    queue->due[cell] = due;
+    LinkCell(queue, cell);
+    queue->pending++;
+}
+
+// Blocks that react to their surroundings are queued after their own
+// delay, with a random share on top so neighbours do not all change on
+// the same tick
+static void QueueReactingBlock(World* world, int x, int y) {
+    if (x < 0 || x >= WORLD_WIDTH || y < 0 || y >= WORLD_HEIGHT) return;
+    
+    int delay = GetBlockUpdateDelay(world->blocks[y][x]);
+    if (delay > 0) ScheduleBlockUpdate(world, x, y, delay + WorldRandom(world, 0, delay));
+}
+
+// Called by SetBlock. The cell and its eight neighbours are queued; wood
+// going away reaches every leaf it may have been holding up. Clients
+// leave all of this to the server.
+void NotifyBlockChanged(World* world, int x, int y, BlockType previous) {
+    if (world->role == NET_ROLE_CLIENT) return;
+    
+    unsigned short* tickable = &world->blockUpdates->randomTickable[y / REGION_SIZE][x / REGION_SIZE];
+    if (HasRandomTick(previous)) (*tickable)--;
+    if (HasRandomTick(world->blocks[y][x])) (*tickable)++;
+    
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            QueueReactingBlock(world, x + dx, y + dy);
+        }
+    }
+    
+    if (previous != BLOCK_WOOD || world->blocks[y][x] == BLOCK_WOOD) return;
+    for (int dy = -LEAF_SUPPORT_RANGE; dy <= LEAF_SUPPORT_RANGE; dy++) {
+        for (int dx = -LEAF_SUPPORT_RANGE; dx <= LEAF_SUPPORT_RANGE; dx++) {
+            int leafX = x + dx;
+            int leafY = y + dy;
+            if (leafX >= 0 && leafX < WORLD_WIDTH && leafY >= 0 && leafY < WORLD_HEIGHT &&
+                world->blocks[leafY][leafX] == BLOCK_LEAVES) {
+                QueueReactingBlock(world, leafX, leafY);
+            }
+        }
+    }
+}
+
+// NotifyBlockChanged for a whole rectangle at once. Every reacting block
+// in and around it is queued, reaching LEAF_SUPPORT_RANGE out for leaves
+// if wood was taken away, and the random tick counts of the regions it
+// covers are taken afresh.
+void NotifyBlockRectChanged(World* world, int x1, int y1, int x2, int y2, bool woodRemoved) {
+    if (world->role == NET_ROLE_CLIENT) return;
+    
+    BlockUpdateQueue* queue = world->blockUpdates;
+    bool tickable[BLOCK_COUNT];
+    int delays[BLOCK_COUNT];
+    for (int block = 0; block < BLOCK_COUNT; block++) {
+        tickable[block] = HasRandomTick((BlockType)block);
+        delays[block] = GetBlockUpdateDelay((BlockType)block);
+    }
+    
+    for (int regionY = y1 / REGION_SIZE; regionY <= y2 / REGION_SIZE; regionY++) {
+        for (int regionX = x1 / REGION_SIZE; regionX <= x2 / REGION_SIZE; regionX++) {
+            int count = 0;
+            for (int y = regionY * REGION_SIZE; y < (regionY + 1) * REGION_SIZE && y < WORLD_HEIGHT; y++) {
+                for (int x = regionX * REGION_SIZE; x < (regionX + 1) * REGION_SIZE && x < WORLD_WIDTH; x++) {
+                    count += tickable[world->blocks[y][x]];
+                }
+            }
+            queue->randomTickable[regionY][regionX] = (unsigned short)count;
+        }
+    }
+    
+    int reach = woodRemoved ? LEAF_SUPPORT_RANGE : 1;
+    int minX = x1 - reach > 0 ? x1 - reach : 0;
+    int minY = y1 - reach > 0 ? y1 - reach : 0;
+    int maxX = x2 + reach < WORLD_WIDTH ? x2 + reach : WORLD_WIDTH - 1;
+    int maxY = y2 + reach < WORLD_HEIGHT ? y2 + reach : WORLD_HEIGHT - 1;
+    for (int y = minY; y <= maxY; y++) {
+        for (int x = minX; x <= maxX; x++) {
+            BlockType block = world->blocks[y][x];
+            if (delays[block] == 0) continue;
+            
+            bool inner = x >= x1 - 1 && x <= x2 + 1 && y >= y1 - 1 && y <= y2 + 1;
+            if (inner || block == BLOCK_LEAVES) {
+                ScheduleBlockUpdate(world, x, y, delays[block] + WorldRandom(world, 0, delays[block]));
+            }
+        }
+    }
+}
+
+// Canopies hang on their trunk; the tufts GenerateWorld scatters over the
+// surface stand on the ground
+static bool IsLeafSupported(World* world, int x, int y) {
+    for (int dy = -LEAF_SUPPORT_RANGE; dy <= LEAF_SUPPORT_RANGE; dy++) {
+        for (int dx = -LEAF_SUPPORT_RANGE; dx <= LEAF_SUPPORT_RANGE; dx++) {
+            int checkX = x + dx;
+            int checkY = y + dy;
+            if (checkX >= 0 && checkX < WORLD_WIDTH && checkY >= 0 && checkY < WORLD_HEIGHT &&
+                world->blocks[checkY][checkX] == BLOCK_WOOD) {
+                return true;
+            }
+        }
+    }
+    
+    for (int below = y + 1; below < WORLD_HEIGHT && below <= y + LEAF_SUPPORT_RANGE; below++) {
+        BlockType block = world->blocks[below][x];
+        if (block != BLOCK_LEAVES) return IsBlockSolid(block);
+    }
+    return false;
+}
+
+static bool HasGrassNeighbour(World* world, int x, int y) {
+    for (int dy = -1; dy <= 1; dy++) {
+        for (int dx = -1; dx <= 1; dx++) {
+            int checkX = x + dx;
+            int checkY = y + dy;
+            if (checkX >= 0 && checkX < WORLD_WIDTH && checkY >= 0 && checkY < WORLD_HEIGHT &&
+                world->blocks[checkY][checkX] == BLOCK_GRASS) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+// Whether everything a tick at (x, y) may look at or change has had its
+// saved blocks applied. Until then those cells hold generated terrain,
+// and acting on it could undo what the player built there.
+static bool IsReachLoaded(World* world, int x, int y) {
+    int minX = x - LEAF_SUPPORT_RANGE > 0 ? x - LEAF_SUPPORT_RANGE : 0;
+    int minY = y - LEAF_SUPPORT_RANGE > 0 ? y - LEAF_SUPPORT_RANGE : 0;
+    int maxX = x + LEAF_SUPPORT_RANGE < WORLD_WIDTH ? x + LEAF_SUPPORT_RANGE : WORLD_WIDTH - 1;
+    int maxY = y + LEAF_SUPPORT_RANGE < WORLD_HEIGHT ? y + LEAF_SUPPORT_RANGE : WORLD_HEIGHT - 1;
+    for (int regionY = minY / REGION_SIZE; regionY <= maxY / REGION_SIZE; regionY++) {
+        for (int regionX = minX / REGION_SIZE; regionX <= maxX / REGION_SIZE; regionX++) {
+            if (world->unloadedRegions[regionY][regionX]) return false;
+        }
+    }
+    return true;
+}
+
+static void UpdateBlock(World* world, int x, int y) {
+    bool openAbove = y == 0 || world->blocks[y - 1][x] == BLOCK_AIR;
+    
+    switch (world->blocks[y][x]) {
+        case BLOCK_LEAVES:
+            if (!IsLeafSupported(world, x, y)) SetBlock(world, x, y, BLOCK_AIR);
+            break;
+        case BLOCK_GRASS:
+            if (y > 0 && TestBlockPlane(world, BLOCK_PLANE_OPAQUE, x, y - 1)) SetBlock(world, x, y, BLOCK_DIRT);
+            break;
+        case BLOCK_DIRT:
+            if (openAbove && HasGrassNeighbour(world, x, y)) SetBlock(world, x, y, BLOCK_GRASS);
+            break;
+        default:
+            break;
+    }
+}
+
+static unsigned int NextRandomTick(BlockUpdateQueue* queue) {
+    unsigned int x = queue->randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    queue->randomState = x;
+    return x;
+}
+
+// Spreads to one neighbour picked at random, if that is dirt open to the
+// sky, and dies off under cover
+static void RandomTickGrass(World* world, int x, int y) {
+    if (y > 0 && TestBlockPlane(world, BLOCK_PLANE_OPAQUE, x, y - 1)) {
+        SetBlock(world, x, y, BLOCK_DIRT);
+        return;
+    }
+    
+    unsigned int pick = NextRandomTick(world->blockUpdates) % 9;
+    int targetX = x + (int)(pick % 3) - 1;
+    int targetY = y + (int)(pick / 3) - 1;
+    if (targetX < 0 || targetX >= WORLD_WIDTH || targetY < 0 || targetY >= WORLD_HEIGHT) return;
+    if (world->blocks[targetY][targetX] == BLOCK_DIRT &&
+        (targetY == 0 || world->blocks[targetY - 1][targetX] == BLOCK_AIR)) {
+        SetBlock(world, targetX, targetY, BLOCK_GRASS);
+    }
+}
+
+static void RandomTickLeaves(World* world, int x, int y) {
+    if (!IsLeafSupported(world, x, y)) SetBlock(world, x, y, BLOCK_AIR);
+}
+
+// A region is 256 cells, so each random number picks four of them.
+// Regions still waiting for their saved blocks are passed over, as are
+// cells that could reach into one.
+static void RunRandomTicks(World* world) {
+    BlockUpdateQueue* queue = world->blockUpdates;
+    int regions = 0;
+    for (int regionY = 0; regionY < WORLD_REGION_ROWS; regionY++) {
+        for (int regionX = 0; regionX < WORLD_REGION_COLUMNS; regionX++) {
+            if (queue->randomTickable[regionY][regionX] == 0 || world->unloadedRegions[regionY][regionX]) continue;
+            
+            unsigned int bits = 0;
+            for (int i = 0; i < RANDOM_TICKS_PER_REGION; i++) {
+                if ((i & 3) == 0) bits = NextRandomTick(queue);
+                int x = regionX * REGION_SIZE + (int)(bits & (REGION_SIZE - 1));
+                int y = regionY * REGION_SIZE + (int)(bits >> 4 & (REGION_SIZE - 1));
+                bits >>= 8;
+                if (x >= WORLD_WIDTH || y >= WORLD_HEIGHT) continue;
+                
+                RandomTickHandler handler = randomTickHandlers[world->blocks[y][x]];
+                if (handler != NULL && IsReachLoaded(world, x, y)) handler(world, x, y);
+            }
+            regions++;
+        }
+    }
+    queue->randomRegionsLastTick = regions;
+    queue->randomTicksTotal += (uint64_t)regions * RANDOM_TICKS_PER_REGION;
+}
+
+// Moves a higher level's slot that has come due down to the levels below
+static void CascadeSlot(BlockUpdateQueue* queue, int level) {
+    int slot = (queue->tick >> (BLOCK_WHEEL_BITS * level)) & (BLOCK_WHEEL_SLOTS - 1);
+    int bucket = level * BLOCK_WHEEL_SLOTS + slot;
+    int cell = queue->heads[bucket];
+    queue->heads[bucket] = -1;
+    while (cell >= 0) {
+        int next = queue->next[cell];
+        LinkCell(queue, cell);
+        cell = next;
+    }
+}
+
+static void RunBlockTick(World* world) {
+    BlockUpdateQueue* queue = world->blockUpdates;
+    queue->tick++;
+    for (int level = BLOCK_WHEEL_LEVELS - 1; level > 0; level--) {
+        if ((queue->tick & (WHEEL_SPAN(level - 1) - 1)) == 0) CascadeSlot(queue, level);
+    }
+    
+    // The slot is taken whole first; anything the updates queue lands at
+    // least a tick later, in another slot. A cell near a region whose
+    // saved blocks are not in yet waits a second and tries again.
+    int cell = queue->heads[queue->tick & (BLOCK_WHEEL_SLOTS - 1)];
+    queue->heads[queue->tick & (BLOCK_WHEEL_SLOTS - 1)] = -1;
+    unsigned int processed = 0;
+    while (cell >= 0) {
+        int next = queue->next[cell];
+        int x = cell % WORLD_WIDTH;
+        int y = cell / WORLD_WIDTH;
+        queue->bucket[cell] = -1;
+        queue->pending--;
+        if (IsReachLoaded(world, x, y)) {
+            UpdateBlock(world, x, y);
+            processed++;
+        } else {
+            ScheduleBlockUpdate(world, x, y, BLOCK_TICK_RATE);
+        }
+        cell = next;
+    }
+    
+    queue->processedLastTick = processed;
+    queue->processedTotal += processed;
+    if (processed > queue->maxProcessedPerTick) queue->maxProcessedPerTick = processed;
+    
+    RunRandomTicks(world);
+}
+
+// Runs the block ticks that fall within 'deltaTime'. Each costs what is
+// due on it, however large the world. A long frame runs at most
+// BLOCK_MAX_TICKS_PER_FRAME and lets the rest go.
+void UpdateBlockTicks(World* world, float deltaTime) {
+    BlockUpdateQueue* queue = world->blockUpdates;
+    queue->accumulator += deltaTime;
+    
+    int ticks = 0;
+    while (queue->accumulator >= 1.0f / BLOCK_TICK_RATE && ticks < BLOCK_MAX_TICKS_PER_FRAME) {
+        queue->accumulator -= 1.0f / BLOCK_TICK_RATE;
+        RunBlockTick(world);
+        ticks++;
+    }
+    if (queue->accumulator >= 1.0f / BLOCK_TICK_RATE) queue->accumulator = 0;
+}
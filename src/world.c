@@ -1,7 +1,108 @@
 #include "game.h"
+#include "platform.h"
 #include <math.h>
 #include <stdlib.h>
-#include <time.h>
+#include <string.h>
+
+// The subsystem tables CreateWorld carves out of the world arena after
+// the World itself, listed once so that sizing the arena and filling it
+// cannot drift apart: World member, element type, count, memory tag
+#define WORLD_ARENA_TABLES(X) \
+    X(spawnSets, CellSet, SPAWN_SET_COUNT, MEMORY_SPAWNING) \
+    X(flowFields, FlowField, MAX_FLOW_FIELDS, MEMORY_PATHFINDING) \
+    X(blockUpdates, BlockUpdateQueue, 1, MEMORY_SIMULATION) \
+    X(granular, GranularState, 1, MEMORY_SIMULATION) \
+    X(editHistory, EditHistory, 1, MEMORY_EDITING) \
+    X(particles, ParticleSystem, 1, MEMORY_RENDER)
+
+#define WORLD_TABLE_SIZE(member, type, count, tag) + MEMORY_ALIGNED_SIZE(sizeof(type) * (count))
+#define WORLD_TABLE_ALLOC(member, type, count, tag) \
+    world->member = (type*)ArenaAlloc(&world->memory, sizeof(type) * (count), tag); \
+    ok = ok && world->member != NULL;
+
+void SetBlock(World* world, int x, int y, BlockType block) {
+    BlockType previous = world->blocks[y][x];
+    world->blocks[y][x] = block;
+    CommitBlockChange(world, x, y, previous);
+}
+
+// Everything that follows from a cell now holding a new block. For
+// writers that store into world->blocks themselves, such as the granular
+// workers, which cannot run any of this off the main thread.
+void CommitBlockChange(World* world, int x, int y, BlockType previous) {
+    uint64_t bit = (uint64_t)1 << (x & 63);
+    world->modifiedCells[y][x >> 6] |= bit;
+    world->changedCells[y][x >> 6] |= bit;
+    world->unsavedRegions[y / REGION_SIZE][x / REGION_SIZE] = true;
+    
+    UpdateBlockPlanes(world, x, y, world->blocks[y][x]);
+    InvalidateFlowFields(world, x, y, previous);
+    UpdateSpawnSets(world, x, y);
+    NotifyBlockChanged(world, x, y, previous);
+    MarkGranularDirty(world, x, y);
+}
+
+// CommitBlockChange for the cells set in 'changed' (rows of bits, like
+// the planes), all of which lie in the given rectangle. The tables are
+// brought up to date once for the whole rectangle rather than per cell.
+void CommitBlockRect(World* world, int x1, int y1, int x2, int y2, const uint64_t (*changed)[WORLD_ROW_WORDS],
+                     bool woodRemoved) {
+    for (int y = y1; y <= y2; y++) {
+        for (int word = x1 >> 6; word <= x2 >> 6; word++) {
+            uint64_t bits = changed[y][word];
+            world->modifiedCells[y][word] |= bits;
+            world->changedCells[y][word] |= bits;
+            while (bits != 0) {
+                int x = word * 64 + CountTrailingZeros64(bits);
+                world->unsavedRegions[y / REGION_SIZE][x / REGION_SIZE] = true;
+                // Skip the rest of this region's cells in the word
+                int regionEnd = (x / REGION_SIZE + 1) * REGION_SIZE - word * 64;
+                bits &= regionEnd >= 64 ? 0 : ~(uint64_t)0 << regionEnd;
+            }
+        }
+    }
+    
+    UpdateBlockPlaneRect(world, x1, y1, x2, y2);
+    InvalidateFlowFieldRect(world, x1, y1, x2, y2);
+    UpdateSpawnSetRect(world, x1, y1, x2, y2);
+    NotifyBlockRectChanged(world, x1, y1, x2, y2, woodRemoved);
+    MarkGranularDirtyRect(world, x1, y1, x2, y2);
+}
+
+// xorshift32 over a caller's state
+static int StreamRandom(unsigned int* state, int min, int max) {
+    if (min > max) {
+        int temp = min;
+        min = max;
+        max = temp;
+    }
+    
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    
+    return min + (int)(x % (unsigned int)(max - min + 1));
+}
+
+// The stream owned by the world, so a seed fully determines generation
+// and simulation
+int WorldRandom(World* world, int min, int max) {
+    return StreamRandom(&world->rngState, min, max);
+}
+
+// A stream of a column's own, so columns can be generated in any order
+// or at once. Neighbouring columns get unrelated starts.
+static unsigned int ColumnStream(unsigned int seed, int x) {
+    unsigned int state = seed * 2654435761u ^ (unsigned int)(x + 1) * 0x85EBCA6Bu;
+    state ^= state >> 16;
+    state *= 0x7FEB352Du;
+    state ^= state >> 15;
+    state *= 0x846CA68Bu;
+    state ^= state >> 16;
+    return state != 0 ? state : 1;
+}
 
 float SimpleNoise(int x, int y) {
     int n = x + y * 57;
@@ -36,7 +137,7 @@ int FindSurfaceHeight(World* world, int x) {
 }
 
 void GenerateTree(World* world, int x, int baseY) {
-    int treeHeight = GetRandomValue(5, 12);
+    int treeHeight = WorldRandom(world, 5, 12);
     
     for (int h = 0; h < treeHeight; h++) {
         int y = baseY - h;
@@ -54,7 +155,7 @@ void GenerateTree(World* world, int x, int baseY) {
             if (leafX >= 0 && leafX < WORLD_WIDTH && leafY >= 0 && leafY < WORLD_HEIGHT) {
                 float distance = sqrt(dx * dx + dy * dy);
                 if (distance <= 3.0f && world->blocks[leafY][leafX] == BLOCK_AIR) {
-                    if (GetRandomValue(0, 100) < 80) {
+                    if (WorldRandom(world, 0, 100) < 80) {
                         world->blocks[leafY][leafX] = BLOCK_LEAVES;
                     }
                 }
@@ -89,7 +190,7 @@ void GenerateSmallRiver(World* world, int startX, int endX, int* surfaceHeights)
     }
     
     int riverWidth = 1;
-    int riverDepth = GetRandomValue(2, 3);
+    int riverDepth = WorldRandom(world, 2, 3);
     
     for (int x = startX; x <= endX; x += 2) {
         int centerY = surfaceHeights[x];
@@ -109,35 +210,123 @@ void GenerateSmallRiver(World* world, int startX, int endX, int* surfaceHeights)
     }
 }
 
-void GenerateWorld(World* world) {
-    srand(time(NULL));
+// Ground, dirt and stone for column 'x' from the height noise, which
+// needs no random numbers
+static void GenerateColumn(World* world, int x) {
+    float heightNoise = PerlinNoise(x * 0.1f, 0) * 0.5f + 0.5f;
+    int surfaceHeight = (int)(heightNoise * 30) + 40;
+    world->surfaceHeights[x] = surfaceHeight;
     
-    int surfaceHeights[WORLD_WIDTH];
+    for (int y = 0; y < WORLD_HEIGHT; y++) {
+        if (y > surfaceHeight + 15) {
+            world->blocks[y][x] = BLOCK_STONE;
+        } else if (y > surfaceHeight + 5) {
+            world->blocks[y][x] = BLOCK_DIRT;
+        } else if (y > surfaceHeight) {
+            world->blocks[y][x] = BLOCK_DIRT;
+        } else if (y == surfaceHeight) {
+            world->blocks[y][x] = BLOCK_GRASS;
+        } else {
+            world->blocks[y][x] = BLOCK_AIR;
+        }
+    }
+}
+
+// Tufts on the surface and ore in the stone of column 'x', from the
+// column's own stream
+static void DecorateColumn(World* world, int x) {
+    unsigned int stream = ColumnStream(world->seed, x);
+    int surfaceY = world->surfaceHeights[x];
+    if (StreamRandom(&stream, 0, 100) < 15) {
+        if (surfaceY > 0 && world->blocks[surfaceY - 1][x] == BLOCK_AIR) {
+            int grassHeight = StreamRandom(&stream, 1, 3);
+            for (int h = 0; h < grassHeight; h++) {
+                int y = surfaceY - 1 - h;
+                if (y >= 0 && world->blocks[y][x] == BLOCK_AIR) {
+                    world->blocks[y][x] = BLOCK_LEAVES;
+                }
+            }
+        }
+    }
     
-    for (int x = 0; x < WORLD_WIDTH; x++) {
-        float heightNoise = PerlinNoise(x * 0.1f, 0) * 0.5f + 0.5f;
-        int surfaceHeight = (int)(heightNoise * 30) + 40;
-        surfaceHeights[x] = surfaceHeight;
-        
-        for (int y = 0; y < WORLD_HEIGHT; y++) {
-            if (y > surfaceHeight + 15) {
-                world->blocks[y][x] = BLOCK_STONE;
-            } else if (y > surfaceHeight + 5) {
-                world->blocks[y][x] = BLOCK_DIRT;
-            } else if (y > surfaceHeight) {
-                world->blocks[y][x] = BLOCK_DIRT;
-            } else if (y == surfaceHeight) {
-                world->blocks[y][x] = BLOCK_GRASS;
-            } else {
-                world->blocks[y][x] = BLOCK_AIR;
+    for (int y = 50; y < WORLD_HEIGHT; y++) {
+        if (world->blocks[y][x] == BLOCK_STONE) {
+            int oreChance = StreamRandom(&stream, 0, 100);
+            
+            if (y > 85 && oreChance < 8) {
+                world->blocks[y][x] = BLOCK_COAL_ORE;
+            } else if (y > 80 && oreChance < 4) {
+                world->blocks[y][x] = BLOCK_IRON_ORE;
+            } else if (y > 85 && oreChance < 2) {
+                world->blocks[y][x] = BLOCK_GOLD_ORE;
+            } else if (y > 90 && oreChance < 1) {
+                world->blocks[y][x] = BLOCK_DIAMOND_ORE;
+            } else if (y > 75 && y < 85 && oreChance < 1) {
+                world->blocks[y][x] = BLOCK_EMERALD_ORE;
             }
         }
     }
+}
+typedef struct {
+    World* world;
+    void (*column)(World* world, int x);
+    int startX;
+    int endX;
+} ColumnBand;
+
+static void RunColumnBand(void* argument) {
+    ColumnBand* band = (ColumnBand*)argument;
+    for (int x = band->startX; x < band->endX; x++) {
+        band->column(band->world, x);
+    }
+}
+
+// Splits the columns into one band per thread. A band whose thread cannot
+// be started is done here instead.
+static void RunColumnBands(World* world, void (*column)(World* world, int x), int threadCount) {
+    if (threadCount > MAX_GENERATION_THREADS) threadCount = MAX_GENERATION_THREADS;
+    if (threadCount < 1) threadCount = 1;
+    
+    ColumnBand bands[MAX_GENERATION_THREADS];
+    PlatformThread* threads[MAX_GENERATION_THREADS] = { 0 };
+    for (int i = 0; i < threadCount; i++) {
+        bands[i] = (ColumnBand){ world, column, WORLD_WIDTH * i / threadCount, WORLD_WIDTH * (i + 1) / threadCount };
+    }
+    for (int i = 1; i < threadCount; i++) {
+        threads[i] = PlatformCreateThread(RunColumnBand, &bands[i]);
+    }
+    RunColumnBand(&bands[0]);
+    for (int i = 1; i < threadCount; i++) {
+        if (threads[i] != NULL) {
+            PlatformJoinThread(threads[i]);
+        } else {
+            RunColumnBand(&bands[i]);
+        }
+    }
+}
+
+void GenerateWorld(World* world) {
+    GenerateWorldThreaded(world, 1);
+}
+
+// Cached terrain depends on this giving the same world for a seed every
+// time, whatever the thread count; change TERRAIN_GENERATOR_VERSION along
+// with what it produces. Columns are laid down and decorated in parallel
+// bands, each column drawing on its own stream; the features that cross
+// columns (caves, lakes, the river and trees) follow the world's stream
+// in between.
+void GenerateWorldThreaded(World* world, int threadCount) {
+    world->rngState = (world->seed * 2654435761u) ^ 0x9E3779B9u;
+    if (world->rngState == 0) world->rngState = 1;
+    
+    int* surfaceHeights = world->surfaceHeights;
+    
+    RunColumnBands(world, GenerateColumn, threadCount);
     
     for (int i = 0; i < 30; i++) {
-        int x = GetRandomValue(5, WORLD_WIDTH - 5);
-        int y = GetRandomValue(60, WORLD_HEIGHT - 5);
-        int caveSize = GetRandomValue(2, 4);
+        int x = WorldRandom(world, 5, WORLD_WIDTH - 5);
+        int y = WorldRandom(world, 60, WORLD_HEIGHT - 5);
+        int caveSize = WorldRandom(world, 2, 4);
         
         for (int dx = -caveSize; dx <= caveSize; dx++) {
             for (int dy = -caveSize; dy <= caveSize; dy++) {
@@ -151,21 +340,21 @@ void GenerateWorld(World* world) {
     }
     
     for (int i = 0; i < 4; i++) {
-        int x = GetRandomValue(40, WORLD_WIDTH - 40);
+        int x = WorldRandom(world, 40, WORLD_WIDTH - 40);
         int surfaceY = surfaceHeights[x];
-        int lakeRadius = GetRandomValue(3, 6);
+        int lakeRadius = WorldRandom(world, 3, 6);
         
         GenerateSmallLake(world, x, surfaceY, lakeRadius);
     }
     
     for (int i = 0; i < 1; i++) {
-        int startX = GetRandomValue(20, WORLD_WIDTH / 2 - 20);
-        int endX = GetRandomValue(WORLD_WIDTH / 2 + 20, WORLD_WIDTH - 20);
+        int startX = WorldRandom(world, 20, WORLD_WIDTH / 2 - 20);
+        int endX = WorldRandom(world, WORLD_WIDTH / 2 + 20, WORLD_WIDTH - 20);
         GenerateSmallRiver(world, startX, endX, surfaceHeights);
     }
     
     for (int attempt = 0; attempt < 40; attempt++) {
-        int x = GetRandomValue(10, WORLD_WIDTH - 10);
+        int x = WorldRandom(world, 10, WORLD_WIDTH - 10);
         int surfaceY = FindSurfaceHeight(world, x);
         
         if (surfaceY > 0 && surfaceY < 60 && 
@@ -193,38 +382,75 @@ void GenerateWorld(World* world) {
         }
     }
     
-    for (int x = 0; x < WORLD_WIDTH; x++) {
-        int surfaceY = surfaceHeights[x];
-        if (GetRandomValue(0, 100) < 15) {
-            if (surfaceY > 0 && world->blocks[surfaceY - 1][x] == BLOCK_AIR) {
-                int grassHeight = GetRandomValue(1, 3);
-                for (int h = 0; h < grassHeight; h++) {
-                    int y = surfaceY - 1 - h;
-                    if (y >= 0 && world->blocks[y][x] == BLOCK_AIR) {
-                        world->blocks[y][x] = BLOCK_LEAVES;
-                    }
-                }
-            }
-        }
-    }
+    RunColumnBands(world, DecorateColumn, threadCount);
     
-    for (int x = 0; x < WORLD_WIDTH; x++) {
-        for (int y = 50; y < WORLD_HEIGHT; y++) {
-            if (world->blocks[y][x] == BLOCK_STONE) {
-                int oreChance = GetRandomValue(0, 100);
-                
-                if (y > 85 && oreChance < 8) {
-                    world->blocks[y][x] = BLOCK_COAL_ORE;
-                } else if (y > 80 && oreChance < 4) {
-                    world->blocks[y][x] = BLOCK_IRON_ORE;
-                } else if (y > 85 && oreChance < 2) {
-                    world->blocks[y][x] = BLOCK_GOLD_ORE;
-                } else if (y > 90 && oreChance < 1) {
-                    world->blocks[y][x] = BLOCK_DIAMOND_ORE;
-                } else if (y > 75 && y < 85 && oreChance < 1) {
-                    world->blocks[y][x] = BLOCK_EMERALD_ORE;
-                }
-            }
-        }
+    RebuildBlockPlanes(world);
+    ResetFlowFields(world);
+    RebuildSpawnSets(world);
+}
+
+// The world, its subsystem tables, the animal pool and the frame scratch
+// arena all share one allocation sized up front
+World* CreateWorld(void) {
+    InitBlockRegistry();
+    
+    size_t size = MEMORY_ALIGNED_SIZE(sizeof(World)) WORLD_ARENA_TABLES(WORLD_TABLE_SIZE) +
+                  PoolArenaSize(sizeof(Animal), MAX_ANIMALS) + MEMORY_ALIGNED_SIZE(FRAME_MEMORY_SIZE);
+    
+    MemoryArena memory;
+    if (!ArenaInit(&memory, size)) return NULL;
+    
+    World* world = (World*)ArenaAlloc(&memory, sizeof(World), MEMORY_WORLD);
+    world->memory = memory;
+    bool ok = true;
+    WORLD_ARENA_TABLES(WORLD_TABLE_ALLOC)
+    ok = ok && PoolInit(&world->animalPool, &world->memory, sizeof(Animal), MAX_ANIMALS, MEMORY_ENTITIES) &&
+         ArenaInitFrom(&world->frameMemory, &world->memory, FRAME_MEMORY_SIZE, MEMORY_FRAME);
+    
+    // The size above is exact; anything left over means an allocation
+    // was added without being counted
+    if (!ok || world->memory.used != size) {
+        TraceLog(LOG_ERROR, "MEMORY: world arena layout is %u bytes but %u were used", (unsigned int)size,
+                 (unsigned int)world->memory.used);
+        ArenaFree(&world->memory);
+        return NULL;
     }
-}
\ No newline at end of file
+    world->animals = (Animal*)world->animalPool.items;
+    return world;
+}
+
+void DestroyWorld(World* world) {
+    MemoryArena memory = world->memory;
+    ArenaFree(&memory);
+}
+
+// Starts a new game in an existing world. Every piece of simulated state
+// is reset here or regenerated by GenerateWorld.
+void InitGame(World* world, unsigned int seed) {
+    world->seed = seed;
+    world->input = (InputFrame){ 0 };
+    world->flowFieldStamp = 0;
+    ArenaReset(&world->frameMemory);
+    
+    // Cells edited since generation, and since a server last sent them out
+    memset(world->modifiedCells, 0, sizeof(world->modifiedCells));
+    memset(world->changedCells, 0, sizeof(world->changedCells));
+    memset(world->playerActive, 0, sizeof(world->playerActive));
+    memset(world->unsavedRegions, 0, sizeof(world->unsavedRegions));
+    memset(world->unloadedRegions, 0, sizeof(world->unloadedRegions));
+    
+    InitPlayer(&world->player);
+    
+    world->camera.target = (Vector2){ world->player.x, world->player.y };
+    world->camera.offset = (Vector2){ SCREEN_WIDTH / 2.0f, SCREEN_HEIGHT / 2.0f };
+    world->camera.rotation = 0.0f;
+    world->camera.zoom = 1.0f;
+    
+    // Generation writes blocks directly, so nothing is queued for them
+    if (!LoadTerrainCache(world)) GenerateWorld(world);
+    ResetBlockUpdates(world);
+    ResetGranular(world);
+    ResetWorldEdits(world);
+    ResetParticles(world);
+    InitAnimals(world);
+}
@@ -0,0 +1,91 @@
+#include "game.h"
+#include "platform.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Fills the terrain cache ahead of time, one seed after another. Each
+// world is generated with every thread working on bands of its columns,
+// so a single seed uses all the cores too.
+//
+//     pregen --seed N [--count N] [--out directory] [--threads N]
+//            [--width N] [--height N]
+//
+// The world size is fixed when the game is compiled (WORLD_WIDTH and
+// WORLD_HEIGHT in game.h). --width and --height only check that this
+// build makes worlds of the size asked for.
+
+static void PrintUsage(void) {
+    printf("usage: pregen --seed N [--count N] [--out directory] [--threads N] [--width N] [--height N]\n"
+           "worlds are %dx%d; the size is set at compile time by WORLD_WIDTH and WORLD_HEIGHT\n",
+           WORLD_WIDTH, WORLD_HEIGHT);
+}
+
+int main(int argc, char** argv) {
+    unsigned int seed = 0;
+    bool haveSeed = false;
+    unsigned int count = 1;
+    const char* directory = "terrain";
+    int threadCount = PlatformGetCpuCount();
+    int width = WORLD_WIDTH;
+    int height = WORLD_HEIGHT;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = (unsigned int)strtoul(argv[++i], NULL, 10);
+            haveSeed = true;
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = (unsigned int)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            directory = argv[++i];
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--width") == 0 && i + 1 < argc) {
+            width = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--height") == 0 && i + 1 < argc) {
+            height = atoi(argv[++i]);
+        }
+    }
+    if (!haveSeed || count == 0) {
+        PrintUsage();
+        return 1;
+    }
+    if (width != WORLD_WIDTH || height != WORLD_HEIGHT) {
+        printf("This build makes %dx%d worlds, not %dx%d; change WORLD_WIDTH and WORLD_HEIGHT and rebuild\n",
+               WORLD_WIDTH, WORLD_HEIGHT, width, height);
+        return 1;
+    }
+    if (threadCount < 1) threadCount = 1;
+    if (threadCount > MAX_GENERATION_THREADS) threadCount = MAX_GENERATION_THREADS;
+    
+    World* world = CreateWorld();
+    if (world == NULL) {
+        printf("Could not allocate a world\n");
+        return 1;
+    }
+    
+    int written = 0;
+    int failed = 0;
+    uint64_t start = PlatformGetTicks();
+    for (unsigned int i = 0; i < count; i++) {
+        uint64_t seedStart = PlatformGetTicks();
+        world->seed = seed + i;
+        GenerateWorldThreaded(world, threadCount);
+        bool ok = WriteTerrainCache(world, directory);
+        double milliseconds = (PlatformGetTicks() - seedStart) / 1000000.0;
+        
+        if (ok) {
+            written++;
+        } else {
+            failed++;
+        }
+        printf("{\"seed\":%u,\"ok\":%s,\"ms\":%.2f}\n", world->seed, ok ? "true" : "false", milliseconds);
+        fflush(stdout);
+    }
+    double seconds = (PlatformGetTicks() - start) / 1000000000.0;
+    
+    printf("{\"written\":%d,\"failed\":%d,\"threads\":%d,\"width\":%d,\"height\":%d,\"version\":%d,\"seconds\":%.3f}\n",
+           written, failed, threadCount, WORLD_WIDTH, WORLD_HEIGHT, TERRAIN_GENERATOR_VERSION, seconds);
+    
+    DestroyWorld(world);
+    return failed == 0 ? 0 : 1;
+}